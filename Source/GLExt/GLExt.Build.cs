@@ -37,6 +37,7 @@ public class GLExt : ModuleRules
             new string[]
             {
                 "GFCore",
+                "AnimationBudgetAllocator",
             }
         );
 
@@ -2,20 +2,23 @@
 
 #include "CharacterAnimInstance.h"
 
+#include "LocomotionAnimInstanceProxy.h"
 #include "GameplayTag/GLETags_Status.h"
-#include "LocomotionGeneralNameStatics.h"
 #include "LocomotionFunctionLibrary.h"
 #include "LocomotionComponent.h"
 #include "LocomotionCharacter.h"
 #include "GLExtStatGroup.h"
 
-#include "Components/CapsuleComponent.h"
+#include "Character/CharacterMeshAccessorInterface.h"
+
 #include "Components/SkeletalMeshComponent.h"
-#include "Animation/AnimInstanceProxy.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(CharacterAnimInstance)
 
 
+DECLARE_DWORD_COUNTER_STAT(TEXT("Idle Poses Frozen"), STAT_CharacterAnimInstance_IdlePosesFrozen, STATGROUP_Locomotion);
+
+
 UCharacterAnimInstance::UCharacterAnimInstance(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
@@ -47,6 +50,11 @@ void UCharacterAnimInstance::NativeBeginPlay()
 {
 	ensureMsgf(IsValid(Character)			, TEXT("UCharacterAnimInstance::NativeBeginPlay: Invalid Character"));
 	ensureMsgf(IsValid(CharacterMovement)	, TEXT("UCharacterAnimInstance::NativeBeginPlay: Invalid CharacterMovement"));
+
+	if (IsValid(Character))
+	{
+		UpdateLeader();
+	}
 }
 
 void UCharacterAnimInstance::NativeUpdateAnimation(float DeltaTime)
@@ -76,6 +84,11 @@ void UCharacterAnimInstance::NativePostEvaluateAnimation()
 	OnPostEvaluateAnimation();
 }
 
+FAnimInstanceProxy* UCharacterAnimInstance::CreateAnimInstanceProxy()
+{
+	return new FLocomotionAnimInstanceProxy(this);
+}
+
 void UCharacterAnimInstance::UpdateAnimationOnGameThread(float DeltaTime)
 {
 	if (!IsValid(Character) || !IsValid(CharacterMovement))
@@ -83,6 +96,13 @@ void UCharacterAnimInstance::UpdateAnimationOnGameThread(float DeltaTime)
 		return;
 	}
 
+	if ((PendingUpdateDeltaTimeThreshold > 0.0f) && (DeltaTime > PendingUpdateDeltaTimeThreshold))
+	{
+		MarkPendingUpdate();
+	}
+
+	UpdateLeader();
+
 	if (GetSkelMeshComponent()->IsUsingAbsoluteRotation())
 	{
 		const auto& ActorTransform{ Character->GetActorTransform() };
@@ -100,16 +120,7 @@ void UCharacterAnimInstance::UpdateAnimationOnGameThread(float DeltaTime)
 		const_cast<FTransform&>(Proxy.GetActorTransform()) = ActorTransform;
 	}
 
-	LocomotionMode = CharacterMovement->GetLocomotionMode();
-	RotationMode = CharacterMovement->GetRotationMode();
-	Stance = CharacterMovement->GetStance();
-	Gait = CharacterMovement->GetGait();
-	LocomotionAction = CharacterMovement->GetLocomotionAction();
-
-	UpdateCharacterStatesOnGameThread();
-	UpdateMovementBaseOnGameThread();
-	UpdateViewOnGameThread();
-	UpdateLocomotionOnGameThread();
+	// Other states are read from the snapshot copied by FLocomotionAnimInstanceProxy::PreUpdate()
 }
 
 void UCharacterAnimInstance::UpdateAnimationOnThreadSafe(float DeltaTime)
@@ -119,6 +130,21 @@ void UCharacterAnimInstance::UpdateAnimationOnThreadSafe(float DeltaTime)
 		return;
 	}
 
+	const auto& Proxy{ GetProxyOnAnyThread<FLocomotionAnimInstanceProxy>() };
+
+	if (Proxy.IsFollowingLeader())
+	{
+		ApplyLeaderStates(Proxy.GetLeaderStates());
+		return;
+	}
+
+	const auto& Snapshot{ Proxy.GetSnapshot() };
+
+	UpdateCharacterStates(Snapshot);
+	UpdateMovementBase(Snapshot.MovementBase);
+	UpdateViewState(Snapshot);
+	UpdateLocomotion(Snapshot);
+
 	UpdateView(DeltaTime);
 }
 
@@ -129,68 +155,193 @@ void UCharacterAnimInstance::OnPostEvaluateAnimation()
 		return;
 	}
 
+	UpdateCurveValues();
+
+	if (bLeader)
+	{
+		PublishLeaderStates();
+	}
+
 	bPendingUpdate = false;
 }
 
 #pragma endregion
 
 
-#pragma region Character States
+#pragma region Leader Follower
 
-void UCharacterAnimInstance::UpdateCharacterStatesOnGameThread()
+void UCharacterAnimInstance::UpdateLeader()
 {
-	LocomotionMode = CharacterMovement->GetLocomotionMode();
-	RotationMode = CharacterMovement->GetRotationMode();
-	Stance = CharacterMovement->GetStance();
-	Gait = CharacterMovement->GetGait();
-	LocomotionAction = CharacterMovement->GetLocomotionAction();
+	auto* Mesh{ GetSkelMeshComponent() };
+	auto* MainMesh{ ICharacterMeshAccessorInterface::Execute_GetMainMesh(Character) };
+
+	bLeader = (Mesh == MainMesh);
+
+	auto* NewLeader
+	{
+		(!bLeader && MainMesh && (FollowMode != ECharacterAnimFollowMode::None)) ? Cast<UCharacterAnimInstance>(MainMesh->GetAnimInstance()) : nullptr
+	};
+
+	if (Leader.Get() == NewLeader)
+	{
+		return;
+	}
+
+	// Tick after the leader so that its states of this frame are followed when they are available
+
+	if (auto* PreviousLeader{ Leader.Get() })
+	{
+		Mesh->RemoveTickPrerequisiteComponent(PreviousLeader->GetSkelMeshComponent());
+	}
+
+	Leader = NewLeader;
+
+	if (NewLeader)
+	{
+		Mesh->AddTickPrerequisiteComponent(MainMesh);
+
+		if ((FollowMode == ECharacterAnimFollowMode::Pose) && (Mesh->LeaderPoseComponent.Get() != MainMesh))
+		{
+			Mesh->SetLeaderPoseComponent(MainMesh);
+		}
+	}
+}
+
+void UCharacterAnimInstance::PublishLeaderStates()
+{
+	++LeaderStates.SequenceNumber;
+
+	LeaderStates.LocomotionMode = LocomotionMode;
+	LeaderStates.RotationMode = RotationMode;
+	LeaderStates.Stance = Stance;
+	LeaderStates.Gait = Gait;
+	LeaderStates.LocomotionAction = LocomotionAction;
+
+	LeaderStates.MovementBase = MovementBase;
+	LeaderStates.ViewState = ViewState;
+	LeaderStates.LocomotionState = LocomotionState;
+
+	LeaderStates.CurveValues = CurveValues;
+}
+
+void UCharacterAnimInstance::ApplyLeaderStates(const FLocomotionAnimLeaderStates& States)
+{
+	LocomotionMode = States.LocomotionMode;
+	RotationMode = States.RotationMode;
+	Stance = States.Stance;
+	Gait = States.Gait;
+	LocomotionAction = States.LocomotionAction;
+
+	UpdateMovementBase(States.MovementBase);
+
+	ViewState = States.ViewState;
+	LocomotionState = States.LocomotionState;
+
+	// The amounts driven by the curves are only taken from the leader when its curves are followed as well
+
+	if (FollowMode != ECharacterAnimFollowMode::StatesAndCurves)
+	{
+		UpdateViewAmounts();
+	}
 }
 
 #pragma endregion
 
 
-#pragma region Movement Base
+#pragma region Flag
 
-void UCharacterAnimInstance::UpdateMovementBaseOnGameThread()
+void UCharacterAnimInstance::MarkTeleported()
 {
-	const auto& BasedMovement{ Character->GetBasedMovement() };
+	TeleportedTime = GetWorld()->GetTimeSeconds();
+
+	// Wake the pose so that the teleportation is processed by the anim graph
 
-	if (BasedMovement.MovementBase != MovementBase.Primitive || BasedMovement.BoneName != MovementBase.BoneName)
+	RestTime = 0.0f;
+	SetPoseFrozen(false);
+}
+
+#pragma endregion
+
+
+#pragma region Rest
+
+void UCharacterAnimInstance::UpdateRestState(bool bAtRest, float FreezeDelay, float DeltaTime)
+{
+	if (!bAtRest || bPendingUpdate || IsAnyMontagePlaying())
 	{
-		MovementBase.Primitive = BasedMovement.MovementBase;
-		MovementBase.BoneName = BasedMovement.BoneName;
-		MovementBase.bBaseChanged = true;
+		RestTime = 0.0f;
+		SetPoseFrozen(false);
+		return;
 	}
-	else
+
+	RestTime += DeltaTime;
+
+	if (RestTime >= FreezeDelay)
 	{
-		MovementBase.bBaseChanged = false;
+		SetPoseFrozen(true);
+
+		INC_DWORD_STAT(STAT_CharacterAnimInstance_IdlePosesFrozen);
 	}
+}
 
-	MovementBase.bHasRelativeLocation = BasedMovement.HasRelativeLocation();
-	MovementBase.bHasRelativeRotation = MovementBase.bHasRelativeLocation && BasedMovement.bRelativeRotation;
+void UCharacterAnimInstance::SetPoseFrozen(bool bNewPoseFrozen)
+{
+	if (bPoseFrozen == bNewPoseFrozen)
+	{
+		return;
+	}
 
-	const auto PreviousRotation{ MovementBase.Rotation };
+	bPoseFrozen = bNewPoseFrozen;
+
+	if (auto* Mesh{ GetSkelMeshComponent() })
+	{
+		Mesh->bNoSkeletonUpdate = bNewPoseFrozen;
+	}
+}
 
-	MovementBaseUtility::GetMovementBaseTransform(BasedMovement.MovementBase, BasedMovement.BoneName, MovementBase.Location, MovementBase.Rotation);
+#pragma endregion
+
+
+#pragma region Character States
 
-	MovementBase.DeltaRotation = (MovementBase.bHasRelativeLocation && !MovementBase.bBaseChanged)
-		? (MovementBase.Rotation * PreviousRotation.Inverse()).Rotator()
-		: FRotator::ZeroRotator;
+void UCharacterAnimInstance::UpdateCharacterStates(const FLocomotionAnimSnapshot& Snapshot)
+{
+	LocomotionMode = Snapshot.LocomotionMode;
+	RotationMode = Snapshot.RotationMode;
+	Stance = Snapshot.Stance;
+	Gait = Snapshot.Gait;
+	LocomotionAction = Snapshot.LocomotionAction;
 }
 
 #pragma endregion
 
 
-#pragma region View State
+#pragma region Movement Base
 
-void UCharacterAnimInstance::UpdateViewOnGameThread()
+void UCharacterAnimInstance::UpdateMovementBase(const FMovementBaseState& NewMovementBase)
 {
-	check(IsInGameThread());
+	// The base and its transform have already been computed by ULocomotionComponent::UpdateMovementBase(),
+	// but the change and the delta rotation are measured between the updates of this anim instance,
+	// so that the rotation of the base in the frames skipped by URO or the animation budget allocator is not lost.
 
-	const auto& View{ CharacterMovement->GetViewState() };
+	const auto bBaseChanged{ (NewMovementBase.Primitive != MovementBase.Primitive) || (NewMovementBase.BoneName != MovementBase.BoneName) };
+	const auto PreviousRotation{ MovementBase.Rotation };
+
+	MovementBase = NewMovementBase;
 
-	ViewState.Rotation = View.Rotation;
-	ViewState.YawSpeed = View.YawSpeed;
+	MovementBase.bBaseChanged = bBaseChanged;
+	MovementBase.DeltaRotation = (MovementBase.bHasRelativeLocation && !bBaseChanged) ? (MovementBase.Rotation * PreviousRotation.Inverse()).Rotator() : FRotator::ZeroRotator;
+}
+
+#pragma endregion
+
+
+#pragma region View State
+
+void UCharacterAnimInstance::UpdateViewState(const FLocomotionAnimSnapshot& Snapshot)
+{
+	ViewState.Rotation = Snapshot.ViewRotation;
+	ViewState.YawSpeed = Snapshot.ViewYawSpeed;
 }
 
 void UCharacterAnimInstance::UpdateView(float DeltaTime)
@@ -203,8 +354,13 @@ void UCharacterAnimInstance::UpdateView(float DeltaTime)
 		ViewState.PitchAmount = (0.5f - ViewState.PitchAngle / 180.0f);
 	}
 
-	ViewState.ViewAmount = 1.0f - GetCurveValueClamped01(ULocomotionGeneralNameStatics::ViewBlockCurveName());
-	ViewState.AimingAmount = GetCurveValueClamped01(ULocomotionGeneralNameStatics::AllowAimingCurveName());
+	UpdateViewAmounts();
+}
+
+void UCharacterAnimInstance::UpdateViewAmounts()
+{
+	ViewState.ViewAmount = 1.0f - CurveValues.GetClamped01(ELocomotionAnimCurve::ViewBlock);
+	ViewState.AimingAmount = CurveValues.GetClamped01(ELocomotionAnimCurve::AllowAiming);
 	ViewState.LookAmount = (ViewState.ViewAmount * (1.0f - ViewState.AimingAmount));
 }
 
@@ -213,11 +369,9 @@ void UCharacterAnimInstance::UpdateView(float DeltaTime)
 
 #pragma region Locomotion State
 
-void UCharacterAnimInstance::UpdateLocomotionOnGameThread()
+void UCharacterAnimInstance::UpdateLocomotion(const FLocomotionAnimSnapshot& Snapshot)
 {
-	check(IsInGameThread());
-
-	const auto& Locomotion{ CharacterMovement->GetLocomotionState() };
+	const auto& Locomotion{ Snapshot.Locomotion };
 
 	LocomotionState.bHasInput = Locomotion.bHasInput;
 	LocomotionState.InputYawAngle = Locomotion.InputYawAngle;
@@ -227,9 +381,9 @@ void UCharacterAnimInstance::UpdateLocomotionOnGameThread()
 	LocomotionState.VelocityYawAngle = Locomotion.VelocityYawAngle;
 	LocomotionState.Acceleration = Locomotion.Acceleration;
 
-	LocomotionState.MaxAcceleration = CharacterMovement->GetMaxAcceleration();
-	LocomotionState.MaxBrakingDeceleration = CharacterMovement->GetMaxBrakingDeceleration();
-	LocomotionState.WalkableFloorZ = CharacterMovement->GetWalkableFloorZ();
+	LocomotionState.MaxAcceleration = Snapshot.MaxAcceleration;
+	LocomotionState.MaxBrakingDeceleration = Snapshot.MaxBrakingDeceleration;
+	LocomotionState.WalkableFloorZ = Snapshot.WalkableFloorZ;
 
 	LocomotionState.bMoving = Locomotion.bMoving;
 
@@ -241,12 +395,35 @@ void UCharacterAnimInstance::UpdateLocomotionOnGameThread()
 	LocomotionState.RotationQuaternion = Locomotion.RotationQuaternion;
 	LocomotionState.YawSpeed = Locomotion.YawSpeed;
 
-	LocomotionState.Scale = UE_REAL_TO_FLOAT(GetSkelMeshComponent()->GetComponentScale().Z);
+	LocomotionState.Scale = Snapshot.MeshScale;
+	LocomotionState.CapsuleRadius = Snapshot.CapsuleRadius;
+	LocomotionState.CapsuleHalfHeight = Snapshot.CapsuleHalfHeight;
+}
 
-	const auto* Capsule{ Character->GetCapsuleComponent() };
+#pragma endregion
+
+
+#pragma region Curves
+
+void UCharacterAnimInstance::UpdateCurveValues()
+{
+	const auto* LeaderAnimIns{ Leader.Get() };
+
+	if (LeaderAnimIns && (FollowMode == ECharacterAnimFollowMode::StatesAndCurves))
+	{
+		CurveValues = LeaderAnimIns->GetLeaderStates().CurveValues;
+	}
+	else
+	{
+		CurveValues.Read(this);
+	}
 
-	LocomotionState.CapsuleRadius = Capsule->GetScaledCapsuleRadius();
-	LocomotionState.CapsuleHalfHeight = Capsule->GetScaledCapsuleHalfHeight();
+	// Share the values with the movement of the character if this is the anim instance of its main mesh
+
+	if (GetSkelMeshComponent() == Character->GetMesh())
+	{
+		CharacterMovement->SetAnimCurveValues(CurveValues);
+	}
 }
 
 #pragma endregion
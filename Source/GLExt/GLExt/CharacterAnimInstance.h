@@ -9,6 +9,8 @@
 #include "State/MovementBaseState.h"
 #include "State/AnimationViewState.h"
 #include "State/AnimationLocomotionState.h"
+#include "Type/LocomotionAnimCurves.h"
+#include "Type/LocomotionAnimFollowerTypes.h"
 
 #include "GameplayTagContainer.h"
 
@@ -16,6 +18,7 @@
 
 class ULocomotionComponent;
 class ALocomotionCharacter;
+struct FLocomotionAnimSnapshot;
 
 
 /**
@@ -23,6 +26,11 @@ class ALocomotionCharacter;
  * 
  * Tips:
  *	Basically, it is used only for TPP Mesh of Character and processes data necessary for animation.
+ *	The states are read from the snapshot published by ULocomotionComponent and computed in the thread-safe update.
+ *	(See FLocomotionAnimInstanceProxy)
+ * 
+ *	The anim instance of the main mesh is the leader, and those of the other meshes can follow it
+ *	instead of computing the same states again. (See FollowMode)
  */
 UCLASS(Config = Game)
 class GLEXT_API UCharacterAnimInstance : public UAnimInstance
@@ -54,12 +62,74 @@ public:
 	virtual void NativeThreadSafeUpdateAnimation(float DeltaTime) override;
 	virtual void NativePostEvaluateAnimation() override;
 
+protected:
+	virtual FAnimInstanceProxy* CreateAnimInstanceProxy() override;
+
 protected:
 	virtual void UpdateAnimationOnGameThread(float DeltaTime);
 	virtual void UpdateAnimationOnThreadSafe(float DeltaTime);
 	virtual void OnPostEvaluateAnimation();
 
 
+	/////////////////////////////////////////
+	// Leader Follower
+public:
+	//
+	// How this anim instance follows the anim instance of the main mesh when it is not on the main mesh
+	// 
+	// Tips:
+	//	While following, configs of this anim instance used to compute the states, such as MovingSmoothSpeedThreshold, are not used.
+	//
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "Configs|Follower")
+	ECharacterAnimFollowMode FollowMode{ ECharacterAnimFollowMode::None };
+
+protected:
+	//
+	// Anim instance of the main mesh followed by this anim instance
+	//
+	TWeakObjectPtr<UCharacterAnimInstance> Leader;
+
+	//
+	// Whether this anim instance is on the main mesh and publishes its states for the followers
+	//
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "State", Transient)
+	bool bLeader{ false };
+
+	//
+	// States published for the followers when this anim instance is the leader
+	//
+	FLocomotionAnimLeaderStates LeaderStates;
+
+public:
+	/**
+	 * Returns the anim instance of the main mesh followed by this anim instance (nullptr if not following)
+	 */
+	const UCharacterAnimInstance* GetLeader() const { return Leader.Get(); }
+
+	/**
+	 * Returns whether this anim instance is on the main mesh
+	 */
+	bool IsLeader() const { return bLeader; }
+
+	/**
+	 * Returns the states published for the followers
+	 */
+	const FLocomotionAnimLeaderStates& GetLeaderStates() const { return LeaderStates; }
+
+protected:
+	/**
+	 * Find the anim instance of the main mesh and start or stop following it
+	 * 
+	 * Tips:
+	 *	In ECharacterAnimFollowMode::Pose, the main mesh is set as the leader pose component of this mesh.
+	 */
+	void UpdateLeader();
+
+	void PublishLeaderStates();
+
+	void ApplyLeaderStates(const FLocomotionAnimLeaderStates& States);
+
+
 	/////////////////////////////////////////
 	// Flag
 protected:
@@ -69,6 +139,16 @@ protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "State", Transient)
 	bool bPendingUpdate{ true };
 
+	//
+	// Delta time of an update above which the update is treated as pending
+	// 
+	// Tips:
+	//	Frames skipped by the URO or the animation budget allocator are accumulated into the delta time of the next update.
+	//	Smoothing the states over such a long time is not reliable, so they are reset as when the update is pending.
+	//
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "Configs|General", Meta = (ClampMin = 0, ForceUnits = "s"))
+	float PendingUpdateDeltaTimeThreshold{ 0.25f };
+
 	//
 	// Time the last teleportation took place.
 	//
@@ -78,7 +158,42 @@ protected:
 public:
 	void MarkPendingUpdate() { bPendingUpdate |= true; }
 
-	void MarkTeleported() { TeleportedTime = GetWorld()->GetTimeSeconds(); }
+	bool IsPendingUpdate() const { return bPendingUpdate; }
+
+	void MarkTeleported();
+
+
+	/////////////////////////////////////////
+	// Rest
+protected:
+	//
+	// Time the character has been at rest
+	//
+	float RestTime{ 0.0f };
+
+	//
+	// Whether the pose of the mesh is frozen because the character is at rest
+	// 
+	// Tips:
+	//	While frozen, the mesh skips the update and the evaluation and keeps the last evaluated pose and curves.
+	//
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "State", Transient)
+	bool bPoseFrozen{ false };
+
+public:
+	/**
+	 * Update the time at rest and freeze or wake the pose
+	 * 
+	 * Tips:
+	 *	Called by ULocomotionComponent every frame, since this anim instance is not updated while frozen.
+	 *	The pose is never frozen while a montage is playing or an update is pending.
+	 */
+	void UpdateRestState(bool bAtRest, float FreezeDelay, float DeltaTime);
+
+	bool IsPoseFrozen() const { return bPoseFrozen; }
+
+protected:
+	void SetPoseFrozen(bool bNewPoseFrozen);
 
 
 	/////////////////////////////////////////
@@ -100,7 +215,7 @@ public:
 	FGameplayTag LocomotionAction;
 
 protected:
-	void UpdateCharacterStatesOnGameThread();
+	void UpdateCharacterStates(const FLocomotionAnimSnapshot& Snapshot);
 
 
 	/////////////////////////////////////////
@@ -110,7 +225,7 @@ public:
 	FMovementBaseState MovementBase;
 
 protected:
-	void UpdateMovementBaseOnGameThread();
+	void UpdateMovementBase(const FMovementBaseState& NewMovementBase);
 
 
 	/////////////////////////////////////////
@@ -120,10 +235,12 @@ public:
 	FAnimationViewState ViewState;
 
 protected:
-	void UpdateViewOnGameThread();
+	void UpdateViewState(const FLocomotionAnimSnapshot& Snapshot);
 
 	void UpdateView(float DeltaTime);
 
+	void UpdateViewAmounts();
+
 
 	/////////////////////////////////////////
 	// Locomotion State
@@ -135,7 +252,25 @@ public:
 	float MovingSmoothSpeedThreshold{ 150.0 };
 
 protected:
-	void UpdateLocomotionOnGameThread();
+	void UpdateLocomotion(const FLocomotionAnimSnapshot& Snapshot);
+
+
+	/////////////////////////////////////////
+	// Curves
+protected:
+	//
+	// Values of the locomotion curves read in one pass after the last evaluation
+	//
+	FLocomotionAnimCurveValues CurveValues;
+
+public:
+	/**
+	 * Returns the values of the locomotion curves after the last evaluation
+	 */
+	const FLocomotionAnimCurveValues& GetCurveValues() const { return CurveValues; }
+
+protected:
+	void UpdateCurveValues();
 
 
 	/////////////////////////////////////////
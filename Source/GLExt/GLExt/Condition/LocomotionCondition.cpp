@@ -2,4 +2,12 @@
 
 #include "LocomotionCondition.h"
 
+#include "Type/LocomotionConditionProgram.h"
+
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionCondition)
+
+
+void ULocomotionCondition::Compile(FLocomotionConditionProgram& Program) const
+{
+	Program.AddCallCondition(this);
+}
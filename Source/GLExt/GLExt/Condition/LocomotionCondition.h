@@ -7,6 +7,39 @@
 #include "LocomotionCondition.generated.h"
 
 class ULocomotionComponent;
+class FLocomotionConditionProgram;
+
+
+/**
+ * Inputs of LocomotionComponent read by a condition
+ * 
+ * Tips:
+ *	LocomotionComponent uses these to skip resolving configs while none of the inputs have changed.
+ */
+UENUM(Meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor = "true"))
+enum class ELocomotionConditionInput : uint8
+{
+	None		= 0 UMETA(Hidden),
+
+	// FLocomotionState::InputYawAngle
+	InputYaw	= 1 << 0,
+
+	// FViewState::Rotation.Yaw
+	ViewYaw		= 1 << 1,
+
+	// FLocomotionState::Speed
+	Speed		= 1 << 2,
+
+	// FLocomotionState::bHasInput
+	HasInput	= 1 << 3,
+
+	// LocomotionAction and other state tags of LocomotionComponent
+	StateTags	= 1 << 4,
+
+	// Inputs cannot be declared and the condition must always be evaluated
+	Unknown		= 1 << 7,
+};
+ENUM_CLASS_FLAGS(ELocomotionConditionInput);
 
 
 /**
@@ -22,6 +55,24 @@ public:
 	 */
 	virtual bool CanEnter(const ULocomotionComponent* LC) const { return false; }
 
+	/**
+	 * Returns the inputs read by CanEnter().
+	 * 
+	 * Note:
+	 *	Subclasses should override this to declare their inputs.
+	 *	Otherwise, configs will be resolved every frame.
+	 */
+	virtual ELocomotionConditionInput GetDependentInputs() const { return ELocomotionConditionInput::Unknown; }
+
+	/**
+	 * Emit the instructions equivalent to CanEnter() into the program.
+	 * 
+	 * Note:
+	 *	By default, an instruction that calls CanEnter() is emitted.
+	 *	Built-in conditions override this to be evaluated without virtual calls.
+	 */
+	virtual void Compile(FLocomotionConditionProgram& Program) const;
+
 public:
 	//
 	// Recommend a transition when it was not possible Tag
@@ -0,0 +1,59 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionCondition_And.h"
+
+#include "Type/LocomotionConditionProgram.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionCondition_And)
+
+
+bool ULocomotionCondition_And::CanEnter(const ULocomotionComponent* LC) const
+{
+	for (const auto& Condition : Conditions)
+	{
+		if (!Condition)
+		{
+			continue;
+		}
+
+		if (!Condition->CanEnter(LC))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+ELocomotionConditionInput ULocomotionCondition_And::GetDependentInputs() const
+{
+	auto Inputs{ ELocomotionConditionInput::None };
+
+	for (const auto& Condition : Conditions)
+	{
+		if (Condition)
+		{
+			Inputs |= Condition->GetDependentInputs();
+		}
+	}
+
+	return Inputs;
+}
+
+void ULocomotionCondition_And::Compile(FLocomotionConditionProgram& Program) const
+{
+	if (!Program.CanCompileChildren(Conditions.Num()))
+	{
+		Program.AddCallCondition(this);
+		return;
+	}
+
+	const auto Index{ Program.AddComposite(ELocomotionConditionOp::And, Conditions.Num()) };
+
+	for (const auto& Condition : Conditions)
+	{
+		Program.CompileChild(Condition);
+	}
+
+	Program.FinishInstruction(Index);
+}
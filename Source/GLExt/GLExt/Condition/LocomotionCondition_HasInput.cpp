@@ -0,0 +1,19 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionCondition_HasInput.h"
+
+#include "LocomotionComponent.h"
+#include "Type/LocomotionConditionProgram.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionCondition_HasInput)
+
+
+bool ULocomotionCondition_HasInput::CanEnter(const ULocomotionComponent* LC) const
+{
+	return LC->GetLocomotionState().bHasInput == bRequireInput;
+}
+
+void ULocomotionCondition_HasInput::Compile(FLocomotionConditionProgram& Program) const
+{
+	Program.AddInstruction(ELocomotionConditionOp::HasInput, 0.0f, 0.0f, bRequireInput ? 1 : 0);
+}
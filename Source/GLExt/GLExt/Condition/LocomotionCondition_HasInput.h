@@ -0,0 +1,29 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Condition/LocomotionCondition.h"
+
+#include "LocomotionCondition_HasInput.generated.h"
+
+
+/**
+ * Determined by whether the character has movement input
+ */
+UCLASS(meta = (DisplayName = "Condition Has Input"))
+class ULocomotionCondition_HasInput : public ULocomotionCondition
+{
+	GENERATED_BODY()
+public:
+	virtual bool CanEnter(const ULocomotionComponent* LC) const override;
+	virtual ELocomotionConditionInput GetDependentInputs() const override { return ELocomotionConditionInput::HasInput; }
+	virtual void Compile(FLocomotionConditionProgram& Program) const override;
+
+public:
+	//
+	// Whether movement input is required. If false, it can be entered only without movement input.
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement Condition")
+	bool bRequireInput{ true };
+
+};
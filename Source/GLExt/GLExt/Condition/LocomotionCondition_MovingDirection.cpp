@@ -3,6 +3,7 @@
 #include "LocomotionCondition_MovingDirection.h"
 
 #include "LocomotionComponent.h"
+#include "Type/LocomotionConditionProgram.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionCondition_MovingDirection)
 
@@ -17,3 +18,8 @@ bool ULocomotionCondition_MovingDirection::CanEnter(const ULocomotionComponent*
 
 	return false;
 }
+
+void ULocomotionCondition_MovingDirection::Compile(FLocomotionConditionProgram& Program) const
+{
+	Program.AddInstruction(ELocomotionConditionOp::MovingDirection, ViewRelativeAngleThreshold);
+}
@@ -16,6 +16,8 @@ class ULocomotionCondition_MovingDirection : public ULocomotionCondition
 	GENERATED_BODY()
 public:
 	virtual bool CanEnter(const ULocomotionComponent* LC) const override;
+	virtual ELocomotionConditionInput GetDependentInputs() const override { return ELocomotionConditionInput::InputYaw | ELocomotionConditionInput::ViewYaw; }
+	virtual void Compile(FLocomotionConditionProgram& Program) const override;
 
 public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement Condition")
@@ -0,0 +1,33 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionCondition_Not.h"
+
+#include "Type/LocomotionConditionProgram.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionCondition_Not)
+
+
+bool ULocomotionCondition_Not::CanEnter(const ULocomotionComponent* LC) const
+{
+	return Condition ? !Condition->CanEnter(LC) : false;
+}
+
+ELocomotionConditionInput ULocomotionCondition_Not::GetDependentInputs() const
+{
+	return Condition ? Condition->GetDependentInputs() : ELocomotionConditionInput::None;
+}
+
+void ULocomotionCondition_Not::Compile(FLocomotionConditionProgram& Program) const
+{
+	if (!Program.CanCompileChildren(1))
+	{
+		Program.AddCallCondition(this);
+		return;
+	}
+
+	const auto Index{ Program.AddInstruction(ELocomotionConditionOp::Not) };
+
+	Program.CompileChild(Condition);
+
+	Program.FinishInstruction(Index);
+}
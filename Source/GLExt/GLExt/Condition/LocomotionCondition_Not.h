@@ -0,0 +1,29 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Condition/LocomotionCondition.h"
+
+#include "LocomotionCondition_Not.generated.h"
+
+
+/**
+ * Determined by inverting the result of the condition
+ */
+UCLASS(meta = (DisplayName = "Condition Not"))
+class ULocomotionCondition_Not : public ULocomotionCondition
+{
+	GENERATED_BODY()
+public:
+	virtual bool CanEnter(const ULocomotionComponent* LC) const override;
+	virtual ELocomotionConditionInput GetDependentInputs() const override;
+	virtual void Compile(FLocomotionConditionProgram& Program) const override;
+
+public:
+	//
+	// Condition to be inverted. None is treated as a condition that can always be entered.
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Instanced, Category = "Movement Condition")
+	TObjectPtr<const ULocomotionCondition> Condition{ nullptr };
+
+};
@@ -0,0 +1,59 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionCondition_Or.h"
+
+#include "Type/LocomotionConditionProgram.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionCondition_Or)
+
+
+bool ULocomotionCondition_Or::CanEnter(const ULocomotionComponent* LC) const
+{
+	for (const auto& Condition : Conditions)
+	{
+		if (!Condition)
+		{
+			return true;
+		}
+
+		if (Condition->CanEnter(LC))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+ELocomotionConditionInput ULocomotionCondition_Or::GetDependentInputs() const
+{
+	auto Inputs{ ELocomotionConditionInput::None };
+
+	for (const auto& Condition : Conditions)
+	{
+		if (Condition)
+		{
+			Inputs |= Condition->GetDependentInputs();
+		}
+	}
+
+	return Inputs;
+}
+
+void ULocomotionCondition_Or::Compile(FLocomotionConditionProgram& Program) const
+{
+	if (!Program.CanCompileChildren(Conditions.Num()))
+	{
+		Program.AddCallCondition(this);
+		return;
+	}
+
+	const auto Index{ Program.AddComposite(ELocomotionConditionOp::Or, Conditions.Num()) };
+
+	for (const auto& Condition : Conditions)
+	{
+		Program.CompileChild(Condition);
+	}
+
+	Program.FinishInstruction(Index);
+}
@@ -0,0 +1,29 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Condition/LocomotionCondition.h"
+
+#include "LocomotionCondition_Or.generated.h"
+
+
+/**
+ * Determined by whether any of the conditions can be entered
+ */
+UCLASS(meta = (DisplayName = "Condition Or"))
+class ULocomotionCondition_Or : public ULocomotionCondition
+{
+	GENERATED_BODY()
+public:
+	virtual bool CanEnter(const ULocomotionComponent* LC) const override;
+	virtual ELocomotionConditionInput GetDependentInputs() const override;
+	virtual void Compile(FLocomotionConditionProgram& Program) const override;
+
+public:
+	//
+	// Conditions to be combined. None is treated as a condition that can always be entered.
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Instanced, Category = "Movement Condition")
+	TArray<TObjectPtr<const ULocomotionCondition>> Conditions;
+
+};
@@ -0,0 +1,21 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionCondition_SpeedRange.h"
+
+#include "LocomotionComponent.h"
+#include "Type/LocomotionConditionProgram.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionCondition_SpeedRange)
+
+
+bool ULocomotionCondition_SpeedRange::CanEnter(const ULocomotionComponent* LC) const
+{
+	const auto Speed{ LC->GetLocomotionState().Speed };
+
+	return (Speed >= MinSpeed) && (Speed <= MaxSpeed);
+}
+
+void ULocomotionCondition_SpeedRange::Compile(FLocomotionConditionProgram& Program) const
+{
+	Program.AddInstruction(ELocomotionConditionOp::SpeedRange, MinSpeed, MaxSpeed);
+}
@@ -0,0 +1,29 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Condition/LocomotionCondition.h"
+
+#include "LocomotionCondition_SpeedRange.generated.h"
+
+
+/**
+ * Determined by whether the speed of the character is within the range
+ */
+UCLASS(meta = (DisplayName = "Condition Speed Range"))
+class ULocomotionCondition_SpeedRange : public ULocomotionCondition
+{
+	GENERATED_BODY()
+public:
+	virtual bool CanEnter(const ULocomotionComponent* LC) const override;
+	virtual ELocomotionConditionInput GetDependentInputs() const override { return ELocomotionConditionInput::Speed; }
+	virtual void Compile(FLocomotionConditionProgram& Program) const override;
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement Condition", Meta = (ClampMin = 0, ForceUnits = "cm/s"))
+	float MinSpeed{ 0.0f };
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement Condition", Meta = (ClampMin = 0, ForceUnits = "cm/s"))
+	float MaxSpeed{ 10000.0f };
+
+};
@@ -0,0 +1,18 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionCondition_TagQuery.h"
+
+#include "Type/LocomotionConditionProgram.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionCondition_TagQuery)
+
+
+bool ULocomotionCondition_TagQuery::CanEnter(const ULocomotionComponent* LC) const
+{
+	return Query.Matches(FLocomotionConditionContext(LC).GetStateTags());
+}
+
+void ULocomotionCondition_TagQuery::Compile(FLocomotionConditionProgram& Program) const
+{
+	Program.AddInstruction(ELocomotionConditionOp::TagQuery, 0.0f, 0.0f, Program.AddTagQuery(Query));
+}
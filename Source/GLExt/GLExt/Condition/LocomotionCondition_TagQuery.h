@@ -0,0 +1,29 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Condition/LocomotionCondition.h"
+
+#include "LocomotionCondition_TagQuery.generated.h"
+
+
+/**
+ * Determined by the query against the current state tags of the character
+ * 
+ * Tips:
+ *	The query is matched against LocomotionMode, RotationMode, Stance, Gait and LocomotionAction.
+ */
+UCLASS(meta = (DisplayName = "Condition Tag Query"))
+class ULocomotionCondition_TagQuery : public ULocomotionCondition
+{
+	GENERATED_BODY()
+public:
+	virtual bool CanEnter(const ULocomotionComponent* LC) const override;
+	virtual ELocomotionConditionInput GetDependentInputs() const override { return ELocomotionConditionInput::StateTags; }
+	virtual void Compile(FLocomotionConditionProgram& Program) const override;
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement Condition")
+	FGameplayTagQuery Query;
+
+};
@@ -4,6 +4,8 @@
 
 #include "Engine/DataAsset.h"
 
+#include "CustomMovement/CustomMovementStateBlock.h"
+
 #include "GameplayTagContainer.h"
 
 #include "CustomMovementProcess.generated.h"
@@ -14,6 +16,11 @@ class ULocomotionComponent;
 /**
  * Movement processing that can be added to LocomotionComponent
  * Used in CustomMovementMode
+ * 
+ * Tips:
+ *	By default, an instance is created for each LocomotionComponent.
+ *	If bStateless is true, one instance is shared by all components using the same LocomotionData,
+ *	and per-character data must be kept in the state struct passed to the XXXWithState functions instead of members.
  */
 UCLASS(Abstract)
 class GLEXT_API UCustomMovementProcess : public UObject
@@ -23,10 +30,53 @@ public:
 	UCustomMovementProcess(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
 
 #if WITH_EDITORONLY_DATA
+	/**
+	 * Add assets used by this process to the asset bundles of LocomotionData.
+	 * 
+	 * Tips:
+	 *	They are streamed together with the class of this process before LocomotionComponent is initialized.
+	 */
 	virtual void AddAdditionalAssetBundleData(FAssetBundleData& AssetBundleData) {}
 #endif
 
 
+protected:
+	//
+	// Whether this process has no per-character mutable members and can be shared between characters
+	//
+	UPROPERTY(EditDefaultsOnly, Category = "Process")
+	bool bStateless{ false };
+
+	//
+	// Type of the per-character state passed to the XXXWithState functions. None if not required.
+	// 
+	// Tips:
+	//	Set in the constructor of the subclass, e.g. StateStruct = FMyMovementState::StaticStruct();
+	//
+	UPROPERTY(VisibleDefaultsOnly, Category = "Process")
+	TObjectPtr<const UScriptStruct> StateStruct{ nullptr };
+
+public:
+	bool IsStateless() const { return bStateless; }
+
+	const UScriptStruct* GetStateStruct() const { return StateStruct; }
+
+public:
+	/**
+	 * The actual processing of this Movement with the per-character state.
+	 */
+	virtual void PhysMovementWithState(ULocomotionComponent* LC, FCustomMovementStateView State, float DeltaTime, int32 Iterations) { PhysMovement(LC, DeltaTime, Iterations); }
+
+	/**
+	 * Called when the processing of this Movement starts with the per-character state.
+	 */
+	virtual void OnMovementStartWithState(const ULocomotionComponent* LC, FCustomMovementStateView State) { OnMovementStart(LC); }
+
+	/**
+	 * Called when this Movement finishes processing with the per-character state.
+	 */
+	virtual void OnMovementEndWithState(const ULocomotionComponent* LC, FCustomMovementStateView State) { OnMovementEnd(LC); }
+
 public:
 	/**
 	 * The actual processing of this Movement.
@@ -0,0 +1,84 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "CustomMovementStateBlock.h"
+
+#include "CustomMovementProcess.h"
+
+#include "UObject/GarbageCollection.h"
+
+
+void FCustomMovementStateBlock::Build(const TArray<TObjectPtr<UCustomMovementProcess>>& Processes)
+{
+	Reset();
+
+	// Lay out the states of all processes in one block
+
+	int32 Size{ 0 };
+	int32 Alignment{ 1 };
+
+	Slots.SetNum(Processes.Num());
+
+	for (int32 Index{ 0 }; Index < Processes.Num(); ++Index)
+	{
+		const auto* Struct{ Processes[Index] ? Processes[Index]->GetStateStruct() : nullptr };
+
+		if (!Struct)
+		{
+			continue;
+		}
+
+		const auto StructAlignment{ Struct->GetMinAlignment() };
+
+		auto& Slot{ Slots[Index] };
+		Slot.Struct = Struct;
+		Slot.Offset = Align(Size, StructAlignment);
+
+		Size = Slot.Offset + Struct->GetStructureSize();
+		Alignment = FMath::Max(Alignment, StructAlignment);
+	}
+
+	if (Size <= 0)
+	{
+		return;
+	}
+
+	Memory = static_cast<uint8*>(FMemory::Malloc(Size, Alignment));
+
+	for (const auto& Slot : Slots)
+	{
+		if (Slot.Struct)
+		{
+			Slot.Struct->InitializeStruct(Memory + Slot.Offset);
+		}
+	}
+}
+
+void FCustomMovementStateBlock::Reset()
+{
+	if (Memory)
+	{
+		for (const auto& Slot : Slots)
+		{
+			if (Slot.Struct)
+			{
+				Slot.Struct->DestroyStruct(Memory + Slot.Offset);
+			}
+		}
+
+		FMemory::Free(Memory);
+		Memory = nullptr;
+	}
+
+	Slots.Reset();
+}
+
+void FCustomMovementStateBlock::AddReferencedObjects(FReferenceCollector& Collector, const UObject* ReferencingObject)
+{
+	for (const auto& Slot : Slots)
+	{
+		if (Slot.Struct)
+		{
+			Collector.AddPropertyReferencesWithStructARO(Slot.Struct, Memory + Slot.Offset, ReferencingObject);
+		}
+	}
+}
@@ -0,0 +1,96 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "UObject/Class.h"
+
+class UCustomMovementProcess;
+class FReferenceCollector;
+
+
+/**
+ * Typed view of the per-character state of CustomMovementProcess
+ */
+struct GLEXT_API FCustomMovementStateView
+{
+public:
+	FCustomMovementStateView() {}
+	FCustomMovementStateView(const UScriptStruct* InStruct, uint8* InMemory) : Struct(InStruct), Memory(InMemory) {}
+
+protected:
+	const UScriptStruct* Struct{ nullptr };
+
+	uint8* Memory{ nullptr };
+
+public:
+	bool IsValid() const { return Memory != nullptr; }
+
+	const UScriptStruct* GetScriptStruct() const { return Struct; }
+
+	uint8* GetMemory() const { return Memory; }
+
+	/**
+	 * Returns the state as the type. The type must match the state struct declared by the process.
+	 */
+	template<typename T>
+	T& Get() const
+	{
+		check(Memory && Struct && Struct->IsChildOf(T::StaticStruct()));
+		return *reinterpret_cast<T*>(Memory);
+	}
+
+};
+
+
+/**
+ * Single allocation that holds the per-character states of all CustomMovementProcesses of a component
+ */
+class GLEXT_API FCustomMovementStateBlock
+{
+public:
+	FCustomMovementStateBlock() {}
+	~FCustomMovementStateBlock() { Reset(); }
+
+	FCustomMovementStateBlock(const FCustomMovementStateBlock&) = delete;
+	FCustomMovementStateBlock& operator=(const FCustomMovementStateBlock&) = delete;
+
+protected:
+	struct FSlot
+	{
+		const UScriptStruct* Struct{ nullptr };
+
+		int32 Offset{ 0 };
+	};
+
+	//
+	// Slots of the states indexed by the slot of the processes (Struct is nullptr if the process has no state)
+	//
+	TArray<FSlot> Slots;
+
+	uint8* Memory{ nullptr };
+
+public:
+	/**
+	 * Allocate and initialize the states required by the processes
+	 */
+	void Build(const TArray<TObjectPtr<UCustomMovementProcess>>& Processes);
+
+	/**
+	 * Destroy and free all states
+	 */
+	void Reset();
+
+	/**
+	 * Returns the state of the process in the slot
+	 */
+	FCustomMovementStateView GetState(int32 Slot) const
+	{
+		return (Slots.IsValidIndex(Slot) && Slots[Slot].Struct) ? FCustomMovementStateView(Slots[Slot].Struct, Memory + Slots[Slot].Offset) : FCustomMovementStateView();
+	}
+
+	/**
+	 * Report the object references held by the states
+	 */
+	void AddReferencedObjects(FReferenceCollector& Collector, const UObject* ReferencingObject);
+
+};
@@ -0,0 +1,53 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionAnimInstanceProxy.h"
+
+#include "CharacterAnimInstance.h"
+#include "LocomotionComponent.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionAnimInstanceProxy)
+
+
+void FLocomotionAnimInstanceProxy::PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds)
+{
+	Super::PreUpdate(InAnimInstance, DeltaSeconds);
+
+	const auto* AnimInstance{ Cast<UCharacterAnimInstance>(InAnimInstance) };
+	const auto* LocomotionComponent{ AnimInstance ? AnimInstance->CharacterMovement.Get() : nullptr };
+
+	if (!IsValid(LocomotionComponent))
+	{
+		bHasNewSnapshot = false;
+		bFollowingLeader = false;
+		return;
+	}
+
+	// Followers copy the states of the leader instead of the snapshot
+
+	const auto* Leader{ AnimInstance->GetLeader() };
+
+	bFollowingLeader = IsValid(Leader);
+
+	if (bFollowingLeader)
+	{
+		const auto& PublishedStates{ Leader->GetLeaderStates() };
+
+		bHasNewLeaderStates = (PublishedStates.SequenceNumber != LeaderStates.SequenceNumber);
+
+		if (bHasNewLeaderStates)
+		{
+			LeaderStates = PublishedStates;
+		}
+
+		return;
+	}
+
+	const auto& PublishedSnapshot{ LocomotionComponent->GetAnimSnapshot() };
+
+	bHasNewSnapshot = (PublishedSnapshot.SequenceNumber != Snapshot.SequenceNumber);
+
+	if (bHasNewSnapshot)
+	{
+		Snapshot = PublishedSnapshot;
+	}
+}
@@ -0,0 +1,84 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Animation/AnimInstanceProxy.h"
+
+#include "Type/LocomotionAnimSnapshot.h"
+#include "Type/LocomotionAnimFollowerTypes.h"
+
+#include "LocomotionAnimInstanceProxy.generated.h"
+
+
+/**
+ * Proxy of UCharacterAnimInstance that receives the locomotion snapshot of ULocomotionComponent
+ * 
+ * Tips:
+ *	The snapshot is copied once in PreUpdate() on the game thread,
+ *	and UCharacterAnimInstance reads it in the thread-safe update to compute the animation states.
+ *	When the anim instance follows the anim instance of the main mesh, the states of the leader are copied instead.
+ */
+USTRUCT()
+struct GLEXT_API FLocomotionAnimInstanceProxy : public FAnimInstanceProxy
+{
+	GENERATED_BODY()
+public:
+	FLocomotionAnimInstanceProxy() {}
+	explicit FLocomotionAnimInstanceProxy(UAnimInstance* InAnimInstance) : FAnimInstanceProxy(InAnimInstance) {}
+
+protected:
+	//
+	// Snapshot copied from ULocomotionComponent in this update
+	//
+	FLocomotionAnimSnapshot Snapshot;
+
+	//
+	// Whether the snapshot has been published since the previous update
+	//
+	bool bHasNewSnapshot{ false };
+
+	//
+	// States of the leader copied in this update
+	//
+	FLocomotionAnimLeaderStates LeaderStates;
+
+	//
+	// Whether the anim instance follows the states of the leader in this update
+	//
+	bool bFollowingLeader{ false };
+
+	//
+	// Whether the states of the leader have been published since the previous update
+	//
+	bool bHasNewLeaderStates{ false };
+
+public:
+	/**
+	 * Returns the snapshot copied in this update
+	 */
+	const FLocomotionAnimSnapshot& GetSnapshot() const { return Snapshot; }
+
+	/**
+	 * Returns whether the snapshot has been published since the previous update
+	 */
+	bool HasNewSnapshot() const { return bHasNewSnapshot; }
+
+	/**
+	 * Returns the states of the leader copied in this update
+	 */
+	const FLocomotionAnimLeaderStates& GetLeaderStates() const { return LeaderStates; }
+
+	/**
+	 * Returns whether the anim instance follows the states of the leader in this update
+	 */
+	bool IsFollowingLeader() const { return bFollowingLeader; }
+
+	/**
+	 * Returns whether the states of the leader have been published since the previous update
+	 */
+	bool HasNewLeaderStates() const { return bHasNewLeaderStates; }
+
+protected:
+	virtual void PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds) override;
+
+};
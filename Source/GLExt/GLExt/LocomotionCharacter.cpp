@@ -15,7 +15,8 @@
 
 
 ALocomotionCharacter::ALocomotionCharacter(const FObjectInitializer& ObjectInitializer)
-	: Super(ObjectInitializer.SetDefaultSubobjectClass<ULocomotionComponent>(ACharacter::CharacterMovementComponentName))
+	: Super(ObjectInitializer
+		.SetDefaultSubobjectClass<ULocomotionComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Do not apply Controller rotation.
 
@@ -0,0 +1,19 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionCharacter_Budgeted.h"
+
+#include "SkeletalMeshComponentBudgeted.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionCharacter_Budgeted)
+
+
+ALocomotionCharacter_Budgeted::ALocomotionCharacter_Budgeted(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<USkeletalMeshComponentBudgeted>(ACharacter::MeshComponentName))
+{
+	// The significance for the animation budget allocator is calculated by LocomotionComponent from the locomotion states
+
+	if (auto* BudgetedMeshComp{ Cast<USkeletalMeshComponentBudgeted>(GetMesh()) })
+	{
+		BudgetedMeshComp->SetAutoCalculateSignificance(false);
+	}
+}
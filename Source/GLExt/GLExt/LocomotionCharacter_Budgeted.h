@@ -0,0 +1,24 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "LocomotionCharacter.h"
+
+#include "LocomotionCharacter_Budgeted.generated.h"
+
+
+/**
+ * Locomotion character whose main mesh is ticked by the animation budget allocator
+ * 
+ * Tips:
+ *	The main mesh is a USkeletalMeshComponentBudgeted and its significance is calculated by LocomotionComponent from the locomotion states.
+ *	(See FLocomotionAnimBudgetSettings)
+ */
+UCLASS()
+class GLEXT_API ALocomotionCharacter_Budgeted : public ALocomotionCharacter
+{
+	GENERATED_BODY()
+public:
+	explicit ALocomotionCharacter_Budgeted(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+};
@@ -5,7 +5,6 @@
 #include "CharacterAnimInstance.h"
 #include "CustomMovement/CustomMovementProcess.h"
 #include "GameplayTag/GLETags_Status.h"
-#include "LocomotionGeneralNameStatics.h"
 #include "LocomotionFunctionLibrary.h"
 #include "LocomotionCharacter.h"
 #include "LocomotionData.h"
@@ -17,16 +16,132 @@
 #include "InitState/InitStateComponent.h"
 #include "InitState/InitStateTags.h"
 
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
 #include "Net/UnrealNetwork.h"
 #include "Net/Core/PushModel/PushModel.h"
 #include "GameFramework/GameNetworkManager.h"
 #include "Components/GameFrameworkComponentManager.h"
 #include "Components/SkeletalMeshComponent.h"
+#include "SkeletalMeshComponentBudgeted.h"
+#include "IAnimationBudgetAllocator.h"
 #include "Components/CapsuleComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GameFramework/PlayerController.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "Misc/AutomationTest.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Components/StaticMeshComponent.h"
+#endif
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionComponent)
 
 
+DECLARE_DWORD_COUNTER_STAT(TEXT("Config Resolves"), STAT_LocomotionComponent_ConfigResolves, STATGROUP_Locomotion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Config Resolves Skipped"), STAT_LocomotionComponent_ConfigResolvesSkipped, STATGROUP_Locomotion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("LOD Full Updates"), STAT_LocomotionComponent_LODFullUpdates, STATGROUP_Locomotion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("LOD Reduced Updates"), STAT_LocomotionComponent_LODReducedUpdates, STATGROUP_Locomotion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("LOD Tier 0"), STAT_LocomotionComponent_LODTier0, STATGROUP_Locomotion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("LOD Tier 1"), STAT_LocomotionComponent_LODTier1, STATGROUP_Locomotion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("LOD Tier 2"), STAT_LocomotionComponent_LODTier2, STATGROUP_Locomotion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("LOD Tier 3+"), STAT_LocomotionComponent_LODTier3, STATGROUP_Locomotion);
+
+static int32 GLocomotionHeadlessMode{ 1 };
+static FAutoConsoleVariableRef CVarLocomotionHeadlessMode(
+	TEXT("glext.Headless.Mode"),
+	GLocomotionHeadlessMode,
+	TEXT("Profile of LocomotionComponent that skips values only read by animation. Applied to components that begin play after the change.\n")
+	TEXT("0: Disabled\n")
+	TEXT("1: Enabled on dedicated servers (default)\n")
+	TEXT("2: Enabled everywhere"),
+	ECVF_Default);
+
+#if !UE_BUILD_SHIPPING
+static bool GLocomotionLogTrajectory{ false };
+static FAutoConsoleVariableRef CVarLogLocomotionTrajectory(
+	TEXT("glext.Headless.LogTrajectory"),
+	GLocomotionLogTrajectory,
+	TEXT("Log the authoritative location, rotation and velocity of each character after every move.\n")
+	TEXT("Compare the logs of the same session recorded with different glext.Headless.Mode to verify that the headless profile does not change the trajectories."),
+	ECVF_Cheat);
+#endif
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Floor Cache Hits"), STAT_LocomotionComponent_FloorCacheHits, STATGROUP_Locomotion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Floor Cache Misses"), STAT_LocomotionComponent_FloorCacheMisses, STATGROUP_Locomotion);
+
+static bool GLocomotionEnableFloorCache{ true };
+static FAutoConsoleVariableRef CVarEnableFloorCache(
+	TEXT("glext.FloorCache.Enable"),
+	GLocomotionEnableFloorCache,
+	TEXT("Whether the floor found by ComputeFloorDist() is reused while the character stays on a static floor."),
+	ECVF_Default);
+
+static float GLocomotionFloorCacheTolerance{ 0.1f };
+static FAutoConsoleVariableRef CVarFloorCacheTolerance(
+	TEXT("glext.FloorCache.Tolerance"),
+	GLocomotionFloorCacheTolerance,
+	TEXT("Distance (cm) the capsule can move while the cached floor is reused."),
+	ECVF_Default);
+
+static float GLocomotionFloorCacheMaxAge{ 1.0f };
+static FAutoConsoleVariableRef CVarFloorCacheMaxAge(
+	TEXT("glext.FloorCache.MaxAge"),
+	GLocomotionFloorCacheMaxAge,
+	TEXT("Time (s) after which the cached floor is checked again even if the capsule has not moved."),
+	ECVF_Default);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Floor Probes Issued"), STAT_LocomotionComponent_FloorProbesIssued, STATGROUP_Locomotion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Floor Probes Used"), STAT_LocomotionComponent_FloorProbesUsed, STATGROUP_Locomotion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Floor Probes Rejected"), STAT_LocomotionComponent_FloorProbesRejected, STATGROUP_Locomotion);
+
+static bool GLocomotionEnableAsyncFloorProbe{ true };
+static FAutoConsoleVariableRef CVarEnableAsyncFloorProbe(
+	TEXT("glext.AsyncFloor.Enable"),
+	GLocomotionEnableAsyncFloorProbe,
+	TEXT("Whether the floor of AI and simulated proxies is swept asynchronously one frame ahead."),
+	ECVF_Default);
+
+static float GLocomotionAsyncFloorProbeTolerance{ 2.0f };
+static FAutoConsoleVariableRef CVarAsyncFloorProbeTolerance(
+	TEXT("glext.AsyncFloor.Tolerance"),
+	GLocomotionAsyncFloorProbeTolerance,
+	TEXT("Horizontal distance (cm) between the predicted and the actual capsule location at which the asynchronous floor sweep is still used."),
+	ECVF_Default);
+
+static bool GLocomotionEnableLOD{ true };
+static FAutoConsoleVariableRef CVarEnableLocomotionLOD(
+	TEXT("glext.LOD.Enable"),
+	GLocomotionEnableLOD,
+	TEXT("Whether the locomotion of simulated proxies and AI is updated with the LOD tiers of LocomotionData."),
+	ECVF_Default);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Anim Budget Updates"), STAT_LocomotionComponent_AnimBudgetUpdates, STATGROUP_Locomotion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Anim Budget Never Skipped"), STAT_LocomotionComponent_AnimBudgetNeverSkipped, STATGROUP_Locomotion);
+
+static bool GLocomotionEnableIdlePoseFreeze{ true };
+static FAutoConsoleVariableRef CVarEnableIdlePoseFreeze(
+	TEXT("glext.Anim.IdlePoseFreeze"),
+	GLocomotionEnableIdlePoseFreeze,
+	TEXT("Whether the pose of characters at rest is frozen when bFreezeIdlePose of LocomotionData is enabled."),
+	ECVF_Default);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("View Rotation Uploads Sent"), STAT_LocomotionComponent_ViewRotationUploadsSent, STATGROUP_Locomotion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("View Rotation Uploads Deferred"), STAT_LocomotionComponent_ViewRotationUploadsDeferred, STATGROUP_Locomotion);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Desired State Changes Applied"), STAT_LocomotionComponent_DesiredStateChangesApplied, STATGROUP_Locomotion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Desired State Changes Rejected"), STAT_LocomotionComponent_DesiredStateChangesRejected, STATGROUP_Locomotion);
+
+static float GLocomotionMaxDesiredStateChangesPerSecond{ 20.0f };
+static FAutoConsoleVariableRef CVarMaxDesiredStateChangesPerSecond(
+	TEXT("glext.Network.MaxDesiredStateChangesPerSecond"),
+	GLocomotionMaxDesiredStateChangesPerSecond,
+	TEXT("Maximum number of changes of the desired RotationMode, Stance and Gait per second accepted from each owning client (0 for unlimited)."),
+	ECVF_Default);
+
 const FName ULocomotionComponent::NAME_ActorFeatureName("Locomotion");
 
 ULocomotionComponent::ULocomotionComponent(const FObjectInitializer& ObjectInitializer)
@@ -64,6 +179,14 @@ ULocomotionComponent::ULocomotionComponent(const FObjectInitializer& ObjectIniti
 	Gait					= TAG_Status_Gait_Walking;
 }
 
+void ULocomotionComponent::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
+{
+	Super::AddReferencedObjects(InThis, Collector);
+
+	auto* This{ CastChecked<ULocomotionComponent>(InThis) };
+	This->CustomMovementStates.AddReferencedObjects(Collector, This);
+}
+
 #if WITH_EDITOR
 bool ULocomotionComponent::CanEditChange(const FProperty* Property) const
 {
@@ -86,9 +209,7 @@ void ULocomotionComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>&
 	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, DesiredGait, Parameters);
 	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, DesiredRotationMode, Parameters);
 
-	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, ReplicatedViewRotation, Parameters);
-	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, InputDirection, Parameters);
-	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, DesiredVelocityYawAngle, Parameters);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, ReplicatedIntent, Parameters);
 }
 
 FNetworkPredictionData_Client* ULocomotionComponent::GetPredictionData_Client() const
@@ -142,6 +263,19 @@ void ULocomotionComponent::BeginPlay()
 
 	ensureMsgf(TryToChangeInitState(TAG_InitState_Spawned), TEXT("[%s] on [%s]."), *GetNameSafe(this), *GetNameSafe(GetOwner()));
 
+	UpdateHeadlessProfile();
+
+	// Join the batched update of the locomotion values
+
+	if (auto* StateSubsystem{ UWorld::GetSubsystem<ULocomotionStateSubsystem>(GetWorld()) })
+	{
+		StateSubsystem->RegisterComponent(this);
+	}
+
+	// Start streaming the classes required by the locomotion data set at the CDO stage
+
+	LoadCustomMovementProcesses();
+
 	// Check if initialization process can continue
 
 	CheckDefaultInitialization();
@@ -151,6 +285,17 @@ void ULocomotionComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	UnregisterInitStateFeature();
 
+	if (auto* StateSubsystem{ UWorld::GetSubsystem<ULocomotionStateSubsystem>(GetWorld()) })
+	{
+		StateSubsystem->UnregisterComponent(this);
+	}
+
+	if (CustomMovementProcessesLoadHandle.IsValid())
+	{
+		CustomMovementProcessesLoadHandle->CancelHandle();
+		CustomMovementProcessesLoadHandle.Reset();
+	}
+
 	Super::EndPlay(EndPlayReason);
 }
 
@@ -182,6 +327,13 @@ bool ULocomotionComponent::CanChangeInitState(UGameFrameworkComponentManager* Ma
 			return false;
 		}
 
+		// Wait for the classes of CustomMovementProcess to be streamed
+
+		if (IsLoadingCustomMovementProcesses())
+		{
+			return false;
+		}
+
 		return CanChangeInitStateToDataAvailable(Manager);
 	}
 
@@ -190,7 +342,7 @@ bool ULocomotionComponent::CanChangeInitState(UGameFrameworkComponentManager* Ma
 	 */
 	else if (CurrentState == TAG_InitState_DataAvailable && DesiredState == TAG_InitState_DataInitialized)
 	{
-		if (LocomotionData == nullptr)
+		if ((LocomotionData == nullptr) || IsLoadingCustomMovementProcesses())
 		{
 			return false;
 		}
@@ -290,14 +442,15 @@ void ULocomotionComponent::ApplyLocomotionData()
 	SetDesiredStance(LocomotionData->DefaultStance);
 	SetDesiredGait(LocomotionData->DefaultGait);
 
+	MarkLocomotionConfigsDirty();
 	UpdateLocomotionConfigs();
 
 	SetReplicatedViewRotation(LocomotionCharacter->GetViewRotationSuperClass());
 
-	ViewState.NetworkSmoothing.InitialRotation = ReplicatedViewRotation;
-	ViewState.NetworkSmoothing.Rotation = ReplicatedViewRotation;
-	ViewState.Rotation = ReplicatedViewRotation;
-	ViewState.PreviousYawAngle = UE_REAL_TO_FLOAT(ReplicatedViewRotation.Yaw);
+	ViewState.NetworkSmoothing.InitialRotation = ReplicatedIntent.ViewRotation;
+	ViewState.NetworkSmoothing.Rotation = ReplicatedIntent.ViewRotation;
+	ViewState.Rotation = ReplicatedIntent.ViewRotation;
+	ViewState.PreviousYawAngle = UE_REAL_TO_FLOAT(ReplicatedIntent.ViewRotation.Yaw);
 
 	const auto& ActorTransform{ CharacterOwner->GetActorTransform() };
 
@@ -312,41 +465,51 @@ void ULocomotionComponent::ApplyLocomotionData()
 	LocomotionState.VelocityYawAngle = UE_REAL_TO_FLOAT(LocomotionState.Rotation.Yaw);
 }
 
-void ULocomotionComponent::CreateCustomMovementProcesses()
+void ULocomotionComponent::LoadCustomMovementProcesses()
 {
-	CustomMovementProcesses.Empty();
+	if (CustomMovementProcessesLoadHandle.IsValid())
+	{
+		CustomMovementProcessesLoadHandle->CancelHandle();
+		CustomMovementProcessesLoadHandle.Reset();
+	}
 
-	auto SoftClassesMap{ LocomotionData->CustomMovementProcesses };
-	for (const auto& KVP : SoftClassesMap)
+	if (!LocomotionData)
 	{
-		const auto& CustomMoveIdx{ KVP.Key };
-		const auto& SoftClass{ KVP.Value };
+		return;
+	}
 
-		if (SoftClass.IsNull())
-		{
-			continue;
-		}
+	const auto Delegate{ FStreamableDelegate::CreateUObject(this, &ThisClass::HandleCustomMovementProcessesLoaded) };
 
-		const auto* ProcessClass{ SoftClass.LoadSynchronous() };
+	// If LocomotionData is registered as a primary asset, load its bundle including the assets added by each process
 
-		if (!ProcessClass)
-		{
-			continue;
-		}
+	auto& AssetManager{ UAssetManager::Get() };
+	const auto PrimaryAssetId{ LocomotionData->GetPrimaryAssetId() };
 
-		auto* NewProcess{ NewObject<UCustomMovementProcess>(this, ProcessClass) };
+	if (PrimaryAssetId.IsValid() && AssetManager.GetPrimaryAssetPath(PrimaryAssetId).IsValid())
+	{
+		CustomMovementProcessesLoadHandle = AssetManager.LoadPrimaryAsset(PrimaryAssetId, { ULocomotionData::NAME_LocomotionBundle }, Delegate, FStreamableManager::AsyncLoadHighPriority);
+	}
 
-		if (!NewProcess)
+	// Otherwise, stream only the classes
+
+	else
+	{
+		TArray<FSoftObjectPath> Paths;
+		LocomotionData->GetUnloadedCustomMovementProcessPaths(Paths);
+
+		if (Paths.IsEmpty())
 		{
-			continue;
+			return;
 		}
 
-		CustomMovementProcesses.Add(CustomMoveIdx, NewProcess);
+		CustomMovementProcessesLoadHandle = AssetManager.GetStreamableManager().RequestAsyncLoad(Paths, Delegate, FStreamableManager::AsyncLoadHighPriority);
 	}
 }
 
-void ULocomotionComponent::HandleLocomotionDataUpdated()
+void ULocomotionComponent::HandleCustomMovementProcessesLoaded()
 {
+	// If initialization has been completed with the previous data, apply the new data now
+
 	if (HasReachedInitState(TAG_InitState_DataInitialized))
 	{
 		ApplyLocomotionData();
@@ -357,12 +520,83 @@ void ULocomotionComponent::HandleLocomotionDataUpdated()
 	}
 }
 
+bool ULocomotionComponent::IsLoadingCustomMovementProcesses() const
+{
+	return CustomMovementProcessesLoadHandle.IsValid() && CustomMovementProcessesLoadHandle->IsLoadingInProgress();
+}
+
+void ULocomotionComponent::CreateCustomMovementProcesses()
+{
+	CustomMovementProcesses.Reset();
+	CustomMovementProcessesData = LocomotionData;
+
+	for (const auto& CustomMoveIdx : LocomotionData->GetCustomMovementProcessModes())
+	{
+		auto& NewProcess{ CustomMovementProcesses.AddDefaulted_GetRef() };
+
+		const auto& SoftClass{ LocomotionData->CustomMovementProcesses.FindChecked(CustomMoveIdx) };
+
+		// Classes should have been streamed before initialization, so only load them here if streaming failed
+
+		const auto* ProcessClass{ SoftClass.Get() };
+
+		if (!ProcessClass)
+		{
+			UE_LOG(LogGLE, Warning, TEXT("CustomMovementProcess(%s) was not streamed before initialization and is loaded synchronously."), *SoftClass.ToString());
+
+			ProcessClass = SoftClass.LoadSynchronous();
+		}
+
+		if (!ProcessClass)
+		{
+			continue;
+		}
+
+		// Stateless processes are shared by all components using the same LocomotionData
+
+		NewProcess = ProcessClass->GetDefaultObject<UCustomMovementProcess>()->IsStateless() ?
+			LocomotionData->GetSharedCustomMovementProcess(CustomMoveIdx, ProcessClass) :
+			NewObject<UCustomMovementProcess>(this, ProcessClass);
+	}
+
+	// Allocate the per-character states of all processes
+
+	CustomMovementStates.Build(CustomMovementProcesses);
+}
+
+UCustomMovementProcess* ULocomotionComponent::GetCustomMovementProcess(uint8 InCustomMovementMode, int32& OutSlot) const
+{
+	OutSlot = CustomMovementProcessesData ? CustomMovementProcessesData->GetCustomMovementProcessSlot(InCustomMovementMode) : INDEX_NONE;
+
+	return CustomMovementProcesses.IsValidIndex(OutSlot) ? CustomMovementProcesses[OutSlot] : nullptr;
+}
+
+void ULocomotionComponent::HandleLocomotionDataUpdated()
+{
+	LoadCustomMovementProcesses();
+
+	// The new data is applied by HandleCustomMovementProcessesLoaded() when streaming is completed
+
+	if (CustomMovementProcessesLoadHandle.IsValid())
+	{
+		return;
+	}
+
+	HandleCustomMovementProcessesLoaded();
+}
+
 void ULocomotionComponent::SetLocomotionData(const ULocomotionData* NewLocomotionData)
 {
 	if (LocomotionData != NewLocomotionData)
 	{
 		LocomotionData = NewLocomotionData;
 
+		// The packed desired states of the client depend on the layout of the locomotion data
+
+		bHasReceivedPackedDesiredStates = false;
+
+		MarkLocomotionConfigsDirty();
+
 		HandleLocomotionDataUpdated();
 	}
 }
@@ -370,98 +604,627 @@ void ULocomotionComponent::SetLocomotionData(const ULocomotionData* NewLocomotio
 #pragma endregion
 
 
-#pragma region Movement Base
+#pragma region Movement Base
+
+void ULocomotionComponent::UpdateBasedRotation(FRotator& FinalRotation, const FRotator& ReducedRotation)
+{
+	const auto& BasedMovement{ CharacterOwner->GetBasedMovement() };
+
+	FVector MovementBaseLocation;
+	FQuat MovementBaseRotation;
+
+	MovementBaseUtility::GetMovementBaseTransform(BasedMovement.MovementBase, BasedMovement.BoneName, MovementBaseLocation, MovementBaseRotation);
+
+	if (!OldBaseQuat.Equals(MovementBaseRotation, UE_SMALL_NUMBER))
+	{
+		const auto DeltaRotation{ (MovementBaseRotation * OldBaseQuat.Inverse()).Rotator() };
+		auto NewControlRotation{ CharacterOwner->Controller->GetControlRotation() };
+
+		NewControlRotation.Pitch += DeltaRotation.Pitch;
+		NewControlRotation.Yaw += DeltaRotation.Yaw;
+		NewControlRotation.Normalize();
+
+		CharacterOwner->Controller->SetControlRotation(NewControlRotation);
+	}
+}
+
+void ULocomotionComponent::UpdateHeadlessProfile()
+{
+	bHeadless = (GLocomotionHeadlessMode >= 2) || ((GLocomotionHeadlessMode == 1) && IsNetMode(NM_DedicatedServer));
+}
+
+void ULocomotionComponent::UpdateUsingAbsoluteRotation() const
+{
+	if (bHeadless)
+	{
+		return;
+	}
+
+	const auto bNotDedicatedServer{ !IsNetMode(NM_DedicatedServer) };
+
+	const auto bAutonomousProxyOnListenServer{ IsNetMode(NM_ListenServer) && CharacterOwner->GetRemoteRole() == ROLE_AutonomousProxy };
+
+	const auto bNonLocallyControllerCharacterWithURO{ CharacterOwner->GetMesh()->ShouldUseUpdateRateOptimizations() && !IsValid(CharacterOwner->GetInstigatorController<APlayerController>()) };
+
+	CharacterOwner->GetMesh()->SetUsingAbsoluteRotation(bNotDedicatedServer && (bAutonomousProxyOnListenServer || bNonLocallyControllerCharacterWithURO));
+}
+
+void ULocomotionComponent::UpdateVisibilityBasedAnimTickOption() const
+{
+	// Also applied in the headless profile, since the server needs the pose of autonomous proxies for root motion
+
+	const auto DefaultTickOption{ CharacterOwner->GetClass()->GetDefaultObject<ACharacter>()->GetMesh()->VisibilityBasedAnimTickOption };
+
+	const auto TargetTickOption
+	{ 
+		ShouldTickPoseWhenNotRendered() ? EVisibilityBasedAnimTickOption::AlwaysTickPose : EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered
+	};
+
+	CharacterOwner->GetMesh()->VisibilityBasedAnimTickOption = (TargetTickOption <= DefaultTickOption) ? TargetTickOption : DefaultTickOption;
+}
+
+bool ULocomotionComponent::ShouldTickPoseWhenNotRendered() const
+{
+	return !IsNetMode(NM_Standalone) && (CharacterOwner->GetLocalRole() > ROLE_AutonomousProxy) && (CharacterOwner->GetRemoteRole() == ROLE_AutonomousProxy);
+}
+
+void ULocomotionComponent::UpdateLocomotionLOD(float DeltaTime)
+{
+	// Upper limit of the time a frame can be reduced by following the URO of the mesh
+
+	static constexpr auto MaxUROReducedTime{ 0.25f };
+
+	LocomotionLODDeltaTime += DeltaTime;
+	LocomotionLODTier = GLocomotionEnableLOD ? EvaluateLocomotionLODTier() : INDEX_NONE;
+
+	if (LocomotionLODTier == INDEX_NONE)
+	{
+		bLocomotionLODReduced = false;
+	}
+	else
+	{
+		const auto& Tier{ LocomotionData->LODTiers[LocomotionLODTier] };
+		const auto* Mesh{ CharacterOwner->GetMesh() };
+
+		const auto bSkippedByURO
+		{
+			(LocomotionLODTier > 0) && Mesh->ShouldUseUpdateRateOptimizations() &&
+			Mesh->AnimUpdateRateParams && Mesh->AnimUpdateRateParams->ShouldSkipUpdate()
+		};
+
+		bLocomotionLODReduced = (LocomotionLODDeltaTime < Tier.UpdateInterval) || (bSkippedByURO && (LocomotionLODDeltaTime < MaxUROReducedTime));
+
+		switch (LocomotionLODTier)
+		{
+		case 0:		INC_DWORD_STAT(STAT_LocomotionComponent_LODTier0); break;
+		case 1:		INC_DWORD_STAT(STAT_LocomotionComponent_LODTier1); break;
+		case 2:		INC_DWORD_STAT(STAT_LocomotionComponent_LODTier2); break;
+		default:	INC_DWORD_STAT(STAT_LocomotionComponent_LODTier3); break;
+		}
+	}
+
+	if (bLocomotionLODReduced)
+	{
+		INC_DWORD_STAT(STAT_LocomotionComponent_LODReducedUpdates);
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_LocomotionComponent_LODFullUpdates);
+	}
+}
+
+int32 ULocomotionComponent::EvaluateLocomotionLODTier() const
+{
+	const auto& Tiers{ LocomotionData->LODTiers };
+
+	if (Tiers.IsEmpty())
+	{
+		return INDEX_NONE;
+	}
+
+	// Characters whose moves are predicted or processed by the server are always updated with full fidelity
+
+	if (CharacterOwner->IsLocallyControlled() || CharacterOwner->IsPlayerControlled() ||
+		(CharacterOwner->GetLocalRole() == ROLE_AutonomousProxy) || (CharacterOwner->GetRemoteRole() == ROLE_AutonomousProxy))
+	{
+		return INDEX_NONE;
+	}
+
+	// There is no viewer on the dedicated server
+
+	if (IsNetMode(NM_DedicatedServer))
+	{
+		return INDEX_NONE;
+	}
+
+	const auto* Mesh{ CharacterOwner->GetMesh() };
+
+	if (!Mesh)
+	{
+		return INDEX_NONE;
+	}
+
+	const auto& Bounds{ Mesh->Bounds };
+
+	// Nearest local viewer (split screen has one per local player)
+
+	const APlayerCameraManager* NearestCameraManager{ nullptr };
+	auto MinDistanceSquared{ TNumericLimits<double>::Max() };
+
+	for (auto It{ GetWorld()->GetPlayerControllerIterator() }; It; ++It)
+	{
+		const auto* PlayerController{ It->Get() };
+		const auto* CameraManager{ PlayerController ? PlayerController->PlayerCameraManager.Get() : nullptr };
+
+		if (CameraManager && PlayerController->IsLocalController())
+		{
+			const auto DistanceSquared{ FVector::DistSquared(CameraManager->GetCameraLocation(), Bounds.Origin) };
+
+			if (DistanceSquared < MinDistanceSquared)
+			{
+				MinDistanceSquared = DistanceSquared;
+				NearestCameraManager = CameraManager;
+			}
+		}
+	}
+
+	if (!NearestCameraManager)
+	{
+		return INDEX_NONE;
+	}
+
+	const auto Distance{ UE_REAL_TO_FLOAT(FMath::Sqrt(MinDistanceSquared)) };
+	const auto HalfFOVTan{ FMath::Tan(FMath::DegreesToRadians(NearestCameraManager->GetFOVAngle() * 0.5f)) };
+
+	// Approximate ratio of the bounding sphere to the screen
+
+	const auto ScreenSize
+	{
+		(Distance * HalfFOVTan > UE_KINDA_SMALL_NUMBER) ? FMath::Min(UE_REAL_TO_FLOAT(Bounds.SphereRadius) / (Distance * HalfFOVTan), 1.0f) : 1.0f
+	};
+
+	const auto bVisible{ Mesh->WasRecentlyRendered() };
+
+	for (auto Index{ 0 }; Index < Tiers.Num(); ++Index)
+	{
+		const auto& Tier{ Tiers[Index] };
+
+		if (((Tier.MaxDistance <= 0.0f) || (Distance <= Tier.MaxDistance)) &&
+			(ScreenSize >= Tier.MinScreenSize) &&
+			(!Tier.bRequireVisible || bVisible))
+		{
+			return Index;
+		}
+	}
+
+	return Tiers.Num() - 1;
+}
+
+void ULocomotionComponent::UpdateMovementBase()
+{
+	const auto& BasedMovement{ CharacterOwner->GetBasedMovement() };
+
+	if (BasedMovement.MovementBase != MovementBase.Primitive || BasedMovement.BoneName != MovementBase.BoneName)
+	{
+		MovementBase.Primitive = BasedMovement.MovementBase;
+		MovementBase.BoneName = BasedMovement.BoneName;
+		MovementBase.bBaseChanged = true;
+	}
+	else
+	{
+		MovementBase.bBaseChanged = false;
+	}
+
+	MovementBase.bHasRelativeLocation = BasedMovement.HasRelativeLocation();
+	MovementBase.bHasRelativeRotation = MovementBase.bHasRelativeLocation && BasedMovement.bRelativeRotation;
+
+	const auto PreviousRotation{ MovementBase.Rotation };
+
+	MovementBaseUtility::GetMovementBaseTransform(BasedMovement.MovementBase, BasedMovement.BoneName, MovementBase.Location, MovementBase.Rotation);
+
+	MovementBase.DeltaRotation = (MovementBase.bHasRelativeLocation && !MovementBase.bBaseChanged) ? (MovementBase.Rotation * PreviousRotation.Inverse()).Rotator() : FRotator::ZeroRotator;
+}
+
+void ULocomotionComponent::UpdateAnimInstanceMovement(float DeltaTime)
+{
+	auto* MainMesh{ ICharacterMeshAccessorInterface::Execute_GetMainMesh(CharacterOwner) };
+
+	if (!MainMesh)
+	{
+		return;
+	}
+
+	auto* AnimIns{ bHeadless ? nullptr : Cast<UCharacterAnimInstance>(MainMesh->GetAnimInstance()) };
+
+	if (AnimIns)
+	{
+		if (!CharacterOwner->GetMesh()->bRecentlyRendered &&
+			(CharacterOwner->GetMesh()->VisibilityBasedAnimTickOption > EVisibilityBasedAnimTickOption::AlwaysTickPose))
+		{
+			AnimIns->MarkPendingUpdate();
+		}
+
+		AnimIns->UpdateRestState(GLocomotionEnableIdlePoseFreeze && LocomotionData->bFreezeIdlePose && IsAtRestForAnimation(), LocomotionData->IdlePoseFreezeDelay, DeltaTime);
+	}
+
+	// Also fed to headless characters and other anim instances, since the allocator does not calculate the significance of the mesh itself
+
+	UpdateAnimBudget(MainMesh, AnimIns);
+}
+
+bool ULocomotionComponent::IsAtRestForAnimation() const
+{
+	if (LocomotionState.bMoving || LocomotionState.bHasInput || LocomotionAction.IsValid())
+	{
+		return false;
+	}
+
+	const auto YawSpeedThreshold{ LocomotionData->IdlePoseFreezeYawSpeedThreshold };
+
+	if ((FMath::Abs(LocomotionState.YawSpeed) > YawSpeedThreshold) || (FMath::Abs(ViewState.YawSpeed) > YawSpeedThreshold))
+	{
+		return false;
+	}
+
+	if (MovementBase.bBaseChanged || !MovementBase.DeltaRotation.IsNearlyZero())
+	{
+		return false;
+	}
+
+	if (!FMath::IsNearlyZero(AnimCurveValues.Get(ELocomotionAnimCurve::RotationYawSpeed)))
+	{
+		return false;
+	}
+
+	// The states are compared with the last published snapshot
+
+	const auto& Snapshot{ GetAnimSnapshot() };
+
+	return (Snapshot.LocomotionMode == LocomotionMode) && (Snapshot.RotationMode == RotationMode) &&
+		(Snapshot.Stance == Stance) && (Snapshot.Gait == Gait) && (Snapshot.LocomotionAction == LocomotionAction);
+}
+
+void ULocomotionComponent::UpdateAnimBudget(USkeletalMeshComponent* MainMesh, const UCharacterAnimInstance* AnimIns) const
+{
+	auto* BudgetedMesh{ Cast<USkeletalMeshComponentBudgeted>(MainMesh) };
+
+	if (!BudgetedMesh || (BudgetedMesh->GetAnimationBudgetHandle() == INDEX_NONE))
+	{
+		return;
+	}
+
+	auto* Allocator{ IAnimationBudgetAllocator::Get(GetWorld()) };
+
+	if (!Allocator || !Allocator->GetEnabled())
+	{
+		return;
+	}
+
+	const auto& Settings{ LocomotionData->AnimBudget };
+
+	const auto bNeverSkip
+	{
+		(AnimIns && AnimIns->IsPendingUpdate()) ||
+		(Settings.bNeverSkipLocallyControlled && CharacterOwner->IsLocallyControlled()) ||
+		(Settings.bNeverSkipInAction && LocomotionAction.IsValid())
+	};
+
+	// Interpolation is not allowed while an update is pending because the last evaluated pose is outdated
+
+	Allocator->SetComponentSignificance(
+		BudgetedMesh,
+		CalculateAnimBudgetSignificance(MainMesh),
+		bNeverSkip,
+		ShouldTickPoseWhenNotRendered(),
+		/* bAllowReducedWork = */ !bNeverSkip,
+		/* bForceInterpolate = */ false);
+
+	INC_DWORD_STAT(STAT_LocomotionComponent_AnimBudgetUpdates);
+
+	if (bNeverSkip)
+	{
+		INC_DWORD_STAT(STAT_LocomotionComponent_AnimBudgetNeverSkipped);
+	}
+}
+
+float ULocomotionComponent::CalculateAnimBudgetSignificance(const USkeletalMeshComponent* MainMesh) const
+{
+	const auto& Settings{ LocomotionData->AnimBudget };
+
+	// Distance to the nearest local viewer
+
+	const auto& Origin{ MainMesh->Bounds.Origin };
+
+	auto MinDistanceSquared{ TNumericLimits<double>::Max() };
+
+	for (auto It{ GetWorld()->GetPlayerControllerIterator() }; It; ++It)
+	{
+		const auto* PlayerController{ It->Get() };
+		const auto* CameraManager{ PlayerController ? PlayerController->PlayerCameraManager.Get() : nullptr };
+
+		if (CameraManager && PlayerController->IsLocalController())
+		{
+			MinDistanceSquared = FMath::Min(MinDistanceSquared, FVector::DistSquared(CameraManager->GetCameraLocation(), Origin));
+		}
+	}
+
+	const auto ReferenceDistanceSquared{ FMath::Square(static_cast<double>(FMath::Max(Settings.ReferenceDistance, 1.0f))) };
+
+	auto Significance{ UE_REAL_TO_FLOAT(ReferenceDistanceSquared / FMath::Max(MinDistanceSquared, ReferenceDistanceSquared)) };
+
+	// Scale by the locomotion states
+
+	if (LocomotionAction.IsValid())
+	{
+		Significance *= Settings.ActionSignificanceScale;
+	}
+	else if (!LocomotionState.bMoving)
+	{
+		Significance *= Settings.IdleSignificanceScale;
+	}
+	else if (const auto* GaitScale{ Settings.GaitSignificanceScales.Find(Gait) })
+	{
+		Significance *= *GaitScale;
+	}
+
+	return Significance;
+}
+
+void ULocomotionComponent::PublishAnimSnapshot()
+{
+	// Also published in the headless profile, since anim instances on the server still tick for montages and root motion
+
+	const auto* MainMesh{ ICharacterMeshAccessorInterface::Execute_GetMainMesh(CharacterOwner) };
+
+	if (!MainMesh || !MainMesh->GetAnimInstance())
+	{
+		return;
+	}
+
+	const auto& FrontSnapshot{ AnimSnapshots[AnimSnapshotIndex] };
+	auto& Snapshot{ AnimSnapshots[AnimSnapshotIndex ^ 1] };
+
+	Snapshot.SequenceNumber = FrontSnapshot.SequenceNumber + 1;
+
+	Snapshot.LocomotionMode = LocomotionMode;
+	Snapshot.RotationMode = RotationMode;
+	Snapshot.Stance = Stance;
+	Snapshot.Gait = Gait;
+	Snapshot.LocomotionAction = LocomotionAction;
+
+	Snapshot.MovementBase = MovementBase;
+
+	Snapshot.ViewRotation = ViewState.Rotation;
+	Snapshot.ViewYawSpeed = ViewState.YawSpeed;
+
+	Snapshot.Locomotion = LocomotionState;
+
+	Snapshot.MaxAcceleration = GetMaxAcceleration();
+	Snapshot.MaxBrakingDeceleration = GetMaxBrakingDeceleration();
+	Snapshot.WalkableFloorZ = GetWalkableFloorZ();
+
+	const auto* Mesh{ CharacterOwner->GetMesh() };
+
+	Snapshot.MeshScale = Mesh ? UE_REAL_TO_FLOAT(Mesh->GetComponentScale().Z) : 1.0f;
+
+	CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleSize(Snapshot.CapsuleRadius, Snapshot.CapsuleHalfHeight);
+
+	AnimSnapshotIndex ^= 1;
+}
+
+#pragma endregion
+
+
+#pragma region Locomotion Mode
+
+namespace LocomotionStatePacking
+{
+	/**
+	 * Pack the state ids of RotationMode, Stance and Gait tags into a bitfield
+	 */
+	static uint32 Pack(const FLocomotionConfigTable& Table
+		, const FGameplayTag& InRotationMode, FLocomotionStateIdCache& RotationModeCache
+		, const FGameplayTag& InStance, FLocomotionStateIdCache& StanceCache
+		, const FGameplayTag& InGait, FLocomotionStateIdCache& GaitCache)
+	{
+		const auto RotationModeBits{ Table.GetStateIdBits(ELocomotionConfigLevel::RotationMode) };
+		const auto StanceBits{ Table.GetStateIdBits(ELocomotionConfigLevel::Stance) };
+
+		const auto RotationModeValue{ static_cast<uint32>(Table.ResolveStateId(ELocomotionConfigLevel::RotationMode, InRotationMode, RotationModeCache) + 1) };
+		const auto StanceValue{ static_cast<uint32>(Table.ResolveStateId(ELocomotionConfigLevel::Stance, InStance, StanceCache) + 1) };
+		const auto GaitValue{ static_cast<uint32>(Table.ResolveStateId(ELocomotionConfigLevel::Gait, InGait, GaitCache) + 1) };
+
+		return RotationModeValue | (StanceValue << RotationModeBits) | (GaitValue << (RotationModeBits + StanceBits));
+	}
+
+	/**
+	 * Unpack the tags of RotationMode, Stance and Gait from a bitfield
+	 * 
+	 * Tips:
+	 *	Unknown states are ignored and the output tag is kept.
+	 *	Returns false without changing any output if a state id is out of range or unused bits are set.
+	 */
+	static bool Unpack(const FLocomotionConfigTable& Table, uint32 PackedStates, FGameplayTag& OutRotationMode, FGameplayTag& OutStance, FGameplayTag& OutGait)
+	{
+		static constexpr ELocomotionConfigLevel Levels[]{ ELocomotionConfigLevel::RotationMode, ELocomotionConfigLevel::Stance, ELocomotionConfigLevel::Gait };
+
+		int32 StateIds[UE_ARRAY_COUNT(Levels)];
+
+		for (auto Index{ 0 }; Index < UE_ARRAY_COUNT(Levels); ++Index)
+		{
+			const auto Bits{ Table.GetStateIdBits(Levels[Index]) };
+
+			StateIds[Index] = static_cast<int32>(PackedStates & ((1u << Bits) - 1)) - 1;
+
+			PackedStates >>= Bits;
+
+			if (StateIds[Index] >= Table.GetNumStates(Levels[Index]))
+			{
+				return false;
+			}
+		}
+
+		if (PackedStates != 0)
+		{
+			return false;
+		}
+
+		FGameplayTag* OutTags[]{ &OutRotationMode, &OutStance, &OutGait };
+
+		for (auto Index{ 0 }; Index < UE_ARRAY_COUNT(Levels); ++Index)
+		{
+			if (StateIds[Index] != INDEX_NONE)
+			{
+				*OutTags[Index] = Table.GetStateTag(Levels[Index], StateIds[Index]);
+			}
+		}
+
+		return true;
+	}
+}
+
+uint32 ULocomotionComponent::PackLocomotionStates()
+{
+	if (!LocomotionData)
+	{
+		return 0;
+	}
+
+	return LocomotionStatePacking::Pack(LocomotionData->GetConfigTable()
+		, RotationMode, RotationModeIdCache
+		, Stance, StanceIdCache
+		, Gait, GaitIdCache);
+}
+
+void ULocomotionComponent::UnpackLocomotionStates(uint32 PackedStates)
+{
+	if (!LocomotionData)
+	{
+		return;
+	}
+
+	LocomotionStatePacking::Unpack(LocomotionData->GetConfigTable(), PackedStates, RotationMode, Stance, Gait);
+}
+
+uint32 ULocomotionComponent::PackDesiredLocomotionStates()
+{
+	if (!LocomotionData)
+	{
+		return 0;
+	}
+
+	return LocomotionStatePacking::Pack(LocomotionData->GetConfigTable()
+		, DesiredRotationMode, DesiredRotationModeIdCache
+		, DesiredStance, DesiredStanceIdCache
+		, DesiredGait, DesiredGaitIdCache);
+}
+
+void ULocomotionComponent::ApplyDesiredLocomotionStates(uint32 PackedDesiredStates)
+{
+	if (!LocomotionData)
+	{
+		return;
+	}
+
+	// Every move carries the desired states of the client, so only the changes made by the client are applied.
+	// Otherwise the desired states set by the server itself would be overwritten by the next move.
 
-void ULocomotionComponent::UpdateBasedRotation(FRotator& FinalRotation, const FRotator& ReducedRotation)
-{
-	const auto& BasedMovement{ CharacterOwner->GetBasedMovement() };
+	if (bHasReceivedPackedDesiredStates && (PackedDesiredStates == LastReceivedPackedDesiredStates))
+	{
+		return;
+	}
 
-	FVector MovementBaseLocation;
-	FQuat MovementBaseRotation;
+	auto NewDesiredRotationMode{ DesiredRotationMode };
+	auto NewDesiredStance{ DesiredStance };
+	auto NewDesiredGait{ DesiredGait };
 
-	MovementBaseUtility::GetMovementBaseTransform(BasedMovement.MovementBase, BasedMovement.BoneName, MovementBaseLocation, MovementBaseRotation);
+	if (!LocomotionStatePacking::Unpack(LocomotionData->GetConfigTable(), PackedDesiredStates, NewDesiredRotationMode, NewDesiredStance, NewDesiredGait))
+	{
+		INC_DWORD_STAT(STAT_LocomotionComponent_DesiredStateChangesRejected);
+		return;
+	}
 
-	if (!OldBaseQuat.Equals(MovementBaseRotation, UE_SMALL_NUMBER))
+	if ((NewDesiredRotationMode == DesiredRotationMode) && (NewDesiredStance == DesiredStance) && (NewDesiredGait == DesiredGait))
 	{
-		const auto DeltaRotation{ (MovementBaseRotation * OldBaseQuat.Inverse()).Rotator() };
-		auto NewControlRotation{ CharacterOwner->Controller->GetControlRotation() };
+		LastReceivedPackedDesiredStates = PackedDesiredStates;
+		bHasReceivedPackedDesiredStates = true;
+		return;
+	}
 
-		NewControlRotation.Pitch += DeltaRotation.Pitch;
-		NewControlRotation.Yaw += DeltaRotation.Yaw;
-		NewControlRotation.Normalize();
+	// Keep the current desired states if the client changes them too frequently.
+	// The change is applied by a later move once the limit allows it.
 
-		CharacterOwner->Controller->SetControlRotation(NewControlRotation);
+	if (!ConsumeDesiredStateChangeToken())
+	{
+		INC_DWORD_STAT(STAT_LocomotionComponent_DesiredStateChangesRejected);
+		return;
 	}
-}
-
-void ULocomotionComponent::UpdateUsingAbsoluteRotation() const
-{
-	const auto bNotDedicatedServer{ !IsNetMode(NM_DedicatedServer) };
 
-	const auto bAutonomousProxyOnListenServer{ IsNetMode(NM_ListenServer) && CharacterOwner->GetRemoteRole() == ROLE_AutonomousProxy };
+	INC_DWORD_STAT(STAT_LocomotionComponent_DesiredStateChangesApplied);
 
-	const auto bNonLocallyControllerCharacterWithURO{ CharacterOwner->GetMesh()->ShouldUseUpdateRateOptimizations() && !IsValid(CharacterOwner->GetInstigatorController<APlayerController>()) };
+	LastReceivedPackedDesiredStates = PackedDesiredStates;
+	bHasReceivedPackedDesiredStates = true;
 
-	CharacterOwner->GetMesh()->SetUsingAbsoluteRotation(bNotDedicatedServer && (bAutonomousProxyOnListenServer || bNonLocallyControllerCharacterWithURO));
+	SetDesiredRotationMode(NewDesiredRotationMode);
+	SetDesiredStance(NewDesiredStance);
+	SetDesiredGait(NewDesiredGait);
 }
 
-void ULocomotionComponent::UpdateVisibilityBasedAnimTickOption() const
+bool ULocomotionComponent::ConsumeDesiredStateChangeToken()
 {
-	const auto DefaultTickOption{ CharacterOwner->GetClass()->GetDefaultObject<ACharacter>()->GetMesh()->VisibilityBasedAnimTickOption };
-
-	const auto TargetTickOption
-	{ 
-		(IsNetMode(NM_Standalone) || CharacterOwner->GetLocalRole() <= ROLE_AutonomousProxy || CharacterOwner->GetRemoteRole() != ROLE_AutonomousProxy)
-		? EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered : EVisibilityBasedAnimTickOption::AlwaysTickPose
-	};
+	if (GLocomotionMaxDesiredStateChangesPerSecond <= 0.0f)
+	{
+		return true;
+	}
 
-	CharacterOwner->GetMesh()->VisibilityBasedAnimTickOption = (TargetTickOption <= DefaultTickOption) ? TargetTickOption : DefaultTickOption;
-}
+	const auto* World{ GetWorld() };
+	const auto CurrentTime{ World ? World->GetTimeSeconds() : 0.0 };
 
-void ULocomotionComponent::UpdateMovementBase()
-{
-	const auto& BasedMovement{ CharacterOwner->GetBasedMovement() };
+	// The bucket starts full and allows a burst of up to one second of changes
 
-	if (BasedMovement.MovementBase != MovementBase.Primitive || BasedMovement.BoneName != MovementBase.BoneName)
+	if (DesiredStateChangeTokensTime < 0.0)
 	{
-		MovementBase.Primitive = BasedMovement.MovementBase;
-		MovementBase.BoneName = BasedMovement.BoneName;
-		MovementBase.bBaseChanged = true;
+		DesiredStateChangeTokens = GLocomotionMaxDesiredStateChangesPerSecond;
 	}
 	else
 	{
-		MovementBase.bBaseChanged = false;
+		const auto ElapsedTime{ static_cast<float>(FMath::Max(CurrentTime - DesiredStateChangeTokensTime, 0.0)) };
+
+		DesiredStateChangeTokens = FMath::Min(DesiredStateChangeTokens + ElapsedTime * GLocomotionMaxDesiredStateChangesPerSecond, GLocomotionMaxDesiredStateChangesPerSecond);
 	}
 
-	MovementBase.bHasRelativeLocation = BasedMovement.HasRelativeLocation();
-	MovementBase.bHasRelativeRotation = MovementBase.bHasRelativeLocation && BasedMovement.bRelativeRotation;
+	DesiredStateChangeTokensTime = CurrentTime;
 
-	const auto PreviousRotation{ MovementBase.Rotation };
+	if (DesiredStateChangeTokens < 1.0f)
+	{
+		return false;
+	}
 
-	MovementBaseUtility::GetMovementBaseTransform(BasedMovement.MovementBase, BasedMovement.BoneName, MovementBase.Location, MovementBase.Rotation);
+	DesiredStateChangeTokens -= 1.0f;
 
-	MovementBase.DeltaRotation = (MovementBase.bHasRelativeLocation && !MovementBase.bBaseChanged) ? (MovementBase.Rotation * PreviousRotation.Inverse()).Rotator() : FRotator::ZeroRotator;
+	return true;
 }
 
-void ULocomotionComponent::UpdateAnimInstanceMovement()
+int32 ULocomotionComponent::GetPackedLocomotionStatesBits() const
 {
-	if (!CharacterOwner->GetMesh()->bRecentlyRendered &&
-		(CharacterOwner->GetMesh()->VisibilityBasedAnimTickOption > EVisibilityBasedAnimTickOption::AlwaysTickPose))
+	if (!LocomotionData)
 	{
-		if (auto* MainMesh{ ICharacterMeshAccessorInterface::Execute_GetMainMesh(CharacterOwner) })
-		{
-			if (auto* AnimIns{ Cast<UCharacterAnimInstance>(MainMesh->GetAnimInstance()) })
-			{
-				AnimIns->MarkPendingUpdate();
-			}
-		}
+		return 0;
 	}
-}
 
-#pragma endregion
+	const auto& Table{ LocomotionData->GetConfigTable() };
 
+	const auto NumBits
+	{
+		Table.GetStateIdBits(ELocomotionConfigLevel::RotationMode) +
+		Table.GetStateIdBits(ELocomotionConfigLevel::Stance) +
+		Table.GetStateIdBits(ELocomotionConfigLevel::Gait)
+	};
 
-#pragma region Locomotion Mode
+	check(NumBits <= 32);
+
+	return NumBits;
+}
 
 void ULocomotionComponent::SetMovementMode(EMovementMode NewMovementMode, uint8 NewCustomMode)
 {
@@ -495,42 +1258,134 @@ void ULocomotionComponent::SetLocomotionMode(const FGameplayTag& NewLocomotionMo
 
 void ULocomotionComponent::UpdateLocomotionConfigs()
 {
-	// Get Configs for current LocomotionMode
+	const auto& ConfigTable{ LocomotionData->GetConfigTable() };
+
+	FLocomotionConditionContext ConditionContext{ this };
+
+	// Get node for current LocomotionMode
 
-	const auto& LocomotionModeConfigs{ LocomotionData->GetLocomotionModeConfig(LocomotionMode) };
+	const auto ModeNode{ ConfigTable.FindLocomotionMode(ConfigTable.ResolveStateId(ELocomotionConfigLevel::LocomotionMode, LocomotionMode, LocomotionModeIdCache)) };
+	check(ModeNode != INDEX_NONE);
 
-	SetLocomotionSpace(LocomotionModeConfigs.LocomotionSpace);
+	SetLocomotionSpace(ConfigTable.GetLocomotionSpace(ModeNode));
 
-	// Get Tag and Configs from LocomotionModeConfigs based on current DesiredRotationMode and update RotationMode
+	// Get node from LocomotionMode node based on current DesiredRotationMode and update RotationMode
 
-	auto AllowedRotationMode{ DesiredRotationMode };
-	const auto& RotationModeConfigs{ LocomotionModeConfigs.GetAllowedRotationMode(this, DesiredRotationMode, AllowedRotationMode) };
-	SetRotationMode(AllowedRotationMode);
+	const auto RotationModeNode{ ConfigTable.GetAllowedChild(ELocomotionConfigLevel::LocomotionMode, ModeNode,
+		ConfigTable.ResolveStateId(ELocomotionConfigLevel::RotationMode, DesiredRotationMode, DesiredRotationModeIdCache), ConditionContext) };
+	SetRotationMode(ConfigTable.GetNode(ELocomotionConfigLevel::RotationMode, RotationModeNode).Tag);
+	ConditionContext.MarkStateTagsDirty();
 	
-	// Get current Stance Configs from RotationModeConfigs
+	// Get current Stance node from RotationMode node
 
-	auto AllowedStance{ DesiredStance };
-	const auto& StanceConfigs{ RotationModeConfigs.GetAllowedStance(this, DesiredStance, AllowedStance) };
-	SetStance(AllowedStance);
+	const auto StanceNode{ ConfigTable.GetAllowedChild(ELocomotionConfigLevel::RotationMode, RotationModeNode,
+		ConfigTable.ResolveStateId(ELocomotionConfigLevel::Stance, DesiredStance, DesiredStanceIdCache), ConditionContext) };
+	SetStance(ConfigTable.GetNode(ELocomotionConfigLevel::Stance, StanceNode).Tag);
+	ConditionContext.MarkStateTagsDirty();
 
-	// Get Tag and Configs from StanceConfigs based on current DesiredGait Update Gait
+	// Get node from Stance node based on current DesiredGait Update Gait
 
-	auto AllowedGait{ DesiredGait };
-	const auto& GaitConfigs{ StanceConfigs.GetAllowedGait(this, DesiredGait, AllowedGait) };
-	SetGait(AllowedGait);
+	const auto GaitNode{ ConfigTable.GetAllowedChild(ELocomotionConfigLevel::Stance, StanceNode,
+		ConfigTable.ResolveStateId(ELocomotionConfigLevel::Gait, DesiredGait, DesiredGaitIdCache), ConditionContext) };
+	SetGait(ConfigTable.GetNode(ELocomotionConfigLevel::Gait, GaitNode).Tag);
 
 	if (bShouldUpdateGaitConfigs)
 	{
-		RefreshGaitConfigs(GaitConfigs);
+		RefreshGaitConfigs(ConfigTable.GetGaitConfigs(GaitNode));
 
 		bShouldUpdateGaitConfigs = false;
 	}
+
+	// Save the inputs used for this resolution
+
+	ResolvedConfigInputs.LocomotionMode = LocomotionMode;
+	ResolvedConfigInputs.DesiredRotationMode = DesiredRotationMode;
+	ResolvedConfigInputs.DesiredStance = DesiredStance;
+	ResolvedConfigInputs.DesiredGait = DesiredGait;
+	ResolvedConfigInputs.LocomotionAction = LocomotionAction;
+	ResolvedConfigInputs.InputYawAngle = LocomotionState.InputYawAngle;
+	ResolvedConfigInputs.ViewYawAngle = UE_REAL_TO_FLOAT(ViewState.Rotation.Yaw);
+	ResolvedConfigInputs.Speed = LocomotionState.Speed;
+	ResolvedConfigInputs.bHasInput = LocomotionState.bHasInput;
+	ResolvedConfigInputs.bCrouching = IsCrouching();
+
+	ResolvedConfigInputs.RotationMode = RotationMode;
+	ResolvedConfigInputs.Stance = Stance;
+	ResolvedConfigInputs.Gait = Gait;
+
+	// Keep resolving while the character could not enter the allowed Stance (e.g. UnCrouch was blocked)
+
+	bLocomotionConfigsDirty = (Stance != ConfigTable.GetNode(ELocomotionConfigLevel::Stance, StanceNode).Tag);
+
+	INC_DWORD_STAT(STAT_LocomotionComponent_ConfigResolves);
+}
+
+bool ULocomotionComponent::ShouldUpdateLocomotionConfigs() const
+{
+	if (bLocomotionConfigsDirty || bShouldUpdateGaitConfigs)
+	{
+		return true;
+	}
+
+	// Changes of the state tags
+
+	if (ResolvedConfigInputs.LocomotionMode != LocomotionMode ||
+		ResolvedConfigInputs.DesiredRotationMode != DesiredRotationMode ||
+		ResolvedConfigInputs.DesiredStance != DesiredStance ||
+		ResolvedConfigInputs.DesiredGait != DesiredGait ||
+		ResolvedConfigInputs.bCrouching != IsCrouching())
+	{
+		return true;
+	}
+
+	// Changes of the inputs declared by the conditions
+
+	const auto ConditionInputs{ LocomotionData->GetConfigTable().GetConditionInputs() };
+
+	if (EnumHasAnyFlags(ConditionInputs, ELocomotionConditionInput::Unknown))
+	{
+		return true;
+	}
+
+	if (EnumHasAnyFlags(ConditionInputs, ELocomotionConditionInput::InputYaw) &&
+		FMath::Abs(FRotator3f::NormalizeAxis(LocomotionState.InputYawAngle - ResolvedConfigInputs.InputYawAngle)) > LocomotionData->ConditionYawAngleThreshold)
+	{
+		return true;
+	}
+
+	if (EnumHasAnyFlags(ConditionInputs, ELocomotionConditionInput::ViewYaw) &&
+		FMath::Abs(FRotator3f::NormalizeAxis(UE_REAL_TO_FLOAT(ViewState.Rotation.Yaw) - ResolvedConfigInputs.ViewYawAngle)) > LocomotionData->ConditionYawAngleThreshold)
+	{
+		return true;
+	}
+
+	if (EnumHasAnyFlags(ConditionInputs, ELocomotionConditionInput::Speed) &&
+		FMath::Abs(LocomotionState.Speed - ResolvedConfigInputs.Speed) > LocomotionData->ConditionSpeedThreshold)
+	{
+		return true;
+	}
+
+	if (EnumHasAnyFlags(ConditionInputs, ELocomotionConditionInput::HasInput) &&
+		ResolvedConfigInputs.bHasInput != LocomotionState.bHasInput)
+	{
+		return true;
+	}
+
+	if (EnumHasAnyFlags(ConditionInputs, ELocomotionConditionInput::StateTags) &&
+		ResolvedConfigInputs.LocomotionAction != LocomotionAction)
+	{
+		return true;
+	}
+
+	return false;
 }
 
 void ULocomotionComponent::OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode)
 {
 	Super::OnMovementModeChanged(PreviousMovementMode, PreviousCustomMode);
 
+	InvalidateFloorCache();
+
 	bCrouchMaintainsBaseLocation = true;
 
 	if (LocomotionData)
@@ -553,9 +1408,10 @@ void ULocomotionComponent::OnMovementModeChanged(EMovementMode PreviousMovementM
 
 		if (MovementMode == MOVE_Custom)
 		{
-			if (auto Process{ CustomMovementProcesses.FindRef(CustomMovementMode) })
+			int32 Slot;
+			if (auto Process{ GetCustomMovementProcess(CustomMovementMode, Slot) })
 			{
-				Process->OnMovementStart(this);
+				Process->OnMovementStartWithState(this, CustomMovementStates.GetState(Slot));
 			}
 		}
 
@@ -563,9 +1419,10 @@ void ULocomotionComponent::OnMovementModeChanged(EMovementMode PreviousMovementM
 
 		if (PreviousMovementMode == MOVE_Custom)
 		{
-			if (auto Process{ CustomMovementProcesses.FindRef(PreviousCustomMode) })
+			int32 Slot;
+			if (auto Process{ GetCustomMovementProcess(PreviousCustomMode, Slot) })
 			{
-				Process->OnMovementEnd(this);
+				Process->OnMovementEndWithState(this, CustomMovementStates.GetState(Slot));
 			}
 		}
 	}
@@ -584,7 +1441,9 @@ void ULocomotionComponent::SetDesiredRotationMode(FGameplayTag NewDesiredRotatio
 
 		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, DesiredRotationMode, this);
 
-		if (CharacterOwner->GetLocalRole() == ROLE_AutonomousProxy)
+		// The desired states are sent with the moves when the movement is replicated
+
+		if (!CharacterOwner->IsReplicatingMovement() && CharacterOwner->GetLocalRole() == ROLE_AutonomousProxy)
 		{
 			Server_SetDesiredRotationMode(DesiredRotationMode);
 		}
@@ -593,6 +1452,10 @@ void ULocomotionComponent::SetDesiredRotationMode(FGameplayTag NewDesiredRotatio
 
 void ULocomotionComponent::Server_SetDesiredRotationMode_Implementation(FGameplayTag NewDesiredRotationMode)
 {
+#if !UE_BUILD_SHIPPING
+	++NumDesiredStateRPCsReceived;
+#endif
+
 	SetDesiredRotationMode(NewDesiredRotationMode);
 }
 
@@ -624,7 +1487,9 @@ void ULocomotionComponent::SetDesiredStance(FGameplayTag NewDesiredStance)
 
 		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, DesiredStance, this);
 
-		if (CharacterOwner->GetLocalRole() == ROLE_AutonomousProxy)
+		// The desired states are sent with the moves when the movement is replicated
+
+		if (!CharacterOwner->IsReplicatingMovement() && CharacterOwner->GetLocalRole() == ROLE_AutonomousProxy)
 		{
 			Server_SetDesiredStance(DesiredStance);
 		}
@@ -633,6 +1498,10 @@ void ULocomotionComponent::SetDesiredStance(FGameplayTag NewDesiredStance)
 
 void ULocomotionComponent::Server_SetDesiredStance_Implementation(FGameplayTag NewDesiredStance)
 {
+#if !UE_BUILD_SHIPPING
+	++NumDesiredStateRPCsReceived;
+#endif
+
 	SetDesiredStance(NewDesiredStance);
 }
 
@@ -687,7 +1556,9 @@ void ULocomotionComponent::SetDesiredGait(FGameplayTag NewDesiredGait)
 
 		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, DesiredGait, this);
 
-		if (CharacterOwner->GetLocalRole() == ROLE_AutonomousProxy)
+		// The desired states are sent with the moves when the movement is replicated
+
+		if (!CharacterOwner->IsReplicatingMovement() && CharacterOwner->GetLocalRole() == ROLE_AutonomousProxy)
 		{
 			Server_SetDesiredGait(DesiredGait);
 		}
@@ -696,6 +1567,10 @@ void ULocomotionComponent::SetDesiredGait(FGameplayTag NewDesiredGait)
 
 void ULocomotionComponent::Server_SetDesiredGait_Implementation(FGameplayTag NewDesiredGait)
 {
+#if !UE_BUILD_SHIPPING
+	++NumDesiredStateRPCsReceived;
+#endif
+
 	SetDesiredGait(NewDesiredGait);
 }
 
@@ -736,16 +1611,32 @@ void ULocomotionComponent::RefreshGaitConfigs()
 		return;
 	}
 
-	auto AllowedRotationMode{ RotationMode };
-	auto AllowedStance{ Stance };
-	auto AllowedGait{ Gait };
+	const auto& ConfigTable{ LocomotionData->GetConfigTable() };
+
+	const FLocomotionConditionContext ConditionContext{ this };
+
+	const auto ModeNode{ ConfigTable.FindLocomotionMode(ConfigTable.ResolveStateId(ELocomotionConfigLevel::LocomotionMode, LocomotionMode, LocomotionModeIdCache)) };
+	check(ModeNode != INDEX_NONE);
+
+	const auto RotationModeNode{ ConfigTable.GetAllowedChild(ELocomotionConfigLevel::LocomotionMode, ModeNode,
+		ConfigTable.ResolveStateId(ELocomotionConfigLevel::RotationMode, RotationMode, RotationModeIdCache), ConditionContext) };
+
+	const auto StanceNode{ ConfigTable.GetAllowedChild(ELocomotionConfigLevel::RotationMode, RotationModeNode,
+		ConfigTable.ResolveStateId(ELocomotionConfigLevel::Stance, Stance, StanceIdCache), ConditionContext) };
+
+	const auto GaitNode{ ConfigTable.GetAllowedChild(ELocomotionConfigLevel::Stance, StanceNode,
+		ConfigTable.ResolveStateId(ELocomotionConfigLevel::Gait, Gait, GaitIdCache), ConditionContext) };
+
+	RefreshGaitConfigs(ConfigTable.GetGaitConfigs(GaitNode));
 
-	const auto& LocomotionModeConfigs{ LocomotionData->GetLocomotionModeConfig(LocomotionMode) };
-	const auto& RotationModeConfigs{ LocomotionModeConfigs.GetAllowedRotationMode(this, RotationMode, AllowedRotationMode) };
-	const auto& StanceConfigs{ RotationModeConfigs.GetAllowedStance(this, Stance, AllowedStance) };
-	const auto& GaitConfigs{ StanceConfigs.GetAllowedGait(this, Gait, AllowedGait) };
+	// If the move overwrote the states with different ones, resolve them again from the DesiredXXX values on the next update
 
-	RefreshGaitConfigs(GaitConfigs);
+	if (ResolvedConfigInputs.RotationMode != RotationMode ||
+		ResolvedConfigInputs.Stance != Stance ||
+		ResolvedConfigInputs.Gait != Gait)
+	{
+		MarkLocomotionConfigsDirty();
+	}
 }
 
 void ULocomotionComponent::RefreshGaitConfigs(const FCharacterGaitConfigs& InGaitConfigs)
@@ -827,7 +1718,12 @@ void ULocomotionComponent::SetInputDirection(FVector NewInputDirection)
 {
 	NewInputDirection = NewInputDirection.GetSafeNormal();
 
-	COMPARE_ASSIGN_AND_MARK_PROPERTY_DIRTY(ThisClass, InputDirection, NewInputDirection, this);
+	if (ReplicatedIntent.InputDirection != NewInputDirection)
+	{
+		ReplicatedIntent.InputDirection = NewInputDirection;
+
+		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, ReplicatedIntent, this);
+	}
 }
 
 void ULocomotionComponent::UpdateInput(float DeltaTime)
@@ -837,11 +1733,30 @@ void ULocomotionComponent::UpdateInput(float DeltaTime)
 		SetInputDirection(GetCurrentAcceleration() / GetMaxAcceleration());
 	}
 
-	LocomotionState.bHasInput = InputDirection.SizeSquared() > UE_KINDA_SMALL_NUMBER;
+	// Reuse the values precomputed by ULocomotionStateSubsystem if the input has not changed since
+
+	if (PrecomputedState.IsValidForInput(ReplicatedIntent.InputDirection))
+	{
+		LocomotionState.bHasInput = PrecomputedState.bHasInput;
+
+		if (LocomotionState.bHasInput)
+		{
+			LocomotionState.InputYawAngle = PrecomputedState.InputYawAngle;
+		}
+
+		return;
+	}
+
+	LocomotionStateKernels::ComputeInput(ReplicatedIntent.InputDirection, LocomotionState.bHasInput, LocomotionState.InputYawAngle);
+}
+
+void ULocomotionComponent::OnReplicated_ReplicatedIntent(const FLocomotionReplicatedIntent& PreviousIntent)
+{
+	// Only the view rotation is smoothed, the input direction and velocity yaw angle are read directly
 
-	if (LocomotionState.bHasInput)
+	if (ReplicatedIntent.ViewRotation != PreviousIntent.ViewRotation)
 	{
-		LocomotionState.InputYawAngle = UE_REAL_TO_FLOAT(ULocomotionFunctionLibrary::DirectionToAngleXY(InputDirection));
+		CorrectViewNetworkSmoothing(ReplicatedIntent.ViewRotation);
 	}
 }
 
@@ -856,9 +1771,9 @@ void ULocomotionComponent::UpdateView(float DeltaTime)
 	{
 		// Offset the rotations to keep them relative to the movement base.
 
-		ReplicatedViewRotation.Pitch += MovementBase.DeltaRotation.Pitch;
-		ReplicatedViewRotation.Yaw += MovementBase.DeltaRotation.Yaw;
-		ReplicatedViewRotation.Normalize();
+		ReplicatedIntent.ViewRotation.Pitch += MovementBase.DeltaRotation.Pitch;
+		ReplicatedIntent.ViewRotation.Yaw += MovementBase.DeltaRotation.Yaw;
+		ReplicatedIntent.ViewRotation.Normalize();
 
 		ViewState.Rotation.Pitch += MovementBase.DeltaRotation.Pitch;
 		ViewState.Rotation.Yaw += MovementBase.DeltaRotation.Yaw;
@@ -875,20 +1790,23 @@ void ULocomotionComponent::UpdateView(float DeltaTime)
 	UpdateViewNetworkSmoothing(DeltaTime);
 
 	ViewState.Rotation = ViewState.NetworkSmoothing.Rotation;
-	ViewState.YawSpeed = FMath::Abs(UE_REAL_TO_FLOAT(ViewState.Rotation.Yaw - ViewState.PreviousYawAngle)) / DeltaTime;
+
+	ViewState.YawSpeed = PrecomputedState.IsValidForViewYawSpeed(ViewState.PreviousYawAngle, ViewState.Rotation, DeltaTime)
+		? PrecomputedState.ViewYawSpeed
+		: LocomotionStateKernels::ComputeViewYawSpeed(ViewState.PreviousYawAngle, ViewState.Rotation, DeltaTime);
 }
 
 void ULocomotionComponent::CorrectViewNetworkSmoothing(const FRotator& NewViewRotation)
 {
-	ReplicatedViewRotation = NewViewRotation;
-	ReplicatedViewRotation.Normalize();
+	ReplicatedIntent.ViewRotation = NewViewRotation;
+	ReplicatedIntent.ViewRotation.Normalize();
 
 	auto& NetworkSmoothing{ ViewState.NetworkSmoothing };
 
 	if (!NetworkSmoothing.bEnabled)
 	{
-		NetworkSmoothing.InitialRotation = ReplicatedViewRotation;
-		NetworkSmoothing.Rotation = ReplicatedViewRotation;
+		NetworkSmoothing.InitialRotation = ReplicatedIntent.ViewRotation;
+		NetworkSmoothing.Rotation = ReplicatedIntent.ViewRotation;
 		return;
 	}
 
@@ -928,64 +1846,94 @@ void ULocomotionComponent::UpdateViewNetworkSmoothing(float DeltaTime)
 {
 	auto& NetworkSmoothing{ ViewState.NetworkSmoothing };
 
-	if (!NetworkSmoothing.bEnabled ||
-		NetworkSmoothing.ClientTime >= NetworkSmoothing.ServerTime ||
-		NetworkSmoothing.Duration <= UE_SMALL_NUMBER)
+	// Reuse the values precomputed by ULocomotionStateSubsystem if the smoothing and its target have not changed since
+	// (The batch does not offset the rotations by the movement base)
+
+	if (!MovementBase.bHasRelativeRotation && PrecomputedState.IsValidForViewNetworkSmoothing(NetworkSmoothing, ReplicatedIntent.ViewRotation, DeltaTime))
 	{
-		NetworkSmoothing.InitialRotation = ReplicatedViewRotation;
-		NetworkSmoothing.Rotation = ReplicatedViewRotation;
+		NetworkSmoothing = PrecomputedState.NewNetworkSmoothing;
 		return;
 	}
 
-	if (MovementBase.bHasRelativeRotation)
+	LocomotionStateKernels::UpdateViewNetworkSmoothing(NetworkSmoothing, ReplicatedIntent.ViewRotation, MovementBase.bHasRelativeRotation, MovementBase.DeltaRotation, DeltaTime);
+}
+
+void ULocomotionComponent::SetReplicatedViewRotation(const FRotator& NewViewRotation)
+{
+	if (ReplicatedIntent.ViewRotation != NewViewRotation)
 	{
-		NetworkSmoothing.InitialRotation.Pitch += MovementBase.DeltaRotation.Pitch;
-		NetworkSmoothing.InitialRotation.Yaw += MovementBase.DeltaRotation.Yaw;
-		NetworkSmoothing.InitialRotation.Normalize();
+		ReplicatedIntent.ViewRotation = NewViewRotation;
 
-		NetworkSmoothing.Rotation.Pitch += MovementBase.DeltaRotation.Pitch;
-		NetworkSmoothing.Rotation.Yaw += MovementBase.DeltaRotation.Yaw;
-		NetworkSmoothing.Rotation.Normalize();
+		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, ReplicatedIntent, this);
 	}
 
-	NetworkSmoothing.ClientTime += DeltaTime;
+	// Checked even if the rotation has not changed so that a deferred upload is sent once the rate allows it
 
-	const auto InterpolationAmount{ ULocomotionFunctionLibrary::Clamp01(1.0f - (NetworkSmoothing.ServerTime - NetworkSmoothing.ClientTime) / NetworkSmoothing.Duration) };
-
-	if (!FAnimWeight::IsFullWeight(InterpolationAmount))
-	{
-		NetworkSmoothing.Rotation = ULocomotionFunctionLibrary::LerpRotator(NetworkSmoothing.InitialRotation, ReplicatedViewRotation, InterpolationAmount);
-		
-	}
-	else
+	if (!CharacterOwner->IsReplicatingMovement() && CharacterOwner->GetLocalRole() == ROLE_AutonomousProxy)
 	{
-		NetworkSmoothing.ClientTime = NetworkSmoothing.ServerTime;
-		NetworkSmoothing.Rotation = ReplicatedViewRotation;
+		UploadViewRotation();
 	}
 }
 
-void ULocomotionComponent::SetReplicatedViewRotation(const FRotator& NewViewRotation)
+void ULocomotionComponent::UploadViewRotation()
 {
-	if (ReplicatedViewRotation != NewViewRotation)
+	const auto& ViewRotation{ ReplicatedIntent.ViewRotation };
+
+	const auto DeltaAngle
 	{
-		ReplicatedViewRotation = NewViewRotation;
+		FMath::Max(
+			FMath::Abs(FRotator::NormalizeAxis(ViewRotation.Pitch - LastUploadedViewRotation.Pitch)),
+			FMath::Abs(FRotator::NormalizeAxis(ViewRotation.Yaw - LastUploadedViewRotation.Yaw)))
+	};
 
-		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, ReplicatedViewRotation, this);
+	const auto DeadBand{ LocomotionData ? LocomotionData->ViewRotationUploadDeadBand : 0.0f };
 
-		if (!CharacterOwner->IsReplicatingMovement() && CharacterOwner->GetLocalRole() == ROLE_AutonomousProxy)
+	if ((LastViewRotationUploadTime >= 0.0) && (DeltaAngle <= DeadBand))
+	{
+		bViewRotationUploadPending = false;
+		return;
+	}
+
+	const auto* World{ GetWorld() };
+	const auto CurrentTime{ World ? World->GetTimeSeconds() : 0.0 };
+
+	const auto MaxRate{ LocomotionData ? LocomotionData->ViewRotationUploadMaxRate : 0.0f };
+	const auto FlushAngle{ LocomotionData ? LocomotionData->ViewRotationUploadFlushAngle : 0.0f };
+
+	const auto bShouldUpload
+	{
+		(LastViewRotationUploadTime < 0.0) ||
+		(MaxRate <= 0.0f) ||
+		((FlushAngle > 0.0f) && (DeltaAngle >= FlushAngle)) ||
+		(CurrentTime - LastViewRotationUploadTime >= 1.0 / MaxRate)
+	};
+
+	if (!bShouldUpload)
+	{
+		if (!bViewRotationUploadPending)
 		{
-			Server_SetReplicatedViewRotation(ReplicatedViewRotation);
+			INC_DWORD_STAT(STAT_LocomotionComponent_ViewRotationUploadsDeferred);
 		}
+
+		bViewRotationUploadPending = true;
+		return;
 	}
-}
 
-void ULocomotionComponent::OnReplicated_ReplicatedViewRotation()
-{
-	CorrectViewNetworkSmoothing(ReplicatedViewRotation);
+	INC_DWORD_STAT(STAT_LocomotionComponent_ViewRotationUploadsSent);
+
+	LastUploadedViewRotation = ViewRotation;
+	LastViewRotationUploadTime = CurrentTime;
+	bViewRotationUploadPending = false;
+
+	Server_SetReplicatedViewRotation(ViewRotation);
 }
 
 void ULocomotionComponent::Server_SetReplicatedViewRotation_Implementation(const FRotator& NewViewRotation)
 {
+#if !UE_BUILD_SHIPPING
+	++NumViewRotationRPCsReceived;
+#endif
+
 	SetReplicatedViewRotation(NewViewRotation);
 }
 
@@ -1005,21 +1953,63 @@ void ULocomotionComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds
 
 	UpdateVisibilityBasedAnimTickOption();
 
+	UpdateLocomotionLOD(DeltaSeconds);
+
+	// The rotation of authority characters is replicated to all clients, so it is updated every frame even in reduced frames
+
+	const auto bUpdateRotationEveryFrame{ CharacterOwner->HasAuthority() };
+
+	if (bLocomotionLODReduced)
+	{
+		UpdateLocomotionReduced(DeltaSeconds);
+
+		if (bUpdateRotationEveryFrame)
+		{
+			BeginDeferredRotation();
+
+			UpdateOnGroundRotation(DeltaSeconds);
+			UpdateInAirRotation(DeltaSeconds);
+			UpdateInWaterRotation(DeltaSeconds);
+
+			CommitPendingRotation();
+		}
+
+		Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
+		return;
+	}
+
+	// Full updates of the locomotion cover all the time elapsed since the last full update,
+	// while the movement of the parent class still advances by the frame time
+
+	const auto LocomotionDeltaSeconds{ LocomotionLODDeltaTime };
+	const auto RotationDeltaSeconds{ bUpdateRotationEveryFrame ? DeltaSeconds : LocomotionDeltaSeconds };
+
+	BeginDeferredRotation();
+
 	UpdateMovementBase();
 
-	UpdateInput(DeltaSeconds);
+	UpdateInput(LocomotionDeltaSeconds);
 
 	UpdateLocomotionEarly();
 
-	UpdateView(DeltaSeconds);
+	UpdateView(LocomotionDeltaSeconds);
 
-	UpdateLocomotion(DeltaSeconds);
+	UpdateLocomotion(LocomotionDeltaSeconds);
 
-	UpdateLocomotionConfigs();
+	if (ShouldUpdateLocomotionConfigs())
+	{
+		UpdateLocomotionConfigs();
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_LocomotionComponent_ConfigResolvesSkipped);
+	}
 
-	UpdateOnGroundRotation(DeltaSeconds);
-	UpdateInAirRotation(DeltaSeconds);
-	UpdateInWaterRotation(DeltaSeconds);
+	UpdateOnGroundRotation(RotationDeltaSeconds);
+	UpdateInAirRotation(RotationDeltaSeconds);
+	UpdateInWaterRotation(RotationDeltaSeconds);
+
+	CommitPendingRotation();
 
 	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
 }
@@ -1032,27 +2022,91 @@ void ULocomotionComponent::UpdateCharacterStateAfterMovement(float DeltaSeconds)
 	{
 		return;
 	}
-
-	Super::UpdateCharacterStateAfterMovement(DeltaSeconds);
-
-	UpdateLocomotionLate(DeltaSeconds);
-
-	UpdateAnimInstanceMovement();
+
+	Super::UpdateCharacterStateAfterMovement(DeltaSeconds);
+
+	if (!bLocomotionLODReduced)
+	{
+		UpdateLocomotionLate(LocomotionLODDeltaTime);
+
+		LocomotionLODDeltaTime = 0.0f;
+	}
+
+	UpdateAnimInstanceMovement(DeltaSeconds);
+
+	PublishAnimSnapshot();
+
+#if !UE_BUILD_SHIPPING
+	if (GLocomotionLogTrajectory && CharacterOwner->HasAuthority())
+	{
+		UE_LOG(LogGLE, Log, TEXT("Trajectory(%s): Frame=%llu, Headless=%d, Location=%s, Rotation=%s, Velocity=%s"),
+			*GetNameSafe(CharacterOwner), GFrameCounter, bHeadless ? 1 : 0,
+			*UpdatedComponent->GetComponentLocation().ToString(), *UpdatedComponent->GetComponentRotation().ToString(), *Velocity.ToString());
+	}
+#endif
+}
+
+void ULocomotionComponent::ComputeFloorDist(
+	const FVector& CapsuleLocation,
+	float LineDistance,
+	float SweepDistance,
+	FFindFloorResult& OutFloorResult,
+	float SweepRadius,
+	const FHitResult* DownwardSweepResult) const
+{
+	OutFloorResult.Clear();
+
+	auto PawnRadius{ 0.0f };
+	auto PawnHalfHeight{ 0.0f };
+	CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleSize(PawnRadius, PawnHalfHeight);
+
+	// Reuse the last floor if the capsule has not moved on a static floor
+
+	const auto bUseFloorCache{ GLocomotionEnableFloorCache && (DownwardSweepResult == nullptr) };
+	const auto Time{ GetWorld()->GetTimeSeconds() };
+
+	if (bUseFloorCache)
+	{
+		if (FloorCache.TryReuse(OutFloorResult, CapsuleLocation, LineDistance, SweepDistance, SweepRadius, PawnRadius, PawnHalfHeight, Time, GLocomotionFloorCacheTolerance, GLocomotionFloorCacheMaxAge))
+		{
+			INC_DWORD_STAT(STAT_LocomotionComponent_FloorCacheHits);
+			return;
+		}
+
+		INC_DWORD_STAT(STAT_LocomotionComponent_FloorCacheMisses);
+	}
+
+	LastFloorSweepDistance = SweepDistance;
+	LastFloorSweepRadius = SweepRadius;
+
+	// Use the asynchronous floor sweep issued in the previous frame if the prediction was correct.
+	// If it cannot be used as the floor, the synchronous queries are run as a fallback.
+
+	if (DownwardSweepResult || !ConsumeFloorProbe(CapsuleLocation, SweepDistance, SweepRadius, PawnRadius, PawnHalfHeight, OutFloorResult))
+	{
+		ComputeFloorDistUncached(CapsuleLocation, LineDistance, SweepDistance, OutFloorResult, SweepRadius, DownwardSweepResult, PawnRadius, PawnHalfHeight);
+	}
+
+	if (bUseFloorCache)
+	{
+		FloorCache.Store(OutFloorResult, CapsuleLocation, LineDistance, SweepDistance, SweepRadius, PawnRadius, PawnHalfHeight, Time);
+	}
+	else
+	{
+		FloorCache.Invalidate();
+	}
 }
 
-void ULocomotionComponent::ComputeFloorDist(
+void ULocomotionComponent::ComputeFloorDistUncached(
 	const FVector& CapsuleLocation,
 	float LineDistance,
 	float SweepDistance,
 	FFindFloorResult& OutFloorResult,
 	float SweepRadius,
-	const FHitResult* DownwardSweepResult) const
+	const FHitResult* DownwardSweepResult,
+	float PawnRadius,
+	float PawnHalfHeight) const
 {
-	OutFloorResult.Clear();
-
-	auto PawnRadius{ 0.0f };
-	auto PawnHalfHeight{ 0.0f };
-	CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleSize(PawnRadius, PawnHalfHeight);
 
 	auto bSkipSweep{ false };
 	if (DownwardSweepResult != NULL && DownwardSweepResult->IsValidBlockingHit())
@@ -1209,6 +2263,147 @@ void ULocomotionComponent::ComputeFloorDist(
 	OutFloorResult.bWalkableFloor = false;
 }
 
+void ULocomotionComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (ShouldProbeFloorAsync())
+	{
+		IssueFloorProbe(DeltaTime);
+	}
+	else
+	{
+		FloorProbeHandle.Invalidate();
+	}
+}
+
+bool ULocomotionComponent::ShouldProbeFloorAsync() const
+{
+	if (!GLocomotionEnableAsyncFloorProbe || !CharacterOwner || !UpdatedComponent || bUseFlatBaseForFloorChecks || !IsMovingOnGround())
+	{
+		return false;
+	}
+
+	// Floor sweep has not been run yet
+
+	if (LastFloorSweepDistance <= 0.0f || LastFloorSweepRadius <= 0.0f)
+	{
+		return false;
+	}
+
+	const auto LocalRole{ CharacterOwner->GetLocalRole() };
+
+	if (LocalRole == ROLE_SimulatedProxy)
+	{
+		return true;
+	}
+
+	return (LocalRole == ROLE_Authority) && !CharacterOwner->IsPlayerControlled();
+}
+
+// Same scale as the first sweep of ComputeFloorDistUncached()
+
+static constexpr auto FloorProbeShrinkScale{ 0.9f };
+
+void ULocomotionComponent::IssueFloorProbe(float DeltaTime)
+{
+	auto PawnRadius{ 0.0f };
+	auto PawnHalfHeight{ 0.0f };
+	CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleSize(PawnRadius, PawnHalfHeight);
+
+	// Predict the location of the next frame assuming the same velocity and delta time
+
+	FloorProbeLocation = UpdatedComponent->GetComponentLocation() + Velocity * DeltaTime;
+	FloorProbeSweepDistance = LastFloorSweepDistance;
+	FloorProbeSweepRadius = LastFloorSweepRadius;
+	FloorProbeHalfHeight = PawnHalfHeight;
+
+	// Sweep the same shrunk capsule as the synchronous sweep of ComputeFloorDistUncached()
+
+	FloorProbeShrinkHeight = (PawnHalfHeight - PawnRadius) * (1.f - FloorProbeShrinkScale);
+
+	const auto TraceStart{ FloorProbeLocation };
+	const auto TraceEnd{ FloorProbeLocation - FVector(0.f, 0.f, FloorProbeSweepDistance + FloorProbeShrinkHeight) };
+
+	auto QueryParams{ FCollisionQueryParams(SCENE_QUERY_STAT(ComputeFloorDist), false, CharacterOwner) };
+	auto ResponseParam{ FCollisionResponseParams() };
+	InitCollisionParams(QueryParams, ResponseParam);
+
+	FloorProbeHandle = GetWorld()->AsyncSweepByChannel(EAsyncTraceType::Single, TraceStart, TraceEnd, FQuat::Identity,
+		UpdatedComponent->GetCollisionObjectType(), FCollisionShape::MakeCapsule(FloorProbeSweepRadius, FloorProbeHalfHeight - FloorProbeShrinkHeight), QueryParams, ResponseParam);
+
+	INC_DWORD_STAT(STAT_LocomotionComponent_FloorProbesIssued);
+}
+
+bool ULocomotionComponent::ConsumeFloorProbe(const FVector& CapsuleLocation, float SweepDistance, float SweepRadius, float PawnRadius, float PawnHalfHeight, FFindFloorResult& OutFloorResult) const
+{
+	if (!FloorProbeHandle.IsValid())
+	{
+		return false;
+	}
+
+	// The result is consumed only once
+
+	const auto Handle{ FloorProbeHandle };
+	FloorProbeHandle.Invalidate();
+
+	FTraceDatum TraceDatum;
+
+	// The actual capsule must be close to the predicted location in all axes,
+	// otherwise the floor may be above the capsule or geometry between them may be missed
+
+	const auto bResultValid
+	{
+		GetWorld()->QueryTraceData(Handle, TraceDatum) &&
+		(SweepDistance == FloorProbeSweepDistance) && (SweepRadius == FloorProbeSweepRadius) && (PawnHalfHeight == FloorProbeHalfHeight) &&
+		(FloorProbeShrinkHeight == (PawnHalfHeight - PawnRadius) * (1.f - FloorProbeShrinkScale)) &&
+		(FVector::DistSquared2D(CapsuleLocation, FloorProbeLocation) <= FMath::Square(GLocomotionAsyncFloorProbeTolerance)) &&
+		(FMath::Abs(CapsuleLocation.Z - FloorProbeLocation.Z) <= GLocomotionAsyncFloorProbeTolerance) &&
+		(TraceDatum.OutHits.Num() > 0) && TraceDatum.OutHits[0].IsValidBlockingHit()
+	};
+
+	if (!bResultValid)
+	{
+		INC_DWORD_STAT(STAT_LocomotionComponent_FloorProbesRejected);
+		return false;
+	}
+
+	const auto& Hit{ TraceDatum.OutHits[0] };
+
+	// Penetrations, hits on the edge of the capsule and floors above the capsule are left to the synchronous queries
+
+	if (Hit.bStartPenetrating || (Hit.Location.Z > CapsuleLocation.Z) ||
+		!IsWithinEdgeTolerance(CapsuleLocation, Hit.ImpactPoint, SweepRadius) || !IsWalkable(Hit))
+	{
+		INC_DWORD_STAT(STAT_LocomotionComponent_FloorProbesRejected);
+		return false;
+	}
+
+	// Distance from the actual capsule reduced by the shrink height as in the synchronous sweep
+
+	const auto FloorDist{ UE_REAL_TO_FLOAT(CapsuleLocation.Z - Hit.Location.Z) - FloorProbeShrinkHeight };
+
+	if (FloorDist > SweepDistance)
+	{
+		INC_DWORD_STAT(STAT_LocomotionComponent_FloorProbesRejected);
+		return false;
+	}
+
+	OutFloorResult.SetFromSweep(Hit, FMath::Max(FloorDist, -FMath::Max(MAX_FLOOR_DIST, PawnRadius)), true);
+
+	INC_DWORD_STAT(STAT_LocomotionComponent_FloorProbesUsed);
+	return true;
+}
+
+void ULocomotionComponent::OnTeleported()
+{
+	InvalidateFloorCache();
+
+	FloorProbeHandle.Invalidate();
+
+	Super::OnTeleported();
+}
+
 
 bool ULocomotionComponent::CanAttemptJump() const
 {
@@ -1498,9 +2693,10 @@ void ULocomotionComponent::PhysWalking(float DeltaTime, int32 Iterations)
 
 void ULocomotionComponent::PhysCustom(float DeltaTime, int32 Iterations)
 {
-	if (auto Process{ CustomMovementProcesses.FindRef(CustomMovementMode) })
+	int32 Slot;
+	if (auto Process{ GetCustomMovementProcess(CustomMovementMode, Slot) })
 	{
-		Process->PhysMovement(this, DeltaTime, Iterations);
+		Process->PhysMovementWithState(this, CustomMovementStates.GetState(Slot), DeltaTime, Iterations);
 		return;
 	}
 
@@ -1566,12 +2762,16 @@ void ULocomotionComponent::SmoothClientPosition(float DeltaTime)
 
 void ULocomotionComponent::MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAcceleration)
 {
+#if !UE_BUILD_SHIPPING
+	++NumMovesReceived;
+#endif
+
 	const auto* MoveData{ static_cast<FLocomotionNetworkMoveData*>(GetCurrentNetworkMoveData()) };
-	if (MoveData != nullptr)
+	if ((MoveData != nullptr) && MoveData->bHasPackedStates)
 	{
-		RotationMode	= MoveData->RotationMode;
-		Stance			= MoveData->Stance;
-		Gait			= MoveData->Gait;
+		ApplyDesiredLocomotionStates(MoveData->PackedDesiredStates);
+
+		UnpackLocomotionStates(MoveData->PackedStates);
 
 		RefreshGaitConfigs();
 	}
@@ -1639,15 +2839,17 @@ void ULocomotionComponent::UpdateLocomotionEarly()
 		LocomotionState.ViewRelativeTargetYawAngle = FRotator3f::NormalizeAxis(LocomotionState.ViewRelativeTargetYawAngle + MovementBase.DeltaRotation.Yaw);
 		LocomotionState.SmoothTargetYawAngle = FRotator3f::NormalizeAxis(LocomotionState.SmoothTargetYawAngle + MovementBase.DeltaRotation.Yaw);
 
-		auto NewRotation{ CharacterOwner->GetActorRotation() };
+		auto NewRotation{ GetPendingActorRotation() };
 		NewRotation.Pitch += MovementBase.DeltaRotation.Pitch;
 		NewRotation.Yaw += MovementBase.DeltaRotation.Yaw;
 		NewRotation.Normalize();
 
-		CharacterOwner->SetActorRotation(NewRotation);
+		SetPendingActorRotation(NewRotation);
+	}
+	else
+	{
+		UpdateLocomotionLocationAndRotation();
 	}
-
-	UpdateLocomotionLocationAndRotation();
 
 	LocomotionState.PreviousVelocity = LocomotionState.Velocity;
 	LocomotionState.PreviousYawAngle = UE_REAL_TO_FLOAT(LocomotionState.Rotation.Yaw);
@@ -1655,18 +2857,9 @@ void ULocomotionComponent::UpdateLocomotionEarly()
 
 void ULocomotionComponent::UpdateLocomotion(float DeltaTime)
 {
-	LocomotionState.Velocity = Velocity;
-
-	LocomotionState.Speed = UE_REAL_TO_FLOAT(LocomotionState.Velocity.Size2D());
-
-	static constexpr auto HasSpeedThreshold{ 1.0f };
+	static constexpr auto HasSpeedThreshold{ LocomotionStateKernels::HasSpeedThreshold };
 
-	LocomotionState.bHasSpeed = LocomotionState.Speed >= HasSpeedThreshold;
-
-	if (LocomotionState.bHasSpeed)
-	{
-		LocomotionState.VelocityYawAngle = UE_REAL_TO_FLOAT(ULocomotionFunctionLibrary::DirectionToAngleXY(LocomotionState.Velocity));
-	}
+	UpdateLocomotionVelocity();
 
 	if (LocomotionData->bRotateTowardsDesiredVelocityInVelocityDirectionRotationMode && CharacterOwner->GetLocalRole() >= ROLE_AutonomousProxy)
 	{
@@ -1678,7 +2871,14 @@ void ULocomotionComponent::UpdateLocomotion(float DeltaTime)
 			: LocomotionState.VelocityYawAngle);
 	}
 
-	LocomotionState.Acceleration = (LocomotionState.Velocity - LocomotionState.PreviousVelocity) / DeltaTime;
+	// Acceleration is only read by animation
+
+	if (!bHeadless)
+	{
+		LocomotionState.Acceleration = PrecomputedState.IsValidForAcceleration(LocomotionState.Velocity, LocomotionState.PreviousVelocity, DeltaTime)
+			? PrecomputedState.Acceleration
+			: LocomotionStateKernels::ComputeAcceleration(LocomotionState.Velocity, LocomotionState.PreviousVelocity, DeltaTime);
+	}
 
 	// If there is a velocity and current acceleration, or if the velocity is above the movement speed threshold, the character is moving.
 
@@ -1686,6 +2886,44 @@ void ULocomotionComponent::UpdateLocomotion(float DeltaTime)
 		LocomotionState.Speed > LocomotionData->MovingSpeedThreshold;
 }
 
+void ULocomotionComponent::UpdateLocomotionReduced(float DeltaTime)
+{
+	UpdateLocomotionLocationAndRotation();
+
+	UpdateLocomotionVelocity();
+
+	// Keep the smooth target yaw angle moving toward the target decided by the last full update
+
+	const auto& Tier{ LocomotionData->LODTiers[LocomotionLODTier] };
+
+	LocomotionState.SmoothTargetYawAngle =
+		PrecomputedState.IsValidForReducedSmoothTargetYawAngle(LocomotionState.SmoothTargetYawAngle, LocomotionState.TargetYawAngle, Tier.YawInterpolationSpeed, DeltaTime)
+		? PrecomputedState.NewSmoothTargetYawAngle
+		: LocomotionStateKernels::ComputeReducedSmoothTargetYawAngle(LocomotionState.SmoothTargetYawAngle, LocomotionState.TargetYawAngle, DeltaTime, Tier.YawInterpolationSpeed);
+}
+
+void ULocomotionComponent::UpdateLocomotionVelocity()
+{
+	LocomotionState.Velocity = Velocity;
+
+	// Reuse the values precomputed by ULocomotionStateSubsystem if the velocity has not changed since
+
+	if (PrecomputedState.IsValidForVelocity(LocomotionState.Velocity))
+	{
+		LocomotionState.Speed = PrecomputedState.Speed;
+		LocomotionState.bHasSpeed = PrecomputedState.bHasSpeed;
+
+		if (LocomotionState.bHasSpeed)
+		{
+			LocomotionState.VelocityYawAngle = PrecomputedState.VelocityYawAngle;
+		}
+
+		return;
+	}
+
+	LocomotionStateKernels::ComputeVelocity(LocomotionState.Velocity, LocomotionState.Speed, LocomotionState.bHasSpeed, LocomotionState.VelocityYawAngle);
+}
+
 void ULocomotionComponent::UpdateLocomotionLate(float DeltaTime)
 {
 	if (!LocomotionMode.IsValid() || LocomotionAction.IsValid())
@@ -1694,12 +2932,27 @@ void ULocomotionComponent::UpdateLocomotionLate(float DeltaTime)
 		UpdateTargetYawAngleUsingLocomotionRotation();
 	}
 
+	// Yaw speed is only read by animation
+
+	if (bHeadless)
+	{
+		return;
+	}
+
 	LocomotionState.YawSpeed = FRotator3f::NormalizeAxis(UE_REAL_TO_FLOAT(LocomotionState.Rotation.Yaw - LocomotionState.PreviousYawAngle)) / DeltaTime;
 }
 
 void ULocomotionComponent::UpdateLocomotionLocationAndRotation()
 {
-	const auto& ActorTransform{ GetActorTransform() };
+	// The actor transform is read with the rotation not yet committed
+
+	auto ActorTransform{ GetActorTransform() };
+	const auto ActorRotation{ GetPendingActorRotation() };
+
+	if (bHasPendingRotation)
+	{
+		ActorTransform.SetRotation(ActorRotation.Quaternion());
+	}
 
 	// If network smoothing is disabled, normal actor transformations are returned.
 
@@ -1707,20 +2960,17 @@ void ULocomotionComponent::UpdateLocomotionLocationAndRotation()
 	{
 		LocomotionState.Location = ActorTransform.GetLocation();
 		LocomotionState.RotationQuaternion = ActorTransform.GetRotation();
-		LocomotionState.Rotation = CharacterOwner->GetActorRotation();
+		LocomotionState.Rotation = ActorRotation;
 	}
 	else if (CharacterOwner->GetMesh()->IsUsingAbsoluteRotation())
 	{
-		LocomotionState.Location = ActorTransform.TransformPosition(CharacterOwner->GetMesh()->GetRelativeLocation() - CharacterOwner->GetBaseTranslationOffset());
+		LocomotionState.Location = ActorTransform.TransformPosition(GetMeshSmoothingOffset().GetLocation());
 		LocomotionState.RotationQuaternion = ActorTransform.GetRotation();
-		LocomotionState.Rotation = CharacterOwner->GetActorRotation();
+		LocomotionState.Rotation = ActorRotation;
 	}
 	else
 	{
-		const auto SmoothTransform{ ActorTransform *
-			FTransform(CharacterOwner->GetMesh()->GetRelativeRotationCache().RotatorToQuat(CharacterOwner->GetMesh()->GetRelativeRotation()) * CharacterOwner->GetBaseRotationOffset().Inverse(),
-					   CharacterOwner->GetMesh()->GetRelativeLocation() - CharacterOwner->GetBaseTranslationOffset())
-		};
+		const auto SmoothTransform{ ActorTransform * GetMeshSmoothingOffset() };
 
 		LocomotionState.Location = SmoothTransform.GetLocation();
 		LocomotionState.RotationQuaternion = SmoothTransform.GetRotation();
@@ -1730,7 +2980,12 @@ void ULocomotionComponent::UpdateLocomotionLocationAndRotation()
 
 void ULocomotionComponent::SetDesiredVelocityYawAngle(float NewDesiredVelocityYawAngle)
 {
-	COMPARE_ASSIGN_AND_MARK_PROPERTY_DIRTY(ThisClass, DesiredVelocityYawAngle, NewDesiredVelocityYawAngle, this);
+	if (ReplicatedIntent.VelocityYawAngle != NewDesiredVelocityYawAngle)
+	{
+		ReplicatedIntent.VelocityYawAngle = NewDesiredVelocityYawAngle;
+
+		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, ReplicatedIntent, this);
+	}
 }
 
 #pragma endregion 
@@ -1835,7 +3090,7 @@ void ULocomotionComponent::UpdateOnGroundRotation(float DeltaTime)
 		{
 			LocomotionState.bRotationTowardsLastInputDirectionBlocked = false;
 
-			const auto TargetYawAngle{ LocomotionData->bRotateTowardsDesiredVelocityInVelocityDirectionRotationMode ? DesiredVelocityYawAngle : LocomotionState.VelocityYawAngle };
+			const auto TargetYawAngle{ LocomotionData->bRotateTowardsDesiredVelocityInVelocityDirectionRotationMode ? ReplicatedIntent.VelocityYawAngle : LocomotionState.VelocityYawAngle };
 
 			static constexpr auto TargetYawAngleRotationSpeed{ 800.0f };
 
@@ -1947,13 +3202,11 @@ void ULocomotionComponent::UpdateRotation(float TargetYawAngle, float DeltaTime,
 {
 	UpdateTargetYawAngle(TargetYawAngle);
 
-	auto NewRotation{ CharacterOwner->GetActorRotation() };
+	auto NewRotation{ GetPendingActorRotation() };
 
 	NewRotation.Yaw = ULocomotionFunctionLibrary::ExponentialDecayAngle(UE_REAL_TO_FLOAT(FRotator::NormalizeAxis(NewRotation.Yaw)), TargetYawAngle, DeltaTime, RotationInterpolationSpeed);
 
-	CharacterOwner->SetActorRotation(NewRotation);
-
-	UpdateLocomotionLocationAndRotation();
+	SetPendingActorRotation(NewRotation);
 }
 
 void ULocomotionComponent::UpdateRotationExtraSmooth(float TargetYawAngle, float DeltaTime, float RotationInterpolationSpeed, float TargetYawAngleRotationSpeed)
@@ -1964,26 +3217,22 @@ void ULocomotionComponent::UpdateRotationExtraSmooth(float TargetYawAngle, float
 
 	LocomotionState.SmoothTargetYawAngle = ULocomotionFunctionLibrary::InterpolateAngleConstant(LocomotionState.SmoothTargetYawAngle, TargetYawAngle, DeltaTime, TargetYawAngleRotationSpeed);
 
-	auto NewRotation{ CharacterOwner->GetActorRotation() };
+	auto NewRotation{ GetPendingActorRotation() };
 
 	NewRotation.Yaw = ULocomotionFunctionLibrary::ExponentialDecayAngle(UE_REAL_TO_FLOAT(FRotator::NormalizeAxis(NewRotation.Yaw)), LocomotionState.SmoothTargetYawAngle, DeltaTime, RotationInterpolationSpeed);
 
-	CharacterOwner->SetActorRotation(NewRotation);
-
-	UpdateLocomotionLocationAndRotation();
+	SetPendingActorRotation(NewRotation);
 }
 
 void ULocomotionComponent::UpdateRotationInstant(float TargetYawAngle, ETeleportType Teleport)
 {
 	UpdateTargetYawAngle(TargetYawAngle);
 
-	auto NewRotation{ CharacterOwner->GetActorRotation() };
+	auto NewRotation{ GetPendingActorRotation() };
 
 	NewRotation.Yaw = TargetYawAngle;
 
-	CharacterOwner->SetActorRotation(NewRotation, Teleport);
-
-	UpdateLocomotionLocationAndRotation();
+	SetPendingActorRotation(NewRotation, Teleport);
 }
 
 void ULocomotionComponent::UpdateTargetYawAngleUsingLocomotionRotation()
@@ -2002,27 +3251,105 @@ void ULocomotionComponent::UpdateTargetYawAngle(float TargetYawAngle)
 
 void ULocomotionComponent::UpdateViewRelativeTargetYawAngle()
 {
+	if (bHeadless)
+	{
+		return;
+	}
+
 	LocomotionState.ViewRelativeTargetYawAngle = FRotator3f::NormalizeAxis(UE_REAL_TO_FLOAT(ViewState.Rotation.Yaw - LocomotionState.TargetYawAngle));
 }
 
 void ULocomotionComponent::ApplyRotationYawSpeed(float DeltaTime)
 {
-	if (auto* AnimIns{ CharacterOwner->GetMesh()->GetAnimInstance() })
+	// UCharacterAnimInstance pushes the curve values after its evaluation, other anim instances are read here
+
+	const auto* AnimIns{ CharacterOwner->GetMesh()->GetAnimInstance() };
+
+	if (!AnimIns)
 	{
-		const auto DeltaYawAngle{ AnimIns->GetCurveValue(ULocomotionGeneralNameStatics::RotationYawSpeedCurveName()) * DeltaTime };
+		// Do not keep applying the values pushed by an anim instance that no longer exists
 
-		if (FMath::Abs(DeltaYawAngle) > UE_SMALL_NUMBER)
-		{
-			auto NewRotation{ CharacterOwner->GetActorRotation() };
+		AnimCurveValues = FLocomotionAnimCurveValues();
+	}
+	else if (!AnimIns->IsA<UCharacterAnimInstance>())
+	{
+		AnimCurveValues.Read(AnimIns);
+	}
 
-			NewRotation.Yaw += DeltaYawAngle;
+	const auto DeltaYawAngle{ AnimCurveValues.Get(ELocomotionAnimCurve::RotationYawSpeed) * DeltaTime };
 
-			CharacterOwner->SetActorRotation(NewRotation);
+	if (FMath::Abs(DeltaYawAngle) > UE_SMALL_NUMBER)
+	{
+		auto NewRotation{ GetPendingActorRotation() };
 
-			UpdateLocomotionLocationAndRotation();
-			UpdateTargetYawAngleUsingLocomotionRotation();
-		}
+		NewRotation.Yaw += DeltaYawAngle;
+
+		SetPendingActorRotation(NewRotation);
+		UpdateTargetYawAngleUsingLocomotionRotation();
+	}
+}
+
+void ULocomotionComponent::BeginDeferredRotation()
+{
+	bDeferRotationCommit = true;
+	bMeshSmoothingOffsetValid = false;
+}
+
+void ULocomotionComponent::CommitPendingRotation()
+{
+	bDeferRotationCommit = false;
+
+	if (bHasPendingRotation)
+	{
+		bHasPendingRotation = false;
+
+		CharacterOwner->SetActorRotation(PendingRotation, PendingRotationTeleport);
+
+		PendingRotationTeleport = ETeleportType::None;
+	}
+
+	bMeshSmoothingOffsetValid = false;
+}
+
+void ULocomotionComponent::SetPendingActorRotation(const FRotator& NewRotation, ETeleportType Teleport)
+{
+	if (bDeferRotationCommit)
+	{
+		PendingRotation = NewRotation;
+		PendingRotationTeleport = (Teleport > PendingRotationTeleport) ? Teleport : PendingRotationTeleport;
+		bHasPendingRotation = true;
+	}
+	else
+	{
+		CharacterOwner->SetActorRotation(NewRotation, Teleport);
+
+		bMeshSmoothingOffsetValid = false;
+	}
+
+	UpdateLocomotionLocationAndRotation();
+}
+
+FRotator ULocomotionComponent::GetPendingActorRotation() const
+{
+	return bHasPendingRotation ? PendingRotation : CharacterOwner->GetActorRotation();
+}
+
+const FTransform& ULocomotionComponent::GetMeshSmoothingOffset()
+{
+	// Outside the deferred rotation, the mesh may have been moved by network smoothing at any time
+
+	if (!bMeshSmoothingOffsetValid || !bDeferRotationCommit)
+	{
+		const auto* Mesh{ CharacterOwner->GetMesh() };
+
+		MeshSmoothingOffset = FTransform(
+			Mesh->GetRelativeRotationCache().RotatorToQuat(Mesh->GetRelativeRotation()) * CharacterOwner->GetBaseRotationOffset().Inverse(),
+			Mesh->GetRelativeLocation() - CharacterOwner->GetBaseTranslationOffset());
+
+		bMeshSmoothingOffsetValid = true;
 	}
+
+	return MeshSmoothingOffset;
 }
 
 #pragma endregion
@@ -2036,3 +3363,119 @@ ULocomotionComponent* ULocomotionComponent::FindLocomotionComponent(const AChara
 }
 
 #pragma endregion
+
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLocomotionHeadlessProfileTest, "GLExt.Locomotion.HeadlessProfileTrajectory", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLocomotionHeadlessProfileTest::RunTest(const FString& Parameters)
+{
+	static constexpr auto NumMoves{ 300 };
+	static constexpr auto MoveDeltaTime{ 1.0f / 60.0f };
+	static constexpr auto LocationTolerance{ 0.01 };
+	static constexpr auto RotationTolerance{ 0.01 };
+	static constexpr auto VelocityTolerance{ 0.01 };
+
+	struct FTrajectoryPoint
+	{
+		FVector Location;
+		FRotator Rotation;
+		FVector Velocity;
+	};
+
+	/**
+	 * Simulates the same moves of a character on a flat floor with the given headless mode and records the state after each move
+	 */
+	const auto SimulateMoves
+	{
+		[](int32 HeadlessMode, TArray<FTrajectoryPoint>& OutTrajectory)
+		{
+			const auto PreviousHeadlessMode{ GLocomotionHeadlessMode };
+			GLocomotionHeadlessMode = HeadlessMode;
+
+			auto* GameInstance{ NewObject<UGameInstance>(GEngine) };
+			GameInstance->InitializeStandalone(MakeUniqueObjectName(GetTransientPackage(), UWorld::StaticClass(), TEXT("LocomotionHeadlessProfileTest")));
+
+			auto* World{ GameInstance->GetWorld() };
+
+			const FURL URL;
+			World->SetGameMode(URL);
+			World->InitializeActorsForPlay(URL);
+			World->BeginPlay();
+
+			// Floor with its top at Z = 0
+
+			auto* Floor{ World->SpawnActor<AStaticMeshActor>(FVector(0.0, 0.0, -50.0), FRotator::ZeroRotator) };
+			Floor->SetMobility(EComponentMobility::Movable);
+			Floor->GetStaticMeshComponent()->SetStaticMesh(LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube")));
+			Floor->SetActorScale3D(FVector(200.0, 200.0, 1.0));
+
+			auto* Character{ World->SpawnActorDeferred<ALocomotionCharacter>(ALocomotionCharacter::StaticClass(), FTransform(FVector(0.0, 0.0, 100.0))) };
+			auto* LC{ ULocomotionComponent::FindLocomotionComponent(Character) };
+
+			LC->SetLocomotionData(NewObject<ULocomotionData>(GetTransientPackage()));
+			LC->bRunPhysicsWithNoController = true;
+
+			Character->FinishSpawning(FTransform(FVector(0.0, 0.0, 100.0)));
+
+			// Walk in a circle with a stop in the middle
+
+			OutTrajectory.Reset(NumMoves);
+
+			for (auto Move{ 0 }; Move < NumMoves; ++Move)
+			{
+				if ((Move < NumMoves / 3) || (Move > NumMoves / 2))
+				{
+					Character->AddMovementInput(FRotator(0.0, Move * 2.0, 0.0).Vector());
+				}
+
+				++GFrameCounter;
+				World->Tick(LEVELTICK_All, MoveDeltaTime);
+
+				OutTrajectory.Add({ Character->GetActorLocation(), Character->GetActorRotation(), LC->Velocity });
+			}
+
+			GameInstance->Shutdown();
+
+			GEngine->DestroyWorldContext(World);
+			World->DestroyWorld(false);
+
+			GLocomotionHeadlessMode = PreviousHeadlessMode;
+		}
+	};
+
+	TArray<FTrajectoryPoint> FullTrajectory;
+	TArray<FTrajectoryPoint> HeadlessTrajectory;
+
+	SimulateMoves(0, FullTrajectory);
+	SimulateMoves(2, HeadlessTrajectory);
+
+	if (!TestEqual(TEXT("Number of moves"), HeadlessTrajectory.Num(), FullTrajectory.Num()))
+	{
+		return false;
+	}
+
+	for (auto Move{ 0 }; Move < FullTrajectory.Num(); ++Move)
+	{
+		const auto& Full{ FullTrajectory[Move] };
+		const auto& Headless{ HeadlessTrajectory[Move] };
+
+		if (!Full.Location.Equals(Headless.Location, LocationTolerance) ||
+			!Full.Rotation.Equals(Headless.Rotation, RotationTolerance) ||
+			!Full.Velocity.Equals(Headless.Velocity, VelocityTolerance))
+		{
+			AddError(FString::Printf(TEXT("Move %d differs: full (%s, %s, %s), headless (%s, %s, %s)"), Move,
+				*Full.Location.ToString(), *Full.Rotation.ToString(), *Full.Velocity.ToString(),
+				*Headless.Location.ToString(), *Headless.Rotation.ToString(), *Headless.Velocity.ToString()));
+
+			return false;
+		}
+	}
+
+	TestFalse(TEXT("Character moved"), FullTrajectory.Last().Location.Equals(FullTrajectory[0].Location, 1.0));
+
+	return true;
+}
+
+#endif
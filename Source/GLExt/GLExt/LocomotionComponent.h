@@ -4,12 +4,20 @@
 
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Components/GameFrameworkInitStateInterface.h"
+#include "WorldCollision.h"
 
+#include "CustomMovement/CustomMovementStateBlock.h"
 #include "State/ViewState.h"
 #include "State/MovementBaseState.h"
 #include "State/LocomotionState.h"
 #include "Type/LocomotionConfigTypes.h"
+#include "Type/LocomotionConfigTable.h"
+#include "Type/LocomotionFloorCache.h"
 #include "Type/LocomotionNetworkTypes.h"
+#include "Type/LocomotionReplicatedIntent.h"
+#include "Type/LocomotionAnimSnapshot.h"
+#include "Type/LocomotionAnimCurves.h"
+#include "LocomotionStateSubsystem.h"
 
 #include "GameplayTagContainer.h"
 
@@ -17,6 +25,8 @@
 
 class ULocomotionData;
 class UCustomMovementProcess;
+class UCharacterAnimInstance;
+struct FStreamableHandle;
 struct FBasedMovementInfo;
 struct FRuntimeFloatCurve;
 
@@ -33,10 +43,13 @@ class GLEXT_API ULocomotionComponent
 
 	friend class FLocomotionSavedMove;
 	friend class UCustomMovementProcess;
+	friend class ULocomotionStateSubsystem;
 
 public:
 	ULocomotionComponent(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
 
+	static void AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector);
+
 #if WITH_EDITOR
 	virtual bool CanEditChange(const FProperty* Property) const override;
 #endif
@@ -60,6 +73,17 @@ protected:
 	virtual void BeginPlay() override;
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
+protected:
+	//
+	// Index in ULocomotionStateSubsystem (INDEX_NONE if not registered)
+	//
+	int32 StateSubsystemIndex{ INDEX_NONE };
+
+	//
+	// Locomotion values precomputed by ULocomotionStateSubsystem before actors tick
+	//
+	FLocomotionPrecomputedState PrecomputedState;
+
 public:
 	virtual FName GetFeatureName() const override { return NAME_ActorFeatureName; }
 	virtual bool CanChangeInitState(UGameFrameworkComponentManager* Manager, FGameplayTag CurrentState, FGameplayTag DesiredState) const override;
@@ -100,9 +124,31 @@ protected:
 
 	//
 	// Instance list of CustomMovementProcess defined by LocomotionData
+	// 
+	// Tips:
+	//	Indexed by the slot of CustomMovementProcessesData->GetCustomMovementProcessSlot().
 	//
 	UPROPERTY(Transient)
-	TMap<uint8, TObjectPtr<UCustomMovementProcess>> CustomMovementProcesses;
+	TArray<TObjectPtr<UCustomMovementProcess>> CustomMovementProcesses;
+
+	//
+	// LocomotionData used to create CustomMovementProcesses
+	//
+	UPROPERTY(Transient)
+	TObjectPtr<const ULocomotionData> CustomMovementProcessesData;
+
+	//
+	// Per-character states of CustomMovementProcesses
+	//
+	FCustomMovementStateBlock CustomMovementStates;
+
+	//
+	// Handle of streaming CustomMovementProcess classes defined by LocomotionData
+	// 
+	// Tips:
+	//	It is kept after loading is completed so that the loaded classes stay in memory.
+	//
+	TSharedPtr<FStreamableHandle> CustomMovementProcessesLoadHandle;
 
 protected:
 	/**
@@ -110,11 +156,31 @@ protected:
 	 */
 	virtual void ApplyLocomotionData();
 
+	/**
+	 * Start streaming CustomMovementProcess classes defined in LocomotionData and their asset bundle.
+	 */
+	void LoadCustomMovementProcesses();
+
+	/**
+	 * Calls when streaming of CustomMovementProcess classes is completed
+	 */
+	void HandleCustomMovementProcessesLoaded();
+
+	/**
+	 * Returns whether CustomMovementProcess classes are being streamed
+	 */
+	bool IsLoadingCustomMovementProcesses() const;
+
 	/**
 	 * Create instances of CustomMovementProcess defined in LocomotionData.
 	 */
 	void CreateCustomMovementProcesses();
 
+	/**
+	 * Returns the instance of CustomMovementProcess for the custom movement mode and its slot
+	 */
+	UCustomMovementProcess* GetCustomMovementProcess(uint8 InCustomMovementMode, int32& OutSlot) const;
+
 	/**
 	 * Calls when locomotion data set or changed
 	 */
@@ -130,6 +196,11 @@ public:
 	UFUNCTION(BlueprintCallable)
 	void SetLocomotionData(const ULocomotionData* NewLocomotionData);
 
+	/**
+	 * Returns the current locomotion data
+	 */
+	const ULocomotionData* GetLocomotionData() const { return LocomotionData; }
+
 #pragma endregion
 
 
@@ -206,6 +277,27 @@ public:
 	 */
 	void UpdateVisibilityBasedAnimTickOption() const;
 
+	/**
+	 * Returns whether the pose of the mesh should be ticked even when it is not rendered
+	 * 
+	 * Tips:
+	 *	It is required when the server processes the moves of an autonomous proxy that may use root motion.
+	 */
+	bool ShouldTickPoseWhenNotRendered() const;
+
+	/**
+	 * Select the LOD tier of this frame and decide whether the locomotion is updated with full fidelity
+	 * 
+	 * Tips:
+	 *	Reduced frames are also synchronized with the frames skipped by the URO of the mesh.
+	 */
+	void UpdateLocomotionLOD(float DeltaTime);
+
+	/**
+	 * Returns the index of LODTiers in LocomotionData to be used (INDEX_NONE for full fidelity without LOD)
+	 */
+	int32 EvaluateLocomotionLODTier() const;
+
 	/**
 	 * Update MovementBase
 	 */
@@ -214,7 +306,116 @@ public:
 	/**
 	 * Notify AnimInstance of updates
 	 */
-	void UpdateAnimInstanceMovement();
+	void UpdateAnimInstanceMovement(float DeltaTime);
+
+	/**
+	 * Returns whether the character is at rest and the pose of the main mesh can be frozen
+	 * 
+	 * Tips:
+	 *	Must be called before the snapshot of this frame is published, since the states are compared with the last one.
+	 */
+	bool IsAtRestForAnimation() const;
+
+	/**
+	 * Feed the significance of the main mesh to the animation budget allocator
+	 * 
+	 * Tips:
+	 *	Does nothing if the main mesh is not a USkeletalMeshComponentBudgeted registered with the allocator or the allocator is disabled.
+	 *	AnimIns may be null for headless characters and anim instances that are not UCharacterAnimInstance.
+	 *	While an update of the anim instance is pending, the mesh is never skipped
+	 *	so that the pose is not interpolated from the one evaluated before the skipped frames.
+	 */
+	void UpdateAnimBudget(USkeletalMeshComponent* MainMesh, const UCharacterAnimInstance* AnimIns) const;
+
+	/**
+	 * Returns the significance of the main mesh for the animation budget allocator
+	 */
+	float CalculateAnimBudgetSignificance(const USkeletalMeshComponent* MainMesh) const;
+
+protected:
+	//
+	// Snapshots of the locomotion published for the animation
+	// 
+	// Tips:
+	//	Double buffered so that the snapshot read by the animation is never the one being written.
+	//
+	FLocomotionAnimSnapshot AnimSnapshots[2];
+	int32 AnimSnapshotIndex{ 0 };
+
+public:
+	/**
+	 * Publish the snapshot of the locomotion for FLocomotionAnimInstanceProxy
+	 */
+	void PublishAnimSnapshot();
+
+	/**
+	 * Returns the last published snapshot of the locomotion
+	 */
+	const FLocomotionAnimSnapshot& GetAnimSnapshot() const { return AnimSnapshots[AnimSnapshotIndex]; }
+
+protected:
+	//
+	// Values of the locomotion curves of the main mesh after its last evaluation
+	// 
+	// Tips:
+	//	Pushed by UCharacterAnimInstance so that the movement does not read the anim instance during the movement tick.
+	//
+	FLocomotionAnimCurveValues AnimCurveValues;
+
+public:
+	/**
+	 * Set the values of the locomotion curves of the main mesh
+	 */
+	void SetAnimCurveValues(const FLocomotionAnimCurveValues& NewAnimCurveValues) { AnimCurveValues = NewAnimCurveValues; }
+
+	/**
+	 * Returns the values of the locomotion curves of the main mesh
+	 */
+	const FLocomotionAnimCurveValues& GetAnimCurveValues() const { return AnimCurveValues; }
+
+protected:
+	//
+	// Index of LODTiers in LocomotionData used in this frame (INDEX_NONE for full fidelity without LOD)
+	//
+	int32 LocomotionLODTier{ INDEX_NONE };
+
+	//
+	// Time accumulated since the last full update of the locomotion
+	//
+	float LocomotionLODDeltaTime{ 0.0f };
+
+	//
+	// Whether the locomotion is updated with the reduced update in this frame
+	//
+	bool bLocomotionLODReduced{ false };
+
+public:
+	/**
+	 * Returns the index of LODTiers in LocomotionData used in this frame (INDEX_NONE for full fidelity without LOD)
+	 */
+	int32 GetLocomotionLODTier() const { return LocomotionLODTier; }
+
+protected:
+	//
+	// Whether this component runs with the headless profile
+	// 
+	// Tips:
+	//	In the headless profile, values only read by animation and the mesh are not derived,
+	//	while everything read by movement, prediction and replication is still updated.
+	//	It is selected in BeginPlay() by "glext.Headless.Mode".
+	//
+	bool bHeadless{ false };
+
+	/**
+	 * Select whether this component runs with the headless profile
+	 */
+	void UpdateHeadlessProfile();
+
+public:
+	/**
+	 * Returns whether this component runs with the headless profile
+	 */
+	bool IsHeadless() const { return bHeadless; }
 
 #pragma endregion
 
@@ -239,7 +440,100 @@ protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "State|Locomotion Mode", Transient)
 	bool bMovementModeLocked;
 
+	//
+	// Cached state ids of the tags used to look up the config table of LocomotionData
+	//
+	FLocomotionStateIdCache LocomotionModeIdCache;
+	FLocomotionStateIdCache DesiredRotationModeIdCache;
+	FLocomotionStateIdCache DesiredStanceIdCache;
+	FLocomotionStateIdCache DesiredGaitIdCache;
+	FLocomotionStateIdCache RotationModeIdCache;
+	FLocomotionStateIdCache StanceIdCache;
+	FLocomotionStateIdCache GaitIdCache;
+
+	//
+	// Whether the configs must be resolved on the next update regardless of the inputs
+	//
+	bool bLocomotionConfigsDirty{ true };
+
+	//
+	// Inputs at the time the configs were last resolved
+	//
+	FLocomotionConfigResolveInputs ResolvedConfigInputs;
+
+public:
+	/**
+	 * Pack the state ids of RotationMode, Stance and Gait into a bitfield for the saved moves and the network move data
+	 * 
+	 * Tips:
+	 *	Each field uses the bits returned by GetPackedLocomotionStatesBits() of the config table of LocomotionData,
+	 *	and stores the state id plus one so that zero means an unknown state.
+	 */
+	uint32 PackLocomotionStates();
+
+	/**
+	 * Apply RotationMode, Stance and Gait packed by PackLocomotionStates()
+	 * 
+	 * Tips:
+	 *	Unknown states are ignored and the current state is kept.
+	 *	If any state id is out of range of the config table, nothing is applied.
+	 */
+	void UnpackLocomotionStates(uint32 PackedStates);
+
+	/**
+	 * Pack the state ids of DesiredRotationMode, DesiredStance and DesiredGait in the same layout as PackLocomotionStates()
+	 * 
+	 * Tips:
+	 *	Carried in the saved moves and the network move data so that changes of the desired states reach the server
+	 *	with the moves instead of separate reliable RPCs.
+	 */
+	uint32 PackDesiredLocomotionStates();
+
+	/**
+	 * Apply DesiredRotationMode, DesiredStance and DesiredGait packed by PackDesiredLocomotionStates() (SERVER)
+	 * 
+	 * Tips:
+	 *	Only applied when the packed states differ from the ones last applied from the client,
+	 *	so that the desired states set on the server are kept until the client changes its own.
+	 *	Changes are limited by "glext.Network.MaxDesiredStateChangesPerSecond".
+	 *	A rejected change is not lost, since every following move of the client carries the desired states again.
+	 */
+	void ApplyDesiredLocomotionStates(uint32 PackedDesiredStates);
+
+	/**
+	 * Returns the number of bits used by PackLocomotionStates() and PackDesiredLocomotionStates()
+	 */
+	int32 GetPackedLocomotionStatesBits() const;
+
+protected:
+	//
+	// Desired states packed by the owning client that were last applied or matched the current ones (SERVER)
+	//
+	uint32 LastReceivedPackedDesiredStates{ 0 };
+	bool bHasReceivedPackedDesiredStates{ false };
+
+	//
+	// Number of changes of the desired states that the owning client can still make (SERVER)
+	// 
+	// Tips:
+	//	Refilled over time up to "glext.Network.MaxDesiredStateChangesPerSecond".
+	//
+	float DesiredStateChangeTokens{ 0.0f };
+
+	//
+	// World time at which DesiredStateChangeTokens was last refilled (SERVER)
+	//
+	double DesiredStateChangeTokensTime{ -1.0 };
+
+	/**
+	 * Consume one change of the desired states requested by the owning client
+	 * 
+	 * Returns false if the rate limit has been exceeded.
+	 */
+	bool ConsumeDesiredStateChangeToken();
+
 public:
+
 	virtual void SetMovementMode(EMovementMode NewMovementMode, uint8 NewCustomMode = 0) override;
 
 	/**
@@ -264,6 +558,18 @@ protected:
 	 */
 	void UpdateLocomotionConfigs();
 
+	/**
+	 * Returns whether any input read while resolving configs has changed since the last UpdateLocomotionConfigs()
+	 */
+	bool ShouldUpdateLocomotionConfigs() const;
+
+public:
+	/**
+	 * Force the configs to be resolved on the next update
+	 */
+	void MarkLocomotionConfigsDirty() { bLocomotionConfigsDirty = true; }
+
+protected:
 	/**
 	 * Notify that MovementMode has changed
 	 */
@@ -298,6 +604,10 @@ public:
 private:
 	/**
 	 * Set current DesiredRotationMode (SERVER)
+	 * 
+	 * Tips:
+	 *	Only used when the movement of the character is not replicated.
+	 *	Otherwise the desired states are sent with the moves. (See PackDesiredLocomotionStates())
 	 */
 	UFUNCTION(Server, Reliable)
 	void Server_SetDesiredRotationMode(FGameplayTag NewDesiredRotationMode);
@@ -359,6 +669,10 @@ public:
 private:
 	/**
 	 * Set current DesiredStance (SERVER)
+	 * 
+	 * Tips:
+	 *	Only used when the movement of the character is not replicated.
+	 *	Otherwise the desired states are sent with the moves. (See PackDesiredLocomotionStates())
 	 */
 	UFUNCTION(Server, Reliable)
 	void Server_SetDesiredStance(FGameplayTag NewDesiredStance);
@@ -421,6 +735,10 @@ public:
 private:
 	/**
 	 * Set current DesiredGait (SERVER)
+	 * 
+	 * Tips:
+	 *	Only used when the movement of the character is not replicated.
+	 *	Otherwise the desired states are sent with the moves. (See PackDesiredLocomotionStates())
 	 */
 	UFUNCTION(Server, Reliable)
 	void Server_SetDesiredGait(FGameplayTag NewDesiredGait);
@@ -530,17 +848,33 @@ public:
 #pragma region Input
 protected:
 	//
-	// Replicated input direction
+	// Input direction, view rotation and desired velocity yaw angle replicated to simulated proxies
+	// 
+	// Tips:
+	//	The values are replicated as one struct so that they share a single quantized and delta compressed serializer.
+	//	(See FLocomotionReplicatedIntentNetSerializer)
 	//
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "State|Input", Transient, Replicated)
-	FVector_NetQuantizeNormal InputDirection;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "State|Input", Transient, ReplicatedUsing = "OnReplicated_ReplicatedIntent")
+	FLocomotionReplicatedIntent ReplicatedIntent;
 
 public:
 	/**
 	 * Get current InputDirection
 	 */
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "State|Input")
-	const FVector& GetInputDirection() const { return InputDirection; }
+	const FVector& GetInputDirection() const { return ReplicatedIntent.InputDirection; }
+
+	/**
+	 * Get current ReplicatedIntent
+	 */
+	const FLocomotionReplicatedIntent& GetReplicatedIntent() const { return ReplicatedIntent; }
+
+protected:
+	/**
+	 * Notify that ReplicatedIntent has been replicated.
+	 */
+	UFUNCTION()
+	void OnReplicated_ReplicatedIntent(const FLocomotionReplicatedIntent& PreviousIntent);
 
 protected:
 	virtual FVector ConsumeInputVector() override;
@@ -562,15 +896,6 @@ protected:
 	// View
 #pragma region View
 protected:
-	//
-	// Raw viewpoint rotation information replicated in the network.
-	// 
-	// Tips:
-	//	Basically, use FViewState::Rotation, which takes advantage of network smoothing.
-	//
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "State|View", Transient, ReplicatedUsing = "OnReplicated_ReplicatedViewRotation")
-	FRotator ReplicatedViewRotation;
-
 	//
 	// Current view state of Character
 	// (回転, 速度 ...)
@@ -578,6 +903,17 @@ protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "State|View", Transient)
 	FViewState ViewState;
 
+	//
+	// View rotation last sent by Server_SetReplicatedViewRotation() and the time it was sent
+	//
+	FRotator LastUploadedViewRotation{ ForceInit };
+	double LastViewRotationUploadTime{ -1.0 };
+
+	//
+	// Whether the view rotation has changed beyond the dead band but has not been uploaded yet because of the rate limit
+	//
+	bool bViewRotationUploadPending{ false };
+
 public:
 	/**
 	 * Get current ViewState
@@ -602,23 +938,28 @@ private:
 	void UpdateViewNetworkSmoothing(float DeltaTime);
 
 	/**
-	 * Set current ReplicatedViewRotation
+	 * Set current view rotation of ReplicatedIntent
 	 */
 	void SetReplicatedViewRotation(const FRotator& NewViewRotation);
 
 	/**
-	 * Notify that ReplicatedViewRotation has been replicated.
-	 */
-	UFUNCTION()
-	void OnReplicated_ReplicatedViewRotation();
-
-	/**
-	 * Set current ReplicatedViewRotation (SERVER)
+	 * Set current view rotation of ReplicatedIntent (SERVER)
 	 */
 	UFUNCTION(Server, Unreliable)
 	void Server_SetReplicatedViewRotation(const FRotator& NewViewRotation);
 	void Server_SetReplicatedViewRotation_Implementation(const FRotator& NewViewRotation);
 
+	/**
+	 * Upload the view rotation to the server according to the upload policy of LocomotionData
+	 * 
+	 * Tips:
+	 *	Changes within ViewRotationUploadDeadBand are not uploaded,
+	 *	changes beyond ViewRotationUploadFlushAngle are uploaded immediately,
+	 *	and other changes are uploaded at most ViewRotationUploadMaxRate times per second.
+	 *	Only used while the movement is not replicated, so no move is sent that the upload could be flushed with.
+	 */
+	void UploadViewRotation();
+
 #pragma endregion
 
 
@@ -633,12 +974,6 @@ protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "State", Transient)
 	FLocomotionState LocomotionState;
 
-	//
-	// Direction angle of replicated travel speed
-	//
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "State", Transient, Replicated, Meta = (ClampMin = -180, ClampMax = 180, ForceUnits = "deg"))
-	float DesiredVelocityYawAngle;
-
 	//
 	// The previous update of ControlRotation
 	// 
@@ -677,6 +1012,85 @@ public:
 		float SweepRadius,
 		const FHitResult* DownwardSweepResult) const override;
 
+	virtual void OnTeleported() override;
+
+protected:
+	//
+	// Cache of the last floor found by ComputeFloorDist()
+	//
+	mutable FLocomotionFloorCache FloorCache;
+
+	/**
+	 * Find the floor with the scene queries without using the cache
+	 */
+	void ComputeFloorDistUncached(
+		const FVector& CapsuleLocation,
+		float LineDistance,
+		float SweepDistance,
+		FFindFloorResult& OutFloorResult,
+		float SweepRadius,
+		const FHitResult* DownwardSweepResult,
+		float PawnRadius,
+		float PawnHalfHeight) const;
+
+public:
+	/**
+	 * Discard the cached floor so that the next floor check runs the scene queries
+	 * 
+	 * Tips:
+	 *	Call this when the floor under the character has been changed without moving the character.
+	 */
+	void InvalidateFloorCache() { FloorCache.Invalidate(); }
+
+protected:
+	//
+	// Handle of the asynchronous floor sweep issued for the location predicted for the next frame
+	//
+	mutable FTraceHandle FloorProbeHandle;
+
+	//
+	// Capsule location and query used by the asynchronous floor sweep
+	//
+	FVector FloorProbeLocation{ FVector::ZeroVector };
+	float FloorProbeSweepDistance{ 0.0f };
+	float FloorProbeSweepRadius{ 0.0f };
+	float FloorProbeHalfHeight{ 0.0f };
+	float FloorProbeShrinkHeight{ 0.0f };
+
+	//
+	// Sweep distance and radius of the last floor check used to issue the next asynchronous floor sweep
+	//
+	mutable float LastFloorSweepDistance{ 0.0f };
+	mutable float LastFloorSweepRadius{ 0.0f };
+
+public:
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+	/**
+	 * Returns whether the floor of this character is probed asynchronously one frame ahead
+	 * 
+	 * Tips:
+	 *	Only AI and simulated proxies walking on the ground are probed,
+	 *	since the trajectory of locally controlled characters cannot be predicted.
+	 */
+	bool ShouldProbeFloorAsync() const;
+
+	/**
+	 * Issue the asynchronous floor sweep at the location predicted for the next frame
+	 */
+	void IssueFloorProbe(float DeltaTime);
+
+	/**
+	 * Get the floor from the asynchronous floor sweep if it was issued for the query at the capsule location
+	 * 
+	 * Tips:
+	 *	Returns true only if the sweep found a walkable floor within the sweep distance of the actual capsule,
+	 *	otherwise the synchronous queries must be run.
+	 */
+	bool ConsumeFloorProbe(const FVector& CapsuleLocation, float SweepDistance, float SweepRadius, float PawnRadius, float PawnHalfHeight, FFindFloorResult& OutFloorResult) const;
+
+public:
 	/**
 	 * Get current LocomotionState
 	 */
@@ -694,6 +1108,19 @@ protected:
 
 	bool TryConsumePrePenetrationAdjustmentVelocity(FVector& OutVelocity);
 
+public:
+	//
+	// Number of moves and RPCs received from the owning client (SERVER)
+	// 
+	// Tips:
+	//	Only counted in non-shipping builds for the replication benchmark of ULocomotionNetBenchmarkSubsystem.
+	//
+	uint32 NumMovesReceived{ 0 };
+	uint32 NumViewRotationRPCsReceived{ 0 };
+	uint32 NumDesiredStateRPCsReceived{ 0 };
+
+protected:
+
 	/**
 	 * Moving updates performed before other updates
 	 */
@@ -704,6 +1131,16 @@ protected:
 	 */
 	virtual void UpdateLocomotion(float DeltaTime);
 
+	/**
+	 * Cheap update of the locomotion used instead of the full update in frames reduced by LOD
+	 */
+	virtual void UpdateLocomotionReduced(float DeltaTime);
+
+	/**
+	 * Update the velocity, speed and velocity yaw angle of LocomotionState
+	 */
+	void UpdateLocomotionVelocity();
+
 	/**
 	 * Moving updates performed after other updates
 	 */
@@ -719,7 +1156,7 @@ private:
 	void ApplyPendingPenetrationAdjustment();
 
 	/**
-	 * Set current DesiredVelocityYawAngle
+	 * Set current desired velocity yaw angle of ReplicatedIntent
 	 */
 	void SetDesiredVelocityYawAngle(float NewDesiredVelocityYawAngle);
 
@@ -787,6 +1224,68 @@ private:
 	 */
 	void ApplyRotationYawSpeed(float DeltaTime);
 
+protected:
+	//
+	// Rotation of the actor written by the rotation updaters and not yet committed
+	//
+	FRotator PendingRotation{ ForceInitToZero };
+
+	//
+	// Teleport type used when PendingRotation is committed
+	//
+	ETeleportType PendingRotationTeleport{ ETeleportType::None };
+
+	//
+	// Whether PendingRotation has been written since the last commit
+	//
+	bool bHasPendingRotation{ false };
+
+	//
+	// Whether rotations are accumulated in PendingRotation instead of being applied to the actor immediately
+	// 
+	// Tips:
+	//	Enabled during UpdateCharacterStateBeforeMovement() so that the actor transform,
+	//	and the transforms of all its attached components, are updated at most once per tick.
+	//
+	bool bDeferRotationCommit{ false };
+
+	//
+	// Offset of the mesh from the actor used to compute the smoothed location and rotation
+	// 
+	// Tips:
+	//	Network smoothing only moves the mesh after the movement, 
+	//	so the offset is computed once and reused until the pending rotation is committed.
+	//
+	FTransform MeshSmoothingOffset{ FTransform::Identity };
+
+	bool bMeshSmoothingOffsetValid{ false };
+
+protected:
+	/**
+	 * Start accumulating the rotations written by the rotation updaters
+	 */
+	void BeginDeferredRotation();
+
+	/**
+	 * Apply the accumulated rotation to the actor and stop accumulating
+	 */
+	void CommitPendingRotation();
+
+	/**
+	 * Set the rotation of the actor, or accumulate it while the rotation is deferred
+	 */
+	void SetPendingActorRotation(const FRotator& NewRotation, ETeleportType Teleport = ETeleportType::None);
+
+	/**
+	 * Returns the rotation of the actor including the rotation not yet committed
+	 */
+	FRotator GetPendingActorRotation() const;
+
+	/**
+	 * Returns the offset of the mesh from the actor used for network smoothing
+	 */
+	const FTransform& GetMeshSmoothingOffset();
+
 #pragma endregion
 
 
@@ -3,11 +3,19 @@
 #include "LocomotionData.h"
 
 #include "Condition/LocomotionCondition.h"
+#include "CustomMovement/CustomMovementProcess.h"
 #include "GameplayTag/GLETags_Status.h"
+#include "GLExtLogs.h"
+
+#if WITH_EDITOR
+#include "Misc/DataValidation.h"
+#endif
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionData)
 
 
+const FName ULocomotionData::NAME_LocomotionBundle("Locomotion");
+
 ULocomotionData::ULocomotionData(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
@@ -30,70 +38,246 @@ ULocomotionData::ULocomotionData(const FObjectInitializer& ObjectInitializer)
 	DefaultRotationMode = TAG_Status_RotationMode_ViewDirection;
 	DefaultStance = TAG_Status_Stance_Standing;
 	DefaultGait = TAG_Status_Gait_Walking;
+
+	// Tables are filled with INDEX_NONE until the config table is built
+
+	BuildMovementModeTables();
 }
 
+void ULocomotionData::PostInitProperties()
+{
+	Super::PostInitProperties();
 
-const FCharacterLocomotionModeConfigs& ULocomotionData::GetLocomotionModeConfig(const FGameplayTag& LomotionMode) const
+	// Loaded assets are built in PostLoad() after their properties are serialized
+
+	if (!HasAnyFlags(RF_ClassDefaultObject | RF_NeedLoad))
+	{
+		BuildConfigTable();
+	}
+}
+
+void ULocomotionData::PostLoad()
 {
-	auto* Configs{ LocomotionModes.Find(LomotionMode) };
+	Super::PostLoad();
 
-	check(Configs);
+	BuildConfigTable();
+}
 
-	return *Configs;
+#if WITH_EDITOR
+void ULocomotionData::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	BuildConfigTable();
 }
 
-FGameplayTag ULocomotionData::Convert_MovementModeToLocomotionMode(const EMovementMode& MovementMode, const uint8& CustomMovementMode) const
+EDataValidationResult ULocomotionData::IsDataValid(FDataValidationContext& Context) const
 {
-	if (MovementMode == MOVE_Custom)
+	auto Result{ CombineDataValidationResults(Super::IsDataValid(Context), EDataValidationResult::Valid) };
+
+	for (const auto& Error : ConfigTable.GetBuildErrors())
 	{
-		return CustomMovementModeToLocomotionMode.FindRef(CustomMovementMode);
+		Context.AddError(FText::FromString(Error));
+
+		Result = EDataValidationResult::Invalid;
 	}
-	else
+
+	for (const auto& Warning : ConfigTable.GetBuildWarnings())
 	{
-		return MovementModeToLocomotionMode.FindRef(MovementMode);
+		Context.AddWarning(FText::FromString(Warning));
 	}
 
-	return FGameplayTag();
+	return Result;
 }
+#endif
 
-void ULocomotionData::Convert_LocomotionModeToMovementMode(const FGameplayTag& LocomotionMode, EMovementMode& MovementMode, uint8& CustomMovementMode) const
+#if WITH_EDITORONLY_DATA
+void ULocomotionData::UpdateAssetBundleData()
 {
-	MovementMode = MOVE_None;
-	CustomMovementMode = 0;
+	// Classes are added to the bundle by AssetBundles meta of CustomMovementProcesses
+
+	Super::UpdateAssetBundleData();
+
+	// Let each process add the assets it needs at runtime
+
+	for (const auto& KVP : CustomMovementProcesses)
+	{
+		const auto* ProcessClass{ KVP.Value.LoadSynchronous() };
 
-	if (const auto* FoundMovementMode{ MovementModeToLocomotionMode.FindKey(LocomotionMode) })
+		if (auto* ProcessCDO{ ProcessClass ? ProcessClass->GetDefaultObject<UCustomMovementProcess>() : nullptr })
+		{
+			ProcessCDO->AddAdditionalAssetBundleData(AssetBundleData);
+		}
+	}
+}
+#endif
+
+
+void ULocomotionData::BuildConfigTable()
+{
+	ConfigTable.Build(LocomotionModes);
+
+	BuildMovementModeTables();
+
+	for (const auto& Error : ConfigTable.GetBuildErrors())
 	{
-		MovementMode = *FoundMovementMode;
+		UE_LOG(LogGLE, Error, TEXT("LocomotionData(%s): %s"), *GetNameSafe(this), *Error);
 	}
-	else if(const auto* FoundCustomMovementMode{ CustomMovementModeToLocomotionMode.FindKey(LocomotionMode) })
+
+	for (const auto& Warning : ConfigTable.GetBuildWarnings())
 	{
-		MovementMode = MOVE_Custom;
-		CustomMovementMode = *FoundCustomMovementMode;
+		UE_LOG(LogGLE, Warning, TEXT("LocomotionData(%s): %s"), *GetNameSafe(this), *Warning);
 	}
 }
 
-bool ULocomotionData::CanChangeMovementModeTo(const ULocomotionComponent* LC, const EMovementMode& MovementMode, const uint8& CustomMovementMode) const
+
+void ULocomotionData::BuildMovementModeTables()
 {
-	// false if no matching LocomotionMode is found
+	// MovementMode -> LocomotionMode
 
-	const auto LocomotionModeTag{ Convert_MovementModeToLocomotionMode(MovementMode, CustomMovementMode) };
+	for (auto& StateId : MovementModeStateIds)
+	{
+		StateId = INDEX_NONE;
+	}
 
-	if (!LocomotionModeTag.IsValid())
+	for (auto& StateId : CustomMovementModeStateIds)
 	{
-		return false;
+		StateId = INDEX_NONE;
 	}
 
-	// true if Condition is not set
+	for (const auto& KVP : MovementModeToLocomotionMode)
+	{
+		if (KVP.Key < MOVE_MAX)
+		{
+			MovementModeStateIds[KVP.Key] = ConfigTable.FindStateId(ELocomotionConfigLevel::LocomotionMode, KVP.Value);
+		}
+	}
+
+	for (const auto& KVP : CustomMovementModeToLocomotionMode)
+	{
+		CustomMovementModeStateIds[KVP.Key] = ConfigTable.FindStateId(ELocomotionConfigLevel::LocomotionMode, KVP.Value);
+	}
+
+	// LocomotionMode -> MovementMode
+	// 
+	// Note:
+	//	The first mapping found is used, giving priority to MovementMode over CustomMovementMode.
+
+	LocomotionModeMovementModes.Init({ MOVE_None, 0 }, ConfigTable.GetNumStates(ELocomotionConfigLevel::LocomotionMode));
 
-	const auto& Configs{ GetLocomotionModeConfig(LocomotionModeTag) };
-	const auto& Condition{ Configs.Condition };
+	TBitArray<> bMapped{ false, LocomotionModeMovementModes.Num() };
 
-	if (!Condition)
+	for (const auto& KVP : MovementModeToLocomotionMode)
 	{
-		return true;
+		const auto StateId{ ConfigTable.FindStateId(ELocomotionConfigLevel::LocomotionMode, KVP.Value) };
+
+		if ((StateId != INDEX_NONE) && !bMapped[StateId])
+		{
+			LocomotionModeMovementModes[StateId] = { KVP.Key, 0 };
+			bMapped[StateId] = true;
+		}
+	}
+
+	for (const auto& KVP : CustomMovementModeToLocomotionMode)
+	{
+		const auto StateId{ ConfigTable.FindStateId(ELocomotionConfigLevel::LocomotionMode, KVP.Value) };
+
+		if ((StateId != INDEX_NONE) && !bMapped[StateId])
+		{
+			LocomotionModeMovementModes[StateId] = { MOVE_Custom, KVP.Key };
+			bMapped[StateId] = true;
+		}
+	}
+
+	// CustomMovementMode -> CustomMovementProcess
+
+	for (auto& Slot : CustomMovementProcessSlots)
+	{
+		Slot = INDEX_NONE;
+	}
+
+	CustomMovementProcessModes.Reset();
+
+	for (const auto& KVP : CustomMovementProcesses)
+	{
+		if (!KVP.Value.IsNull())
+		{
+			CustomMovementProcessSlots[KVP.Key] = static_cast<int16>(CustomMovementProcessModes.Add(KVP.Key));
+		}
+	}
+}
+
+UCustomMovementProcess* ULocomotionData::GetSharedCustomMovementProcess(uint8 CustomMovementMode, const UClass* ProcessClass) const
+{
+	auto& SharedProcesses{ const_cast<ULocomotionData*>(this)->SharedCustomMovementProcesses };
+	auto& Process{ SharedProcesses.FindOrAdd(CustomMovementMode) };
+
+	if (!Process || (Process->GetClass() != ProcessClass))
+	{
+		// Transient so that the instance is never saved into the data asset when it is edited while playing
+
+		Process = NewObject<UCustomMovementProcess>(const_cast<ULocomotionData*>(this), ProcessClass, NAME_None, RF_Transient);
+	}
+
+	return Process;
+}
+
+void ULocomotionData::GetUnloadedCustomMovementProcessPaths(TArray<FSoftObjectPath>& OutPaths) const
+{
+	for (const auto& KVP : CustomMovementProcesses)
+	{
+		const auto& SoftClass{ KVP.Value };
+
+		if (!SoftClass.IsNull() && !SoftClass.Get())
+		{
+			OutPaths.AddUnique(SoftClass.ToSoftObjectPath());
+		}
+	}
+}
+
+const FCharacterLocomotionModeConfigs& ULocomotionData::GetLocomotionModeConfig(const FGameplayTag& LomotionMode) const
+{
+	auto* Configs{ LocomotionModes.Find(LomotionMode) };
+
+	check(Configs);
+
+	return *Configs;
+}
+
+FGameplayTag ULocomotionData::Convert_MovementModeToLocomotionMode(const EMovementMode& MovementMode, const uint8& CustomMovementMode) const
+{
+	return ConfigTable.GetStateTag(ELocomotionConfigLevel::LocomotionMode, GetLocomotionModeStateId(MovementMode, CustomMovementMode));
+}
+
+void ULocomotionData::Convert_LocomotionModeStateIdToMovementMode(int32 StateId, EMovementMode& MovementMode, uint8& CustomMovementMode) const
+{
+	MovementMode = MOVE_None;
+	CustomMovementMode = 0;
+
+	if (LocomotionModeMovementModes.IsValidIndex(StateId))
+	{
+		MovementMode = LocomotionModeMovementModes[StateId].Key;
+		CustomMovementMode = LocomotionModeMovementModes[StateId].Value;
+	}
+}
+
+void ULocomotionData::Convert_LocomotionModeToMovementMode(const FGameplayTag& LocomotionMode, EMovementMode& MovementMode, uint8& CustomMovementMode) const
+{
+	Convert_LocomotionModeStateIdToMovementMode(ConfigTable.FindStateId(ELocomotionConfigLevel::LocomotionMode, LocomotionMode), MovementMode, CustomMovementMode);
+}
+
+bool ULocomotionData::CanChangeMovementModeTo(const ULocomotionComponent* LC, const EMovementMode& MovementMode, const uint8& CustomMovementMode) const
+{
+	// false if no matching LocomotionMode is found
+
+	const auto ModeNode{ ConfigTable.FindLocomotionMode(GetLocomotionModeStateId(MovementMode, CustomMovementMode)) };
+
+	if (ModeNode == INDEX_NONE)
+	{
+		return false;
 	}
 
-	// Return the result of Condition
+	// Return the result of Condition (true if Condition is not set)
 
-	return Condition->CanEnter(LC);
+	return ConfigTable.CanEnterNode(ELocomotionConfigLevel::LocomotionMode, ModeNode, FLocomotionConditionContext(LC));
 }
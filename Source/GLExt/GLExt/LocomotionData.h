@@ -3,8 +3,11 @@
 #pragma once
 
 #include "Engine/DataAsset.h"
+#include "Engine/EngineTypes.h"
 
 #include "Type/LocomotionConfigTypes.h"
+#include "Type/LocomotionConfigTable.h"
+#include "Type/LocomotionLODTypes.h"
 
 #include "GameplayTagContainer.h"
 
@@ -12,19 +15,35 @@
 
 class ULocomotionComponent;
 class UCustomMovementProcess;
-enum EMovementMode : int;
 
 
 /**
  * Data asset of configuration and definition information about the character's Locomotion
  */
 UCLASS(Blueprintable, BlueprintType, Const)
-class GLEXT_API ULocomotionData : public UDataAsset
+class GLEXT_API ULocomotionData : public UPrimaryDataAsset
 {
 	GENERATED_BODY()
 public:
 	ULocomotionData(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
 
+	//
+	// Name of the asset bundle that contains CustomMovementProcess classes and their additional assets
+	//
+	static const FName NAME_LocomotionBundle;
+
+	virtual void PostInitProperties() override;
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+	virtual EDataValidationResult IsDataValid(FDataValidationContext& Context) const override;
+#endif
+
+#if WITH_EDITORONLY_DATA
+	virtual void UpdateAssetBundleData() override;
+#endif
+
 	//////////////////////////////////////////////////////////////////////////////////////////
 	// General
 public:
@@ -57,8 +76,9 @@ public:
 	// 
 	// Tips:
 	//	When initializing LocomotionComponent, it uses this data to create an instance of the custom movement process.
+	//	The classes are streamed asynchronously as the "Locomotion" asset bundle.
 	//
-	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "General", Meta = (ForceInlineRow))
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "General", Meta = (ForceInlineRow, AssetBundles = "Locomotion"))
 	TMap<uint8, TSoftClassPtr<UCustomMovementProcess>> CustomMovementProcesses;
 
 	//
@@ -103,6 +123,28 @@ public:
 	float MovingSpeedThreshold{ 50.0f };
 
 
+	//////////////////////////////////////////////////////////////////////////////////////////
+	// Config Resolution
+public:
+	//
+	// Amount of change in the input or view yaw angle at which the configs are resolved again
+	// 
+	// Tips:
+	//	Only used when a condition declares that it reads the yaw angle.
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Config Resolution", Meta = (ClampMin = 0, ForceUnits = "deg"))
+	float ConditionYawAngleThreshold{ 1.0f };
+
+	//
+	// Amount of change in the speed at which the configs are resolved again
+	// 
+	// Tips:
+	//	Only used when a condition declares that it reads the speed.
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Config Resolution", Meta = (ClampMin = 0, ForceUnits = "cm/s"))
+	float ConditionSpeedThreshold{ 1.0f };
+
+
 	//////////////////////////////////////////////////////////////////////////////////////////
 	// Rotation
 public:
@@ -119,6 +161,49 @@ public:
 	bool bRotateTowardsDesiredVelocityInVelocityDirectionRotationMode{ true };
 
 
+	//////////////////////////////////////////////////////////////////////////////////////////
+	// LOD
+public:
+	//
+	// Tiers of the locomotion update for simulated proxies and AI, from the highest fidelity to the lowest
+	// 
+	// Tips:
+	//	If empty, all characters are updated with full fidelity.
+	//	Locally controlled characters are always updated with full fidelity.
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "LOD")
+	TArray<FLocomotionLODTier> LODTiers;
+
+	//
+	// Significance of the character fed to the animation budget allocator
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "LOD")
+	FLocomotionAnimBudgetSettings AnimBudget;
+
+	//
+	// Whether to freeze the pose of the main mesh while the character is at rest
+	// 
+	// Tips:
+	//	The character is at rest when it is not moving, has no input, no LocomotionAction, no montage
+	//	and its rotation, view and states are unchanged.
+	//	While frozen, the last evaluated pose and curves are reused, so looping idle animations stop.
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "LOD")
+	bool bFreezeIdlePose{ false };
+
+	//
+	// Time the character must be at rest before the pose is frozen
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "LOD", Meta = (EditCondition = "bFreezeIdlePose", ClampMin = 0, ForceUnits = "s"))
+	float IdlePoseFreezeDelay{ 0.5f };
+
+	//
+	// Yaw speed of the view and the character below which the character can be at rest
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "LOD", Meta = (EditCondition = "bFreezeIdlePose", ClampMin = 0, ForceUnits = "deg/s"))
+	float IdlePoseFreezeYawSpeedThreshold{ 1.0f };
+
+
 	//////////////////////////////////////////////////////////////////////////////////////////
 	// Network
 public:
@@ -134,7 +219,120 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Netowork")
 	bool bEnableListenServerNetworkSmoothing{ true };
 
+	//
+	// Maximum number of view rotation uploads per second (0 for unlimited)
+	// 
+	// Tips:
+	//	Only used when the movement of the character is not replicated and the view rotation is sent by RPC.
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Netowork", Meta = (ClampMin = 0, ForceUnits = "Hz"))
+	float ViewRotationUploadMaxRate{ 20.0f };
+
+	//
+	// Change of the view rotation from the last upload below which it is not uploaded
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Netowork", Meta = (ClampMin = 0, ForceUnits = "deg"))
+	float ViewRotationUploadDeadBand{ 0.25f };
+
+	//
+	// Change of the view rotation from the last upload at which it is uploaded immediately regardless of the rate
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Netowork", Meta = (ClampMin = 0, ForceUnits = "deg"))
+	float ViewRotationUploadFlushAngle{ 15.0f };
+
+	//////////////////////////////////////////////////////////////////////////////////////////
+	// Config Table
+protected:
+	//
+	// Flattened table compiled from LocomotionModes
+	//
+	FLocomotionConfigTable ConfigTable;
+
+public:
+	/**
+	 * Compile LocomotionModes into ConfigTable
+	 * 
+	 * Tips:
+	 *	Problems found in the configs, such as cycles in SuggestStateTag, are logged and reported by data validation.
+	 */
+	void BuildConfigTable();
+
+	/**
+	 * Returns the table compiled from LocomotionModes
+	 */
+	const FLocomotionConfigTable& GetConfigTable() const { return ConfigTable; }
+
+public:
+	//////////////////////////////////////////////////////////////////////////////////////////
+	// Movement Mode Table
+protected:
+	//
+	// State id of LocomotionMode for each MovementMode and each CustomMovementMode (INDEX_NONE if not mapped)
+	//
+	int32 MovementModeStateIds[MOVE_MAX];
+	int32 CustomMovementModeStateIds[256];
+
+	//
+	// MovementMode and CustomMovementMode for each state id of LocomotionMode
+	//
+	TArray<TPair<TEnumAsByte<EMovementMode>, uint8>> LocomotionModeMovementModes;
+
+	//
+	// Slot index in GetCustomMovementProcessModes() for each CustomMovementMode (INDEX_NONE if no process is defined)
+	//
+	int16 CustomMovementProcessSlots[256];
+
+	//
+	// CustomMovementMode of each slot of CustomMovementProcess
+	//
+	TArray<uint8> CustomMovementProcessModes;
+
+protected:
+	/**
+	 * Build the directly indexed tables from the mappings of MovementMode, LocomotionMode and CustomMovementProcess
+	 */
+	void BuildMovementModeTables();
+
+public:
+	/**
+	 * Returns the state id of LocomotionMode mapped to the MovementMode
+	 */
+	int32 GetLocomotionModeStateId(EMovementMode MovementMode, uint8 CustomMovementMode) const
+	{
+		return (MovementMode == MOVE_Custom) ? CustomMovementModeStateIds[CustomMovementMode] : MovementModeStateIds[MovementMode];
+	}
+
+	/**
+	 * Returns the slot of CustomMovementProcess for the CustomMovementMode
+	 */
+	int32 GetCustomMovementProcessSlot(uint8 CustomMovementMode) const { return CustomMovementProcessSlots[CustomMovementMode]; }
+
+	/**
+	 * Returns the CustomMovementMode of each slot of CustomMovementProcess
+	 */
+	const TArray<uint8>& GetCustomMovementProcessModes() const { return CustomMovementProcessModes; }
+
+	//////////////////////////////////////////////////////////////////////////////////////////
+	// Shared Process
+protected:
+	//
+	// Instances of stateless CustomMovementProcess shared by all components using this data
+	//
+	UPROPERTY(Transient)
+	TMap<uint8, TObjectPtr<UCustomMovementProcess>> SharedCustomMovementProcesses;
+
+public:
+	/**
+	 * Returns the shared instance of the stateless CustomMovementProcess for the custom movement mode
+	 */
+	UCustomMovementProcess* GetSharedCustomMovementProcess(uint8 CustomMovementMode, const UClass* ProcessClass) const;
+
 public:
+	/**
+	 * Collect the paths of CustomMovementProcess classes that are not loaded yet
+	 */
+	void GetUnloadedCustomMovementProcessPaths(TArray<FSoftObjectPath>& OutPaths) const;
+
 	/**
 	 * Find LocomotionModeConfigs from DesiredLocomotionMode
 	 */
@@ -145,6 +343,11 @@ public:
 	 */
 	FGameplayTag Convert_MovementModeToLocomotionMode(const EMovementMode& MovementMode, const uint8& CustomMovementMode) const;
 
+	/**
+	 * Convert state id of LocomotionMode to MovementMode type
+	 */
+	void Convert_LocomotionModeStateIdToMovementMode(int32 StateId, EMovementMode& MovementMode, uint8& CustomMovementMode) const;
+
 	/**
 	 * Convert LocomotionMode tag to MovementMode type
 	 * 
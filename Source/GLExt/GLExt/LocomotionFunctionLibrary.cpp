@@ -2,6 +2,10 @@
 
 #include "LocomotionFunctionLibrary.h"
 
+#include "Math/VectorRegister.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionFunctionLibrary)
 
 
@@ -173,3 +177,380 @@ FVector ULocomotionFunctionLibrary::SlerpSkipNormalization(const FVector& From,
 
 	return From * Cos + FromPerpendicular * Sin;
 }
+
+
+#pragma region Batched Math
+
+namespace LocomotionBatchedMath
+{
+	static const VectorRegister4Float FullTurn{ VectorSetFloat1(360.0f) };
+	static const VectorRegister4Float HalfTurn{ VectorSetFloat1(180.0f) };
+	static const VectorRegister4Float InvFullTurn{ VectorSetFloat1(1.0f / 360.0f) };
+	static const VectorRegister4Float CounterClockwiseThreshold{ VectorSetFloat1(180.0f - ULocomotionFunctionLibrary::CounterClockwiseRotationAngleThreshold) };
+
+	/**
+	 * Vector version of FRotator3f::NormalizeAxis()
+	 */
+	FORCEINLINE VectorRegister4Float NormalizeAxis(const VectorRegister4Float& Angle)
+	{
+		// [0, 360)
+
+		const auto Wrapped{ VectorSubtract(Angle, VectorMultiply(VectorFloor(VectorMultiply(Angle, InvFullTurn)), FullTurn)) };
+
+		// (-180, 180]
+
+		return VectorSelect(VectorCompareGT(Wrapped, HalfTurn), VectorSubtract(Wrapped, FullTurn), Wrapped);
+	}
+
+	/**
+	 * Vector version of the delta calculation of LerpAngle()
+	 */
+	FORCEINLINE VectorRegister4Float DeltaAngle(const VectorRegister4Float& From, const VectorRegister4Float& To)
+	{
+		const auto Delta{ NormalizeAxis(VectorSubtract(To, From)) };
+
+		return VectorSelect(VectorCompareGT(Delta, CounterClockwiseThreshold), VectorSubtract(Delta, FullTurn), Delta);
+	}
+
+	/**
+	 * Approximation of atan for values in [-1, 1] in radians
+	 */
+	FORCEINLINE float AtanUnit(float Z)
+	{
+		const auto Z2{ Z * Z };
+
+		return Z * (0.99997726f + Z2 * (-0.33262347f + Z2 * (0.19354346f + Z2 * (-0.11643287f + Z2 * (0.05265332f + Z2 * -0.01172120f)))));
+	}
+
+	FORCEINLINE VectorRegister4Float AtanUnit(const VectorRegister4Float& Z)
+	{
+		const auto Z2{ VectorMultiply(Z, Z) };
+
+		auto Result{ VectorMultiplyAdd(Z2, VectorSetFloat1(-0.01172120f), VectorSetFloat1(0.05265332f)) };
+		Result = VectorMultiplyAdd(Z2, Result, VectorSetFloat1(-0.11643287f));
+		Result = VectorMultiplyAdd(Z2, Result, VectorSetFloat1(0.19354346f));
+		Result = VectorMultiplyAdd(Z2, Result, VectorSetFloat1(-0.33262347f));
+		Result = VectorMultiplyAdd(Z2, Result, VectorSetFloat1(0.99997726f));
+
+		return VectorMultiply(Z, Result);
+	}
+
+	/**
+	 * Vector version of FastAtan2Degrees()
+	 */
+	FORCEINLINE VectorRegister4Float FastAtan2Degrees(const VectorRegister4Float& Y, const VectorRegister4Float& X)
+	{
+		const auto Zero{ VectorZeroFloat() };
+		const auto AbsX{ VectorAbs(X) };
+		const auto AbsY{ VectorAbs(Y) };
+
+		// Reduce to [-1, 1] and use atan(x) = pi/2 - atan(1/x) for the rest
+
+		const auto bSwap{ VectorCompareGT(AbsY, AbsX) };
+		const auto Numerator{ VectorSelect(bSwap, X, Y) };
+		const auto Denominator{ VectorSelect(bSwap, Y, X) };
+		const auto bZero{ VectorCompareEQ(Denominator, Zero) };
+		const auto Z{ VectorSelect(bZero, Zero, VectorDivide(Numerator, VectorSelect(bZero, VectorOneFloat(), Denominator))) };
+
+		auto Angle{ AtanUnit(Z) };
+
+		const auto HalfPi{ VectorSetFloat1(UE_HALF_PI) };
+		const auto Pi{ VectorSetFloat1(UE_PI) };
+
+		const auto bUpper{ VectorCompareGE(Y, Zero) };
+
+		// When |y| > |x|: sign(y) * pi/2 - atan(x/y)
+		// Otherwise move to the left half plane when x < 0
+
+		const auto SwappedAngle{ VectorSubtract(VectorSelect(bUpper, HalfPi, VectorNegate(HalfPi)), Angle) };
+		const auto LeftOffset{ VectorSelect(VectorCompareLT(X, Zero), VectorSelect(bUpper, Pi, VectorNegate(Pi)), Zero) };
+
+		Angle = VectorSelect(bSwap, SwappedAngle, VectorAdd(Angle, LeftOffset));
+
+		return VectorMultiply(Angle, VectorSetFloat1(180.0f / UE_PI));
+	}
+}
+
+float ULocomotionFunctionLibrary::FastAtan2Degrees(float Y, float X)
+{
+	const auto AbsX{ FMath::Abs(X) };
+	const auto AbsY{ FMath::Abs(Y) };
+
+	if (AbsX == 0.0f && AbsY == 0.0f)
+	{
+		return 0.0f;
+	}
+
+	float Angle;
+
+	if (AbsY > AbsX)
+	{
+		Angle = ((Y >= 0.0f) ? UE_HALF_PI : -UE_HALF_PI) - LocomotionBatchedMath::AtanUnit(X / Y);
+	}
+	else
+	{
+		Angle = LocomotionBatchedMath::AtanUnit(Y / X);
+
+		if (X < 0.0f)
+		{
+			Angle += (Y >= 0.0f) ? UE_PI : -UE_PI;
+		}
+	}
+
+	return Angle * (180.0f / UE_PI);
+}
+
+void ULocomotionFunctionLibrary::NormalizeAngles(TArrayView<float> Angles)
+{
+	const auto Num{ Angles.Num() };
+	auto* Data{ Angles.GetData() };
+
+	auto Index{ 0 };
+
+	for (; Index + 4 <= Num; Index += 4)
+	{
+		VectorStore(LocomotionBatchedMath::NormalizeAxis(VectorLoad(Data + Index)), Data + Index);
+	}
+
+	for (; Index < Num; ++Index)
+	{
+		Data[Index] = FRotator3f::NormalizeAxis(Data[Index]);
+	}
+}
+
+void ULocomotionFunctionLibrary::LerpAngles(TArrayView<float> From, TConstArrayView<float> To, float Alpha)
+{
+	check(From.Num() == To.Num());
+
+	const auto Num{ From.Num() };
+	auto* FromData{ From.GetData() };
+	const auto* ToData{ To.GetData() };
+	const auto AlphaVector{ VectorSetFloat1(Alpha) };
+
+	auto Index{ 0 };
+
+	for (; Index + 4 <= Num; Index += 4)
+	{
+		const auto Current{ VectorLoad(FromData + Index) };
+		const auto Delta{ LocomotionBatchedMath::DeltaAngle(Current, VectorLoad(ToData + Index)) };
+
+		VectorStore(LocomotionBatchedMath::NormalizeAxis(VectorMultiplyAdd(Delta, AlphaVector, Current)), FromData + Index);
+	}
+
+	for (; Index < Num; ++Index)
+	{
+		FromData[Index] = LerpAngle(FromData[Index], ToData[Index], Alpha);
+	}
+}
+
+void ULocomotionFunctionLibrary::LerpRotators(TArrayView<FRotator> From, TConstArrayView<FRotator> To, float Alpha)
+{
+	check(From.Num() == To.Num());
+
+	const auto Num{ From.Num() };
+	auto* FromData{ From.GetData() };
+	const auto* ToData{ To.GetData() };
+	const auto AlphaVector{ VectorSetFloat1(Alpha) };
+
+	for (auto Index{ 0 }; Index < Num; ++Index)
+	{
+		auto& Current{ FromData[Index] };
+		const auto& Target{ ToData[Index] };
+
+		const auto CurrentVector{ MakeVectorRegisterFloat(UE_REAL_TO_FLOAT(Current.Pitch), UE_REAL_TO_FLOAT(Current.Yaw), UE_REAL_TO_FLOAT(Current.Roll), 0.0f) };
+		const auto TargetVector{ MakeVectorRegisterFloat(UE_REAL_TO_FLOAT(Target.Pitch), UE_REAL_TO_FLOAT(Target.Yaw), UE_REAL_TO_FLOAT(Target.Roll), 0.0f) };
+		const auto Delta{ LocomotionBatchedMath::DeltaAngle(CurrentVector, TargetVector) };
+
+		alignas(16) float Result[4];
+		VectorStoreAligned(LocomotionBatchedMath::NormalizeAxis(VectorMultiplyAdd(Delta, AlphaVector, CurrentVector)), Result);
+
+		Current = FRotator(Result[0], Result[1], Result[2]);
+	}
+}
+
+void ULocomotionFunctionLibrary::ExponentialDecayAngles(TArrayView<float> Current, TConstArrayView<float> Target, float DeltaTime, float Lambda)
+{
+	check(Current.Num() == Target.Num());
+
+	if (Lambda <= 0.0f)
+	{
+		FMemory::Memcpy(Current.GetData(), Target.GetData(), Current.Num() * sizeof(float));
+		return;
+	}
+
+	// The interpolation amount is the same for all the elements
+
+	LerpAngles(Current, Target, ExponentialDecay(DeltaTime, Lambda));
+}
+
+void ULocomotionFunctionLibrary::InterpolateAnglesConstant(TArrayView<float> Current, TConstArrayView<float> Target, float DeltaTime, float InterpolationSpeed)
+{
+	check(Current.Num() == Target.Num());
+
+	const auto Num{ Current.Num() };
+	auto* CurrentData{ Current.GetData() };
+	const auto* TargetData{ Target.GetData() };
+
+	if (InterpolationSpeed <= 0.0f)
+	{
+		FMemory::Memcpy(CurrentData, TargetData, Num * sizeof(float));
+		return;
+	}
+
+	const auto Alpha{ InterpolationSpeed * DeltaTime };
+	const auto MaxStep{ VectorSetFloat1(Alpha) };
+	const auto MinStep{ VectorSetFloat1(-Alpha) };
+
+	auto Index{ 0 };
+
+	for (; Index + 4 <= Num; Index += 4)
+	{
+		const auto From{ VectorLoad(CurrentData + Index) };
+		const auto To{ VectorLoad(TargetData + Index) };
+		const auto Delta{ LocomotionBatchedMath::DeltaAngle(From, To) };
+		const auto Result{ LocomotionBatchedMath::NormalizeAxis(VectorAdd(From, VectorMin(VectorMax(Delta, MinStep), MaxStep))) };
+
+		// Angles that already match the target are set to the target as is
+
+		VectorStore(VectorSelect(VectorCompareEQ(From, To), To, Result), CurrentData + Index);
+	}
+
+	for (; Index < Num; ++Index)
+	{
+		CurrentData[Index] = InterpolateAngleConstant(CurrentData[Index], TargetData[Index], DeltaTime, InterpolationSpeed);
+	}
+}
+
+void ULocomotionFunctionLibrary::DirectionsToAnglesXY(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutAngles, bool bFast)
+{
+	check((X.Num() == Y.Num()) && (X.Num() == OutAngles.Num()));
+
+	const auto Num{ OutAngles.Num() };
+	const auto* XData{ X.GetData() };
+	const auto* YData{ Y.GetData() };
+	auto* OutData{ OutAngles.GetData() };
+
+	if (!bFast)
+	{
+		for (auto Index{ 0 }; Index < Num; ++Index)
+		{
+			OutData[Index] = FMath::RadiansToDegrees(FMath::Atan2(YData[Index], XData[Index]));
+		}
+
+		return;
+	}
+
+	auto Index{ 0 };
+
+	for (; Index + 4 <= Num; Index += 4)
+	{
+		VectorStore(LocomotionBatchedMath::FastAtan2Degrees(VectorLoad(YData + Index), VectorLoad(XData + Index)), OutData + Index);
+	}
+
+	for (; Index < Num; ++Index)
+	{
+		OutData[Index] = FastAtan2Degrees(YData[Index], XData[Index]);
+	}
+}
+
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLocomotionBatchedMathTest, "GLExt.Math.BatchedAngles", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLocomotionBatchedMathTest::RunTest(const FString& Parameters)
+{
+	// Odd number so that the scalar remainder of the vector loops is covered too
+
+	static constexpr auto Num{ 4099 };
+
+	// Differences of single precision from the scalar versions (the scalar versions normalize with fmod and DirectionToAngleXY() is double precision)
+
+	static constexpr auto Tolerance{ 0.001f };
+
+	FRandomStream Random(Num);
+
+	TArray<float> From, To, X, Y, Batched;
+	From.SetNumUninitialized(Num);
+	To.SetNumUninitialized(Num);
+	X.SetNumUninitialized(Num);
+	Y.SetNumUninitialized(Num);
+
+	TArray<FRotator> FromRotators, ToRotators;
+	FromRotators.SetNumUninitialized(Num);
+	ToRotators.SetNumUninitialized(Num);
+
+	for (auto Index{ 0 }; Index < Num; ++Index)
+	{
+		From[Index] = Random.FRandRange(-720.0f, 720.0f);
+		To[Index] = Random.FRandRange(-720.0f, 720.0f);
+		X[Index] = Random.FRandRange(-1000.0f, 1000.0f);
+		Y[Index] = Random.FRandRange(-1000.0f, 1000.0f);
+
+		FromRotators[Index] = FRotator(Random.FRandRange(-180.0f, 180.0f), Random.FRandRange(-180.0f, 180.0f), Random.FRandRange(-180.0f, 180.0f));
+		ToRotators[Index] = FRotator(Random.FRandRange(-180.0f, 180.0f), Random.FRandRange(-180.0f, 180.0f), Random.FRandRange(-180.0f, 180.0f));
+	}
+
+	// Angles are compared as the shortest difference so that 180 and -180 are the same
+
+	const auto MaxAngleError{ [&](TFunctionRef<float(int32)> Scalar)
+	{
+		auto MaxError{ 0.0f };
+
+		for (auto Index{ 0 }; Index < Num; ++Index)
+		{
+			MaxError = FMath::Max(MaxError, FMath::Abs(FRotator3f::NormalizeAxis(Batched[Index] - Scalar(Index))));
+		}
+
+		return MaxError;
+	} };
+
+	Batched = From;
+	ULocomotionFunctionLibrary::NormalizeAngles(Batched);
+	TestTrue(TEXT("NormalizeAngles matches FRotator3f::NormalizeAxis()"), MaxAngleError([&](int32 i) { return FRotator3f::NormalizeAxis(From[i]); }) <= Tolerance);
+
+	Batched = From;
+	ULocomotionFunctionLibrary::LerpAngles(Batched, To, 0.3f);
+	TestTrue(TEXT("LerpAngles matches LerpAngle()"), MaxAngleError([&](int32 i) { return ULocomotionFunctionLibrary::LerpAngle(From[i], To[i], 0.3f); }) <= Tolerance);
+
+	Batched = From;
+	ULocomotionFunctionLibrary::ExponentialDecayAngles(Batched, To, 1.0f / 60.0f, 10.0f);
+	TestTrue(TEXT("ExponentialDecayAngles matches ExponentialDecayAngle()"), MaxAngleError([&](int32 i) { return ULocomotionFunctionLibrary::ExponentialDecayAngle(From[i], To[i], 1.0f / 60.0f, 10.0f); }) <= Tolerance);
+
+	Batched = From;
+	ULocomotionFunctionLibrary::InterpolateAnglesConstant(Batched, To, 1.0f / 60.0f, 600.0f);
+	TestTrue(TEXT("InterpolateAnglesConstant matches InterpolateAngleConstant()"), MaxAngleError([&](int32 i) { return ULocomotionFunctionLibrary::InterpolateAngleConstant(From[i], To[i], 1.0f / 60.0f, 600.0f); }) <= Tolerance);
+
+	Batched.SetNumUninitialized(Num);
+	ULocomotionFunctionLibrary::DirectionsToAnglesXY(X, Y, Batched, false);
+	TestTrue(TEXT("DirectionsToAnglesXY matches DirectionToAngleXY()"), MaxAngleError([&](int32 i) { return UE_REAL_TO_FLOAT(ULocomotionFunctionLibrary::DirectionToAngleXY(FVector(X[i], Y[i], 0.0f))); }) <= Tolerance);
+
+	ULocomotionFunctionLibrary::DirectionsToAnglesXY(X, Y, Batched, true);
+	TestTrue(TEXT("DirectionsToAnglesXY (Fast) is within FastAtan2MaxErrorDegrees"), MaxAngleError([&](int32 i) { return UE_REAL_TO_FLOAT(ULocomotionFunctionLibrary::DirectionToAngleXY(FVector(X[i], Y[i], 0.0f))); }) <= ULocomotionFunctionLibrary::FastAtan2MaxErrorDegrees);
+
+	TestEqual(TEXT("FastAtan2Degrees of the zero vector"), ULocomotionFunctionLibrary::FastAtan2Degrees(0.0f, 0.0f), 0.0f);
+
+	auto BatchedRotators{ FromRotators };
+	ULocomotionFunctionLibrary::LerpRotators(BatchedRotators, ToRotators, 0.3f);
+
+	auto MaxRotatorError{ 0.0f };
+
+	for (auto Index{ 0 }; Index < Num; ++Index)
+	{
+		const auto Scalar{ ULocomotionFunctionLibrary::LerpRotator(FromRotators[Index], ToRotators[Index], 0.3f) };
+
+		MaxRotatorError = FMath::Max3(MaxRotatorError,
+			FMath::Abs(FRotator3f::NormalizeAxis(UE_REAL_TO_FLOAT(BatchedRotators[Index].Pitch - Scalar.Pitch))),
+			FMath::Max(
+				FMath::Abs(FRotator3f::NormalizeAxis(UE_REAL_TO_FLOAT(BatchedRotators[Index].Yaw - Scalar.Yaw))),
+				FMath::Abs(FRotator3f::NormalizeAxis(UE_REAL_TO_FLOAT(BatchedRotators[Index].Roll - Scalar.Roll)))));
+	}
+
+	TestTrue(TEXT("LerpRotators matches LerpRotator()"), MaxRotatorError <= Tolerance);
+
+	return true;
+}
+
+#endif
+
+#pragma endregion
@@ -74,4 +74,64 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Movement|Vector", DisplayName = "Slerp (Skip Normalization)", Meta = (AutoCreateRefTerm = "From, To", ReturnDisplayName = "Direction"))
 	static FVector SlerpSkipNormalization(const FVector& From, const FVector& To, float Alpha);
 
+
+	////////////////////////////////////////////////
+	// Batched Math
+	//
+	// Tips:
+	//	Array versions of the functions above that process the values of many characters at once.
+	//	The values are processed four at a time with vector registers and the remainder with the scalar functions.
+	//	All arrays must have the same number of elements.
+	//
+public:
+	//
+	// Maximum error of FastAtan2Degrees() in degrees
+	//
+	static constexpr float FastAtan2MaxErrorDegrees{ 0.001f };
+
+	/**
+	 * Approximation of the angle of the direction (Y, X) in degrees
+	 * 
+	 * Tips:
+	 *	Uses a polynomial approximation of atan whose error is less than FastAtan2MaxErrorDegrees.
+	 *	Returns 0 for the zero vector.
+	 */
+	static float FastAtan2Degrees(float Y, float X);
+
+	/**
+	 * Normalize the angles to (-180, 180]
+	 */
+	static void NormalizeAngles(TArrayView<float> Angles);
+
+	/**
+	 * Array version of LerpAngle() that writes the results to From
+	 */
+	static void LerpAngles(TArrayView<float> From, TConstArrayView<float> To, float Alpha);
+
+	/**
+	 * Array version of LerpRotator() that writes the results to From
+	 * 
+	 * Tips:
+	 *	Pitch, yaw and roll of each rotator are processed together in the lanes of one vector register in single precision.
+	 */
+	static void LerpRotators(TArrayView<FRotator> From, TConstArrayView<FRotator> To, float Alpha);
+
+	/**
+	 * Array version of ExponentialDecayAngle() that writes the results to Current
+	 */
+	static void ExponentialDecayAngles(TArrayView<float> Current, TConstArrayView<float> Target, float DeltaTime, float Lambda);
+
+	/**
+	 * Array version of InterpolateAngleConstant() that writes the results to Current
+	 */
+	static void InterpolateAnglesConstant(TArrayView<float> Current, TConstArrayView<float> Target, float DeltaTime, float InterpolationSpeed);
+
+	/**
+	 * Array version of DirectionToAngleXY() for the directions given as X and Y components
+	 * 
+	 * Tips:
+	 *	If bFast is true, FastAtan2Degrees() is used instead of FMath::Atan2().
+	 */
+	static void DirectionsToAnglesXY(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutAngles, bool bFast = false);
+
 };
@@ -0,0 +1,407 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionNetBenchmarkSubsystem.h"
+
+#include "LocomotionComponent.h"
+#include "LocomotionCharacter.h"
+#include "GameplayTag/GLETags_Status.h"
+#include "GLExtLogs.h"
+
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/CoreNet.h"
+#include "UObject/UObjectIterator.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionNetBenchmarkSubsystem)
+
+
+namespace LocomotionNetBenchmark
+{
+	/**
+	 * Returns the number of bits written by the net serializer of the value
+	 */
+	template<typename T>
+	int64 GetNetSerializedBits(const T& Value)
+	{
+		auto Copy{ Value };
+		auto bSuccess{ true };
+		FNetBitWriter Writer{ nullptr, 256 };
+
+		Copy.NetSerialize(Writer, nullptr, bSuccess);
+
+		return Writer.GetNumBits();
+	}
+}
+
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs CmdLocomotionNetBenchmarkStart(
+	TEXT("glext.Net.Benchmark.Start"),
+	TEXT("Record the replication cost of every LocomotionComponent on the server and write it to a CSV file. Usage: glext.Net.Benchmark.Start [Seconds] [SpawnCount] [CharacterClassPath] [OutputPath]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		auto* Subsystem{ World ? World->GetSubsystem<ULocomotionNetBenchmarkSubsystem>() : nullptr };
+
+		if (!Subsystem || World->IsNetMode(NM_Client))
+		{
+			UE_LOG(LogGLE, Warning, TEXT("glext.Net.Benchmark.Start must be run on the server."));
+			return;
+		}
+
+		const auto Seconds{ Args.IsValidIndex(0) ? FCString::Atof(*Args[0]) : 30.0f };
+		const auto SpawnCount{ Args.IsValidIndex(1) ? FMath::Max(FCString::Atoi(*Args[1]), 0) : 0 };
+
+		TSubclassOf<ACharacter> CharacterClass{ ALocomotionCharacter::StaticClass() };
+
+		if (Args.IsValidIndex(2) && !Args[2].IsEmpty())
+		{
+			CharacterClass = LoadClass<ACharacter>(nullptr, *Args[2]);
+
+			if (!CharacterClass)
+			{
+				UE_LOG(LogGLE, Warning, TEXT("glext.Net.Benchmark.Start: Character class (%s) could not be loaded."), *Args[2]);
+				return;
+			}
+		}
+
+		Subsystem->StartBenchmark(Seconds, SpawnCount, CharacterClass, Args.IsValidIndex(3) ? Args[3] : FString());
+	}),
+	ECVF_Cheat);
+
+static FAutoConsoleCommandWithWorld CmdLocomotionNetBenchmarkStop(
+	TEXT("glext.Net.Benchmark.Stop"),
+	TEXT("Stop recording the replication cost of LocomotionComponents and write the CSV file."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (auto* Subsystem{ World ? World->GetSubsystem<ULocomotionNetBenchmarkSubsystem>() : nullptr })
+		{
+			Subsystem->StopBenchmark();
+		}
+	}),
+	ECVF_Cheat);
+#endif
+
+
+bool ULocomotionNetBenchmarkSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if UE_BUILD_SHIPPING
+	return false;
+#else
+	return Super::ShouldCreateSubsystem(Outer);
+#endif
+}
+
+bool ULocomotionNetBenchmarkSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return (WorldType == EWorldType::Game) || (WorldType == EWorldType::PIE);
+}
+
+void ULocomotionNetBenchmarkSubsystem::Deinitialize()
+{
+	StopBenchmark();
+
+	Super::Deinitialize();
+}
+
+
+void ULocomotionNetBenchmarkSubsystem::StartBenchmark(float Seconds, int32 SpawnCount, TSubclassOf<ACharacter> CharacterClass, const FString& InOutputPath)
+{
+	StopBenchmark();
+
+	auto* World{ GetWorld() };
+
+	Records.Reset();
+
+	SpawnCharacters(SpawnCount, CharacterClass);
+
+	for (TObjectIterator<ULocomotionComponent> It; It; ++It)
+	{
+		auto* LC{ *It };
+
+		if (!LC || (LC->GetWorld() != World) || LC->IsTemplate())
+		{
+			continue;
+		}
+
+		auto& Record{ Records.AddDefaulted_GetRef() };
+		Record.Component = LC;
+		Record.Name = GetNameSafe(LC->GetOwner());
+		Record.LastIntent = LC->GetReplicatedIntent();
+		Record.LastDesiredRotationMode = LC->GetDesiredRotationMode();
+		Record.LastDesiredStance = LC->GetDesiredStance();
+		Record.LastDesiredGait = LC->GetDesiredGait();
+		Record.StartMovesReceived = LC->NumMovesReceived;
+		Record.StartViewRotationRPCsReceived = LC->NumViewRotationRPCsReceived;
+		Record.StartDesiredStateRPCsReceived = LC->NumDesiredStateRPCsReceived;
+		Record.LastViewRotationRPCsReceived = LC->NumViewRotationRPCsReceived;
+		Record.bSpawned = SpawnedCharacters.Contains(Cast<ACharacter>(LC->GetOwner()));
+		Record.bRemoteControlled = (LC->GetOwner() && LC->GetOwner()->GetNetConnection());
+	}
+
+	Duration = Seconds;
+	ElapsedTime = 0.0;
+	ActorTickSeconds = 0.0;
+	MaxActorTickSeconds = 0.0;
+	NumFrames = 0;
+
+	GetNetDriverTotals(StartOutBytes, StartInBytes);
+
+	OutputPath = !InOutputPath.IsEmpty() ? InOutputPath :
+		FPaths::Combine(FPaths::ProfilingDir(), TEXT("GLExt"), FString::Printf(TEXT("LocomotionNetBenchmark-%s.csv"), *FDateTime::Now().ToString()));
+
+	PreActorTickHandle = FWorldDelegates::OnWorldPreActorTick.AddUObject(this, &ThisClass::HandleWorldPreActorTick);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &ThisClass::HandleWorldPostActorTick);
+
+	bRecording = true;
+
+	UE_LOG(LogGLE, Display, TEXT("Locomotion net benchmark started: %d characters (%d spawned), %.1f s"), Records.Num(), SpawnedCharacters.Num(), Seconds);
+}
+
+void ULocomotionNetBenchmarkSubsystem::StopBenchmark()
+{
+	if (!bRecording)
+	{
+		return;
+	}
+
+	bRecording = false;
+
+	FWorldDelegates::OnWorldPreActorTick.Remove(PreActorTickHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	WriteResults();
+
+	for (auto& Character : SpawnedCharacters)
+	{
+		if (IsValid(Character))
+		{
+			if (auto* Controller{ Character->GetController() })
+			{
+				Controller->Destroy();
+			}
+
+			Character->Destroy();
+		}
+	}
+
+	SpawnedCharacters.Reset();
+	Records.Reset();
+}
+
+
+void ULocomotionNetBenchmarkSubsystem::HandleWorldPreActorTick(UWorld* InWorld, ELevelTick InTickType, float InDeltaSeconds)
+{
+	if (InWorld != GetWorld())
+	{
+		return;
+	}
+
+	ActorTickStartTime = FPlatformTime::Seconds();
+
+	DriveSpawnedCharacters();
+}
+
+void ULocomotionNetBenchmarkSubsystem::HandleWorldPostActorTick(UWorld* InWorld, ELevelTick InTickType, float InDeltaSeconds)
+{
+	if (InWorld != GetWorld())
+	{
+		return;
+	}
+
+	const auto FrameActorTickSeconds{ FPlatformTime::Seconds() - ActorTickStartTime };
+
+	ActorTickSeconds += FrameActorTickSeconds;
+	MaxActorTickSeconds = FMath::Max(MaxActorTickSeconds, FrameActorTickSeconds);
+	ElapsedTime += InDeltaSeconds;
+	++NumFrames;
+
+	SampleRecords();
+
+	if ((Duration > 0.0) && (ElapsedTime >= Duration))
+	{
+		StopBenchmark();
+	}
+}
+
+
+void ULocomotionNetBenchmarkSubsystem::SpawnCharacters(int32 SpawnCount, TSubclassOf<ACharacter> CharacterClass)
+{
+	auto* World{ GetWorld() };
+
+	if ((SpawnCount <= 0) || !CharacterClass || !World)
+	{
+		return;
+	}
+
+	// Spawn the characters in a grid so that they do not collide with each other
+
+	const auto GridSize{ FMath::CeilToInt(FMath::Sqrt(static_cast<float>(SpawnCount))) };
+	const auto Spacing{ 300.0 };
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	for (auto Index{ 0 }; Index < SpawnCount; ++Index)
+	{
+		const FVector Location{ (Index % GridSize) * Spacing, (Index / GridSize) * Spacing, 200.0 };
+
+		if (auto* Character{ World->SpawnActor<ACharacter>(CharacterClass, Location, FRotator::ZeroRotator, SpawnParameters) })
+		{
+			if (!Character->GetController())
+			{
+				Character->SpawnDefaultController();
+			}
+
+			SpawnedCharacters.Add(Character);
+		}
+	}
+}
+
+void ULocomotionNetBenchmarkSubsystem::DriveSpawnedCharacters()
+{
+	static const FGameplayTag Gaits[]{ TAG_Status_Gait_Walking, TAG_Status_Gait_Running, TAG_Status_Gait_Sprinting };
+
+	// Each character walks in a circle with a different phase, and changes its gait and stance periodically
+
+	for (auto Index{ 0 }; Index < SpawnedCharacters.Num(); ++Index)
+	{
+		auto* Character{ SpawnedCharacters[Index].Get() };
+		auto* LC{ IsValid(Character) ? Cast<ULocomotionComponent>(Character->GetCharacterMovement()) : nullptr };
+
+		if (!LC)
+		{
+			continue;
+		}
+
+		const auto Time{ ElapsedTime + Index * 0.37 };
+		const auto YawAngle{ FRotator::NormalizeAxis(Time * 45.0) };
+
+		Character->AddMovementInput(FRotator(0.0, YawAngle, 0.0).Vector());
+
+		if (auto* Controller{ Character->GetController() })
+		{
+			Controller->SetControlRotation(FRotator(FMath::Sin(Time) * 30.0, YawAngle, 0.0));
+		}
+
+		LC->SetDesiredGait(Gaits[static_cast<int32>(Time / 2.0) % UE_ARRAY_COUNT(Gaits)]);
+		LC->SetDesiredStance((static_cast<int32>(Time / 5.0) % 2 == 0) ? TAG_Status_Stance_Standing : TAG_Status_Stance_Crouching);
+	}
+}
+
+void ULocomotionNetBenchmarkSubsystem::SampleRecords()
+{
+	using namespace LocomotionNetBenchmark;
+
+	for (auto& Record : Records)
+	{
+		const auto* LC{ Record.Component.Get() };
+
+		if (!LC)
+		{
+			continue;
+		}
+
+		// Estimate the payload of each changed property once per change
+
+		const auto& Intent{ LC->GetReplicatedIntent() };
+
+		if (Intent != Record.LastIntent)
+		{
+			auto Copy{ Intent };
+			FNetBitWriter Writer{ nullptr, 256 };
+
+			Copy.SerializeChangedFields(Writer, Record.LastIntent.Quantize());
+
+			Record.LastIntent = Intent;
+			++Record.IntentChanges;
+			Record.IntentBits += Writer.GetNumBits();
+		}
+
+		const auto CountDesiredState
+		{
+			[&Record](const FGameplayTag& DesiredState, FGameplayTag& LastDesiredState)
+			{
+				if (DesiredState != LastDesiredState)
+				{
+					LastDesiredState = DesiredState;
+					++Record.DesiredStateChanges;
+					Record.DesiredStateBits += GetNetSerializedBits(DesiredState);
+				}
+			}
+		};
+
+		CountDesiredState(LC->GetDesiredRotationMode(), Record.LastDesiredRotationMode);
+		CountDesiredState(LC->GetDesiredStance(), Record.LastDesiredStance);
+		CountDesiredState(LC->GetDesiredGait(), Record.LastDesiredGait);
+
+		// Estimate the payload of the view rotation RPCs received since the last sample
+
+		const auto NumViewRotationRPCs{ LC->NumViewRotationRPCsReceived - Record.LastViewRotationRPCsReceived };
+
+		if (NumViewRotationRPCs > 0)
+		{
+			Record.LastViewRotationRPCsReceived = LC->NumViewRotationRPCsReceived;
+			Record.ViewRotationRPCBits += NumViewRotationRPCs * GetNetSerializedBits(Intent.ViewRotation);
+		}
+	}
+}
+
+void ULocomotionNetBenchmarkSubsystem::GetNetDriverTotals(int64& OutBytes, int64& InBytes) const
+{
+	const auto* NetDriver{ GetWorld() ? GetWorld()->GetNetDriver() : nullptr };
+
+	OutBytes = NetDriver ? static_cast<int64>(NetDriver->OutTotalBytes) : 0;
+	InBytes = NetDriver ? static_cast<int64>(NetDriver->InTotalBytes) : 0;
+}
+
+void ULocomotionNetBenchmarkSubsystem::WriteResults() const
+{
+	const auto Seconds{ FMath::Max(ElapsedTime, UE_KINDA_SMALL_NUMBER) };
+
+	int64 OutBytes{ 0 };
+	int64 InBytes{ 0 };
+	GetNetDriverTotals(OutBytes, InBytes);
+
+	const auto* NetDriver{ GetWorld() ? GetWorld()->GetNetDriver() : nullptr };
+	const auto NumConnections{ NetDriver ? NetDriver->ClientConnections.Num() : 0 };
+
+	// One row per character, followed by a row of the totals of the server
+
+	FString Csv{ TEXT("Name,Spawned,RemoteControlled,Seconds,Frames,Connections,AvgActorTickMs,MaxActorTickMs,NetOutBytesPerSec,NetInBytesPerSec,")
+		TEXT("MovesPerSec,ViewRotationRPCsPerSec,EstViewRotationRPCPayloadBytesPerSec,DesiredStateRPCsPerSec,")
+		TEXT("IntentChangesPerSec,EstIntentPayloadBytesPerSec,DesiredStateChangesPerSec,EstDesiredStatePayloadBytesPerSec\n") };
+
+	for (const auto& Record : Records)
+	{
+		const auto* LC{ Record.Component.Get() };
+
+		const auto NumMoves{ LC ? LC->NumMovesReceived - Record.StartMovesReceived : 0 };
+		const auto NumViewRotationRPCs{ LC ? LC->NumViewRotationRPCsReceived - Record.StartViewRotationRPCsReceived : 0 };
+		const auto NumDesiredStateRPCs{ LC ? LC->NumDesiredStateRPCsReceived - Record.StartDesiredStateRPCsReceived : 0 };
+
+		Csv += FString::Printf(TEXT("%s,%d,%d,%.3f,,,,,,,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n"),
+			*Record.Name, Record.bSpawned ? 1 : 0, Record.bRemoteControlled ? 1 : 0, Seconds,
+			NumMoves / Seconds, NumViewRotationRPCs / Seconds, Record.ViewRotationRPCBits / 8.0 / Seconds, NumDesiredStateRPCs / Seconds,
+			Record.IntentChanges / Seconds, Record.IntentBits / 8.0 / Seconds,
+			Record.DesiredStateChanges / Seconds, Record.DesiredStateBits / 8.0 / Seconds);
+	}
+
+	Csv += FString::Printf(TEXT("TOTAL,%d,,%.3f,%lld,%d,%.3f,%.3f,%.2f,%.2f,,,,,,,,\n"),
+		SpawnedCharacters.Num(), Seconds, NumFrames, NumConnections,
+		NumFrames > 0 ? ActorTickSeconds * 1000.0 / NumFrames : 0.0, MaxActorTickSeconds * 1000.0,
+		(OutBytes - StartOutBytes) / Seconds, (InBytes - StartInBytes) / Seconds);
+
+	if (FFileHelper::SaveStringToFile(Csv, *OutputPath))
+	{
+		UE_LOG(LogGLE, Display, TEXT("Locomotion net benchmark written to %s"), *OutputPath);
+	}
+	else
+	{
+		UE_LOG(LogGLE, Warning, TEXT("Locomotion net benchmark could not be written to %s"), *OutputPath);
+	}
+}
@@ -0,0 +1,171 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Subsystems/WorldSubsystem.h"
+
+#include "Type/LocomotionReplicatedIntent.h"
+
+#include "GameplayTagContainer.h"
+
+#include "LocomotionNetBenchmarkSubsystem.generated.h"
+
+class ULocomotionComponent;
+class ACharacter;
+
+
+/**
+ * Replication cost of one character recorded by ULocomotionNetBenchmarkSubsystem
+ */
+struct GLEXT_API FLocomotionNetBenchmarkRecord
+{
+public:
+	TWeakObjectPtr<ULocomotionComponent> Component;
+
+	FString Name;
+
+	//
+	// Values of the replicated properties when last sampled
+	//
+	FLocomotionReplicatedIntent LastIntent;
+	FGameplayTag LastDesiredRotationMode;
+	FGameplayTag LastDesiredStance;
+	FGameplayTag LastDesiredGait;
+
+	//
+	// Number of changes of the replicated properties and the estimated payload bits of one send of the changed values
+	//
+	int64 IntentChanges{ 0 };
+	int64 IntentBits{ 0 };
+	int64 DesiredStateChanges{ 0 };
+	int64 DesiredStateBits{ 0 };
+
+	//
+	// Estimated payload bits of the view rotation RPCs received from the owning client
+	//
+	uint32 LastViewRotationRPCsReceived{ 0 };
+	int64 ViewRotationRPCBits{ 0 };
+
+	//
+	// Counters of the component when the recording started
+	//
+	uint32 StartMovesReceived{ 0 };
+	uint32 StartViewRotationRPCsReceived{ 0 };
+	uint32 StartDesiredStateRPCsReceived{ 0 };
+
+	//
+	// Whether the character was spawned by the benchmark and is driven by scripted inputs
+	//
+	bool bSpawned{ false };
+
+	//
+	// Whether the character is controlled by a client, so that moves and RPCs are received for it
+	//
+	bool bRemoteControlled{ false };
+
+};
+
+
+/**
+ * Subsystem that records the replication cost of LocomotionComponents on the server and writes it to a CSV file
+ *
+ * Tips:
+ *	Started with "glext.Net.Benchmark.Start" and stopped with "glext.Net.Benchmark.Stop".
+ *	The server can be run headless with -nullrhi, and packet lag and loss can be emulated with the PktLag and PktLoss settings of the net driver.
+ *
+ * Note:
+ *	Only the totals of the net driver are measured.
+ *	The "Est" columns are the payload of a single send of the serialized values, without headers, NetUpdateFrequency,
+ *	relevancy, the number of connections or the quantization of Iris, and are only meant to compare the properties and RPCs.
+ *	Spawned characters are controlled by AI on the server, so the move and RPC columns are only filled for the characters of connected clients.
+ *	There is no in-process server with simulated clients, so the clients have to be separate processes connected to the benchmarked server.
+ */
+UCLASS()
+class GLEXT_API ULocomotionNetBenchmarkSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+public:
+	ULocomotionNetBenchmarkSubsystem() {}
+
+protected:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+	virtual void Deinitialize() override;
+
+protected:
+	FDelegateHandle PreActorTickHandle;
+	FDelegateHandle PostActorTickHandle;
+
+	//
+	// Recorded characters
+	//
+	TArray<FLocomotionNetBenchmarkRecord> Records;
+
+	//
+	// Characters spawned by the benchmark
+	//
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<ACharacter>> SpawnedCharacters;
+
+	//
+	// Time of the recording
+	//
+	double Duration{ 0.0 };
+	double ElapsedTime{ 0.0 };
+
+	//
+	// Time spent in ticking actors and the number of frames recorded
+	//
+	double ActorTickStartTime{ 0.0 };
+	double ActorTickSeconds{ 0.0 };
+	double MaxActorTickSeconds{ 0.0 };
+	int64 NumFrames{ 0 };
+
+	//
+	// Totals of the net driver when the recording started
+	//
+	int64 StartOutBytes{ 0 };
+	int64 StartInBytes{ 0 };
+
+	//
+	// Output file of the recording
+	//
+	FString OutputPath;
+
+	bool bRecording{ false };
+
+public:
+	/**
+	 * Start recording the replication cost of all LocomotionComponents in the world
+	 *
+	 * Tips:
+	 *	If SpawnCount is greater than zero, characters of CharacterClass are spawned with AI controllers and driven by scripted inputs.
+	 *	If Seconds is greater than zero, the recording is stopped automatically after that time.
+	 */
+	void StartBenchmark(float Seconds, int32 SpawnCount, TSubclassOf<ACharacter> CharacterClass, const FString& InOutputPath);
+
+	/**
+	 * Stop recording and write the results to the CSV file
+	 */
+	void StopBenchmark();
+
+	/**
+	 * Returns whether the benchmark is recording or not.
+	 */
+	bool IsRecording() const { return bRecording; }
+
+protected:
+	void HandleWorldPreActorTick(UWorld* InWorld, ELevelTick InTickType, float InDeltaSeconds);
+	void HandleWorldPostActorTick(UWorld* InWorld, ELevelTick InTickType, float InDeltaSeconds);
+
+	void SpawnCharacters(int32 SpawnCount, TSubclassOf<ACharacter> CharacterClass);
+	void DriveSpawnedCharacters();
+	void SampleRecords();
+
+	void GetNetDriverTotals(int64& OutBytes, int64& InBytes) const;
+
+	void WriteResults() const;
+
+};
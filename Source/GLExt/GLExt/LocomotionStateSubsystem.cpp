@@ -0,0 +1,465 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionStateSubsystem.h"
+
+#include "LocomotionComponent.h"
+#include "LocomotionData.h"
+#include "LocomotionFunctionLibrary.h"
+#include "GLExtStatGroup.h"
+
+#include "Animation/AnimTypes.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionStateSubsystem)
+
+
+DECLARE_CYCLE_STAT(TEXT("ULocomotionStateSubsystem::Process"), STAT_LocomotionStateSubsystem_Process, STATGROUP_Locomotion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Batched Components"), STAT_LocomotionStateSubsystem_Components, STATGROUP_Locomotion);
+
+static bool GLocomotionBatchStateEnabled{ true };
+static FAutoConsoleVariableRef CVarLocomotionBatchStateEnabled(
+	TEXT("glext.Batch.Enable"),
+	GLocomotionBatchStateEnabled,
+	TEXT("Whether to precompute the locomotion values of all LocomotionComponents in one batch before actors tick."),
+	ECVF_Default);
+
+static int32 GLocomotionBatchStateChunkSize{ 64 };
+static FAutoConsoleVariableRef CVarLocomotionBatchStateChunkSize(
+	TEXT("glext.Batch.ChunkSize"),
+	GLocomotionBatchStateChunkSize,
+	TEXT("Number of components processed by one task of the locomotion batch. The batch runs on the game thread if there is only one chunk."),
+	ECVF_Default);
+
+
+#pragma region Kernels
+
+void LocomotionStateKernels::ComputeInput(const FVector& InputDirection, bool& bOutHasInput, float& OutInputYawAngle)
+{
+	bOutHasInput = InputDirection.SizeSquared() > UE_KINDA_SMALL_NUMBER;
+
+	if (bOutHasInput)
+	{
+		OutInputYawAngle = UE_REAL_TO_FLOAT(ULocomotionFunctionLibrary::DirectionToAngleXY(InputDirection));
+	}
+}
+
+void LocomotionStateKernels::ComputeVelocity(const FVector& Velocity, float& OutSpeed, bool& bOutHasSpeed, float& OutVelocityYawAngle)
+{
+	OutSpeed = UE_REAL_TO_FLOAT(Velocity.Size2D());
+
+	bOutHasSpeed = OutSpeed >= HasSpeedThreshold;
+
+	if (bOutHasSpeed)
+	{
+		OutVelocityYawAngle = UE_REAL_TO_FLOAT(ULocomotionFunctionLibrary::DirectionToAngleXY(Velocity));
+	}
+}
+
+FVector LocomotionStateKernels::ComputeAcceleration(const FVector& Velocity, const FVector& PreviousVelocity, float DeltaTime)
+{
+	return (Velocity - PreviousVelocity) / DeltaTime;
+}
+
+void LocomotionStateKernels::UpdateViewNetworkSmoothing(FViewNetworkSmoothingState& NetworkSmoothing, const FRotator& TargetRotation, bool bOffsetByBase, const FRotator& BaseDeltaRotation, float DeltaTime)
+{
+	if (!NetworkSmoothing.bEnabled ||
+		NetworkSmoothing.ClientTime >= NetworkSmoothing.ServerTime ||
+		NetworkSmoothing.Duration <= UE_SMALL_NUMBER)
+	{
+		NetworkSmoothing.InitialRotation = TargetRotation;
+		NetworkSmoothing.Rotation = TargetRotation;
+		return;
+	}
+
+	if (bOffsetByBase)
+	{
+		NetworkSmoothing.InitialRotation.Pitch += BaseDeltaRotation.Pitch;
+		NetworkSmoothing.InitialRotation.Yaw += BaseDeltaRotation.Yaw;
+		NetworkSmoothing.InitialRotation.Normalize();
+
+		NetworkSmoothing.Rotation.Pitch += BaseDeltaRotation.Pitch;
+		NetworkSmoothing.Rotation.Yaw += BaseDeltaRotation.Yaw;
+		NetworkSmoothing.Rotation.Normalize();
+	}
+
+	NetworkSmoothing.ClientTime += DeltaTime;
+
+	const auto InterpolationAmount{ ULocomotionFunctionLibrary::Clamp01(1.0f - (NetworkSmoothing.ServerTime - NetworkSmoothing.ClientTime) / NetworkSmoothing.Duration) };
+
+	if (!FAnimWeight::IsFullWeight(InterpolationAmount))
+	{
+		NetworkSmoothing.Rotation = ULocomotionFunctionLibrary::LerpRotator(NetworkSmoothing.InitialRotation, TargetRotation, InterpolationAmount);
+	}
+	else
+	{
+		NetworkSmoothing.ClientTime = NetworkSmoothing.ServerTime;
+		NetworkSmoothing.Rotation = TargetRotation;
+	}
+}
+
+float LocomotionStateKernels::ComputeViewYawSpeed(float PreviousYawAngle, const FRotator& Rotation, float DeltaTime)
+{
+	return FMath::Abs(UE_REAL_TO_FLOAT(Rotation.Yaw - PreviousYawAngle)) / DeltaTime;
+}
+
+float LocomotionStateKernels::ComputeReducedSmoothTargetYawAngle(float SmoothTargetYawAngle, float TargetYawAngle, float DeltaTime, float YawInterpolationSpeed)
+{
+	return ULocomotionFunctionLibrary::ExponentialDecayAngle(SmoothTargetYawAngle, TargetYawAngle, DeltaTime, YawInterpolationSpeed);
+}
+
+#pragma endregion
+
+
+#pragma region Precomputed State
+
+static bool IsSameNetworkSmoothing(const FViewNetworkSmoothingState& A, const FViewNetworkSmoothingState& B)
+{
+	return (A.bEnabled == B.bEnabled) &&
+		(A.ServerTime == B.ServerTime) &&
+		(A.ClientTime == B.ClientTime) &&
+		(A.Duration == B.Duration) &&
+		(A.InitialRotation == B.InitialRotation) &&
+		(A.Rotation == B.Rotation);
+}
+
+bool FLocomotionPrecomputedState::IsValidForInput(const FVector& InInputDirection) const
+{
+	return IsCurrentFrame() && (InputDirection == InInputDirection);
+}
+
+bool FLocomotionPrecomputedState::IsValidForVelocity(const FVector& InVelocity) const
+{
+	return IsCurrentFrame() && (Velocity == InVelocity);
+}
+
+bool FLocomotionPrecomputedState::IsValidForAcceleration(const FVector& InVelocity, const FVector& InPreviousVelocity, float DeltaTime) const
+{
+	return IsCurrentFrame() && (FullUpdateDeltaTime == DeltaTime) && (Velocity == InVelocity) && (PreviousVelocity == InPreviousVelocity);
+}
+
+bool FLocomotionPrecomputedState::IsValidForViewNetworkSmoothing(const FViewNetworkSmoothingState& InNetworkSmoothing, const FRotator& InViewRotation, float DeltaTime) const
+{
+	return IsCurrentFrame() && (FullUpdateDeltaTime == DeltaTime) && (ViewRotation == InViewRotation) && IsSameNetworkSmoothing(NetworkSmoothing, InNetworkSmoothing);
+}
+
+bool FLocomotionPrecomputedState::IsValidForViewYawSpeed(float PreviousYawAngle, const FRotator& Rotation, float DeltaTime) const
+{
+	return IsCurrentFrame() && (FullUpdateDeltaTime == DeltaTime) && (ViewYawAngle == PreviousYawAngle) && (NewNetworkSmoothing.Rotation == Rotation);
+}
+
+bool FLocomotionPrecomputedState::IsValidForReducedSmoothTargetYawAngle(float InSmoothTargetYawAngle, float InTargetYawAngle, float InYawInterpolationSpeed, float DeltaTime) const
+{
+	return IsCurrentFrame() && (FrameDeltaTime == DeltaTime) &&
+		(SmoothTargetYawAngle == InSmoothTargetYawAngle) && (TargetYawAngle == InTargetYawAngle) && (YawInterpolationSpeed == InYawInterpolationSpeed);
+}
+
+#pragma endregion
+
+
+#pragma region Subsystem
+
+bool ULocomotionStateSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return (WorldType == EWorldType::Game) || (WorldType == EWorldType::PIE);
+}
+
+void ULocomotionStateSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PreActorTickHandle = FWorldDelegates::OnWorldPreActorTick.AddUObject(this, &ThisClass::HandleWorldPreActorTick);
+}
+
+void ULocomotionStateSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPreActorTick.Remove(PreActorTickHandle);
+
+	for (auto& Component : Components)
+	{
+		if (Component)
+		{
+			Component->StateSubsystemIndex = INDEX_NONE;
+			Component->PrecomputedState.FrameNumber = 0;
+		}
+	}
+
+	Components.Reset();
+	ResizeBuffers(0);
+
+	Super::Deinitialize();
+}
+
+
+void ULocomotionStateSubsystem::RegisterComponent(ULocomotionComponent* Component)
+{
+	if (Component && (Component->StateSubsystemIndex == INDEX_NONE))
+	{
+		Component->StateSubsystemIndex = Components.Add(Component);
+	}
+}
+
+void ULocomotionStateSubsystem::UnregisterComponent(ULocomotionComponent* Component)
+{
+	if (!Component || !Components.IsValidIndex(Component->StateSubsystemIndex))
+	{
+		return;
+	}
+
+	const auto Index{ Component->StateSubsystemIndex };
+	check(Components[Index] == Component);
+
+	Components.RemoveAtSwap(Index, 1);
+
+	if (Components.IsValidIndex(Index))
+	{
+		Components[Index]->StateSubsystemIndex = Index;
+	}
+
+	Component->StateSubsystemIndex = INDEX_NONE;
+	Component->PrecomputedState.FrameNumber = 0;
+}
+
+
+void ULocomotionStateSubsystem::HandleWorldPreActorTick(UWorld* InWorld, ELevelTick InTickType, float InDeltaSeconds)
+{
+	if ((InWorld != GetWorld()) || (InTickType == LEVELTICK_TimeOnly) || !GLocomotionBatchStateEnabled)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_LocomotionStateSubsystem_Process);
+
+	const auto Num{ Components.Num() };
+
+	SET_DWORD_STAT(STAT_LocomotionStateSubsystem_Components, Num);
+
+	if (Num <= 0)
+	{
+		return;
+	}
+
+	ResizeBuffers(Num);
+
+	for (int32 Index{ 0 }; Index < Num; ++Index)
+	{
+		GatherInputs(Index, InDeltaSeconds);
+	}
+
+	// Process in chunks
+
+	const auto ChunkSize{ FMath::Max(GLocomotionBatchStateChunkSize, 1) };
+	const auto NumChunks{ FMath::DivideAndRoundUp(Num, ChunkSize) };
+
+	ParallelFor(NumChunks, [this, ChunkSize, Num](int32 ChunkIndex)
+	{
+		const auto StartIndex{ ChunkIndex * ChunkSize };
+
+		ProcessRange(StartIndex, FMath::Min(StartIndex + ChunkSize, Num));
+
+	}, (NumChunks <= 1) ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	for (int32 Index{ 0 }; Index < Num; ++Index)
+	{
+		WriteResults(Index);
+	}
+}
+
+void ULocomotionStateSubsystem::ResizeBuffers(int32 Num)
+{
+	FrameDeltaTimes.SetNumUninitialized(Num);
+	FullUpdateDeltaTimes.SetNumUninitialized(Num);
+
+	InputX.SetNumUninitialized(Num);
+	InputY.SetNumUninitialized(Num);
+	InputZ.SetNumUninitialized(Num);
+
+	VelocityX.SetNumUninitialized(Num);
+	VelocityY.SetNumUninitialized(Num);
+	VelocityZ.SetNumUninitialized(Num);
+
+	PreviousVelocityX.SetNumUninitialized(Num);
+	PreviousVelocityY.SetNumUninitialized(Num);
+	PreviousVelocityZ.SetNumUninitialized(Num);
+
+	SmoothingEnabled.SetNumUninitialized(Num);
+	SmoothingServerTimes.SetNumUninitialized(Num);
+	SmoothingClientTimes.SetNumUninitialized(Num);
+	SmoothingDurations.SetNumUninitialized(Num);
+	SmoothingInitialRotations.SetNumUninitialized(Num);
+	SmoothingRotations.SetNumUninitialized(Num);
+	ViewRotations.SetNumUninitialized(Num);
+	ViewYawAngles.SetNumUninitialized(Num);
+
+	SmoothTargetYawAngles.SetNumUninitialized(Num);
+	TargetYawAngles.SetNumUninitialized(Num);
+	YawInterpolationSpeeds.SetNumUninitialized(Num);
+
+	InputYawAngles.SetNumUninitialized(Num);
+	HasInputs.SetNumUninitialized(Num);
+
+	Speeds.SetNumUninitialized(Num);
+	VelocityYawAngles.SetNumUninitialized(Num);
+	HasSpeeds.SetNumUninitialized(Num);
+	Accelerations.SetNumUninitialized(Num);
+
+	NewSmoothingClientTimes.SetNumUninitialized(Num);
+	NewSmoothingInitialRotations.SetNumUninitialized(Num);
+	NewSmoothingRotations.SetNumUninitialized(Num);
+	ViewYawSpeeds.SetNumUninitialized(Num);
+
+	NewSmoothTargetYawAngles.SetNumUninitialized(Num);
+}
+
+void ULocomotionStateSubsystem::GatherInputs(int32 Index, float InDeltaSeconds)
+{
+	const auto* Component{ Components[Index].Get() };
+	const auto* Owner{ Component->GetOwner() };
+
+	// Same delta times as the component tick and ULocomotionComponent::UpdateLocomotionLOD()
+
+	const auto FrameDeltaTime{ InDeltaSeconds * (Owner ? Owner->CustomTimeDilation : 1.0f) };
+
+	FrameDeltaTimes[Index] = FrameDeltaTime;
+	FullUpdateDeltaTimes[Index] = Component->LocomotionLODDeltaTime + FrameDeltaTime;
+
+	const auto& InputDirection{ Component->GetInputDirection() };
+
+	InputX[Index] = InputDirection.X;
+	InputY[Index] = InputDirection.Y;
+	InputZ[Index] = InputDirection.Z;
+
+	const auto& Velocity{ Component->Velocity };
+
+	VelocityX[Index] = Velocity.X;
+	VelocityY[Index] = Velocity.Y;
+	VelocityZ[Index] = Velocity.Z;
+
+	// The velocity of the last update becomes the previous velocity in ULocomotionComponent::UpdateLocomotionEarly()
+
+	const auto& PreviousVelocity{ Component->LocomotionState.Velocity };
+
+	PreviousVelocityX[Index] = PreviousVelocity.X;
+	PreviousVelocityY[Index] = PreviousVelocity.Y;
+	PreviousVelocityZ[Index] = PreviousVelocity.Z;
+
+	const auto& NetworkSmoothing{ Component->ViewState.NetworkSmoothing };
+
+	SmoothingEnabled[Index] = NetworkSmoothing.bEnabled ? 1 : 0;
+	SmoothingServerTimes[Index] = NetworkSmoothing.ServerTime;
+	SmoothingClientTimes[Index] = NetworkSmoothing.ClientTime;
+	SmoothingDurations[Index] = NetworkSmoothing.Duration;
+	SmoothingInitialRotations[Index] = NetworkSmoothing.InitialRotation;
+	SmoothingRotations[Index] = NetworkSmoothing.Rotation;
+	ViewRotations[Index] = Component->ReplicatedIntent.ViewRotation;
+	ViewYawAngles[Index] = UE_REAL_TO_FLOAT(Component->ViewState.Rotation.Yaw);
+
+	// The tier of the last update is used, the precomputed value is discarded if the tier of this frame has another speed
+
+	const auto* LODTiers{ Component->LocomotionData ? &Component->LocomotionData->LODTiers : nullptr };
+
+	SmoothTargetYawAngles[Index] = Component->LocomotionState.SmoothTargetYawAngle;
+	TargetYawAngles[Index] = Component->LocomotionState.TargetYawAngle;
+	YawInterpolationSpeeds[Index] = (LODTiers && LODTiers->IsValidIndex(Component->LocomotionLODTier)) ? (*LODTiers)[Component->LocomotionLODTier].YawInterpolationSpeed : 0.0f;
+}
+
+void ULocomotionStateSubsystem::ProcessRange(int32 StartIndex, int32 EndIndex)
+{
+	using namespace LocomotionStateKernels;
+
+	for (int32 Index{ StartIndex }; Index < EndIndex; ++Index)
+	{
+		const auto FullUpdateDeltaTime{ FullUpdateDeltaTimes[Index] };
+
+		// Input
+
+		auto bHasInput{ false };
+		auto InputYawAngle{ 0.0f };
+
+		ComputeInput(FVector(InputX[Index], InputY[Index], InputZ[Index]), bHasInput, InputYawAngle);
+
+		HasInputs[Index] = bHasInput ? 1 : 0;
+		InputYawAngles[Index] = InputYawAngle;
+
+		// Velocity and acceleration
+
+		const FVector Velocity{ VelocityX[Index], VelocityY[Index], VelocityZ[Index] };
+
+		auto bHasSpeed{ false };
+		auto VelocityYawAngle{ 0.0f };
+
+		ComputeVelocity(Velocity, Speeds[Index], bHasSpeed, VelocityYawAngle);
+
+		HasSpeeds[Index] = bHasSpeed ? 1 : 0;
+		VelocityYawAngles[Index] = VelocityYawAngle;
+
+		Accelerations[Index] = ComputeAcceleration(Velocity, FVector(PreviousVelocityX[Index], PreviousVelocityY[Index], PreviousVelocityZ[Index]), FullUpdateDeltaTime);
+
+		// Network smoothing of the view rotation without the offset of a rotating movement base
+
+		FViewNetworkSmoothingState NetworkSmoothing;
+		NetworkSmoothing.bEnabled = (SmoothingEnabled[Index] != 0);
+		NetworkSmoothing.ServerTime = SmoothingServerTimes[Index];
+		NetworkSmoothing.ClientTime = SmoothingClientTimes[Index];
+		NetworkSmoothing.Duration = SmoothingDurations[Index];
+		NetworkSmoothing.InitialRotation = SmoothingInitialRotations[Index];
+		NetworkSmoothing.Rotation = SmoothingRotations[Index];
+
+		UpdateViewNetworkSmoothing(NetworkSmoothing, ViewRotations[Index], false, FRotator::ZeroRotator, FullUpdateDeltaTime);
+
+		NewSmoothingClientTimes[Index] = NetworkSmoothing.ClientTime;
+		NewSmoothingInitialRotations[Index] = NetworkSmoothing.InitialRotation;
+		NewSmoothingRotations[Index] = NetworkSmoothing.Rotation;
+
+		ViewYawSpeeds[Index] = ComputeViewYawSpeed(ViewYawAngles[Index], NetworkSmoothing.Rotation, FullUpdateDeltaTime);
+
+		// Reduced frames of the locomotion LOD
+
+		NewSmoothTargetYawAngles[Index] = ComputeReducedSmoothTargetYawAngle(SmoothTargetYawAngles[Index], TargetYawAngles[Index], FrameDeltaTimes[Index], YawInterpolationSpeeds[Index]);
+	}
+}
+
+void ULocomotionStateSubsystem::WriteResults(int32 Index)
+{
+	auto& Precomputed{ Components[Index]->PrecomputedState };
+
+	Precomputed.FrameNumber = GFrameCounter;
+	Precomputed.FrameDeltaTime = FrameDeltaTimes[Index];
+	Precomputed.FullUpdateDeltaTime = FullUpdateDeltaTimes[Index];
+
+	Precomputed.InputDirection = FVector(InputX[Index], InputY[Index], InputZ[Index]);
+	Precomputed.bHasInput = (HasInputs[Index] != 0);
+	Precomputed.InputYawAngle = InputYawAngles[Index];
+
+	Precomputed.Velocity = FVector(VelocityX[Index], VelocityY[Index], VelocityZ[Index]);
+	Precomputed.PreviousVelocity = FVector(PreviousVelocityX[Index], PreviousVelocityY[Index], PreviousVelocityZ[Index]);
+	Precomputed.Speed = Speeds[Index];
+	Precomputed.bHasSpeed = (HasSpeeds[Index] != 0);
+	Precomputed.VelocityYawAngle = VelocityYawAngles[Index];
+	Precomputed.Acceleration = Accelerations[Index];
+
+	auto& NetworkSmoothing{ Precomputed.NetworkSmoothing };
+	NetworkSmoothing.bEnabled = (SmoothingEnabled[Index] != 0);
+	NetworkSmoothing.ServerTime = SmoothingServerTimes[Index];
+	NetworkSmoothing.ClientTime = SmoothingClientTimes[Index];
+	NetworkSmoothing.Duration = SmoothingDurations[Index];
+	NetworkSmoothing.InitialRotation = SmoothingInitialRotations[Index];
+	NetworkSmoothing.Rotation = SmoothingRotations[Index];
+
+	Precomputed.NewNetworkSmoothing = NetworkSmoothing;
+	Precomputed.NewNetworkSmoothing.ClientTime = NewSmoothingClientTimes[Index];
+	Precomputed.NewNetworkSmoothing.InitialRotation = NewSmoothingInitialRotations[Index];
+	Precomputed.NewNetworkSmoothing.Rotation = NewSmoothingRotations[Index];
+
+	Precomputed.ViewRotation = ViewRotations[Index];
+	Precomputed.ViewYawAngle = ViewYawAngles[Index];
+	Precomputed.ViewYawSpeed = ViewYawSpeeds[Index];
+
+	Precomputed.SmoothTargetYawAngle = SmoothTargetYawAngles[Index];
+	Precomputed.TargetYawAngle = TargetYawAngles[Index];
+	Precomputed.YawInterpolationSpeed = YawInterpolationSpeeds[Index];
+	Precomputed.NewSmoothTargetYawAngle = NewSmoothTargetYawAngles[Index];
+}
+
+#pragma endregion
@@ -0,0 +1,239 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Subsystems/WorldSubsystem.h"
+
+#include "State/ViewState.h"
+
+#include "LocomotionStateSubsystem.generated.h"
+
+class ULocomotionComponent;
+
+
+/**
+ * Pure math of the locomotion updates shared by ULocomotionComponent and ULocomotionStateSubsystem
+ *
+ * Tips:
+ *	Both the per-component updates and the batch call these functions with the same inputs,
+ *	so that the values precomputed by the batch are identical to the values computed by the component.
+ */
+namespace LocomotionStateKernels
+{
+	//
+	// Threshold of speed at which the character is judged to have speed
+	//
+	static constexpr float HasSpeedThreshold{ 1.0f };
+
+	/**
+	 * Computes whether there is an input and its yaw angle (the angle is only written if there is an input)
+	 */
+	GLEXT_API void ComputeInput(const FVector& InputDirection, bool& bOutHasInput, float& OutInputYawAngle);
+
+	/**
+	 * Computes the horizontal speed, whether there is a speed and the yaw angle of the velocity (the angle is only written if there is a speed)
+	 */
+	GLEXT_API void ComputeVelocity(const FVector& Velocity, float& OutSpeed, bool& bOutHasSpeed, float& OutVelocityYawAngle);
+
+	/**
+	 * Computes the acceleration from the velocity of the previous update
+	 */
+	GLEXT_API FVector ComputeAcceleration(const FVector& Velocity, const FVector& PreviousVelocity, float DeltaTime);
+
+	/**
+	 * Advances the network smoothing of the view rotation toward the target rotation
+	 *
+	 * Tips:
+	 *	BaseDeltaRotation is added to the smoothed rotations only if bOffsetByBase is true.
+	 */
+	GLEXT_API void UpdateViewNetworkSmoothing(FViewNetworkSmoothingState& NetworkSmoothing, const FRotator& TargetRotation, bool bOffsetByBase, const FRotator& BaseDeltaRotation, float DeltaTime);
+
+	/**
+	 * Computes the yaw speed of the view
+	 */
+	GLEXT_API float ComputeViewYawSpeed(float PreviousYawAngle, const FRotator& Rotation, float DeltaTime);
+
+	/**
+	 * Computes the smooth target yaw angle of the frames reduced by the locomotion LOD
+	 */
+	GLEXT_API float ComputeReducedSmoothTargetYawAngle(float SmoothTargetYawAngle, float TargetYawAngle, float DeltaTime, float YawInterpolationSpeed);
+}
+
+
+/**
+ * Locomotion values precomputed by ULocomotionStateSubsystem for one component
+ *
+ * Tips:
+ *	The inputs gathered before actors tick are stored along with the results.
+ *	Each result is only used by the component in the same frame and if its inputs are still equal to the gathered ones,
+ *	otherwise the component computes it again with LocomotionStateKernels.
+ */
+struct GLEXT_API FLocomotionPrecomputedState
+{
+public:
+	//
+	// Frame in which the values were precomputed
+	//
+	uint64 FrameNumber{ 0 };
+
+	//
+	// Delta time of the frame and of the next full update (including the time accumulated by the locomotion LOD)
+	//
+	float FrameDeltaTime{ 0.0f };
+	float FullUpdateDeltaTime{ 0.0f };
+
+	//
+	// Input
+	//
+	FVector InputDirection{ ForceInit };
+	float InputYawAngle{ 0.0f };
+	bool bHasInput{ false };
+
+	//
+	// Velocity and acceleration
+	//
+	FVector Velocity{ ForceInit };
+	FVector PreviousVelocity{ ForceInit };
+	float Speed{ 0.0f };
+	float VelocityYawAngle{ 0.0f };
+	bool bHasSpeed{ false };
+	FVector Acceleration{ ForceInit };
+
+	//
+	// Network smoothing of the view rotation and the yaw speed of the view
+	//
+	FViewNetworkSmoothingState NetworkSmoothing;
+	FRotator ViewRotation{ ForceInit };
+	FViewNetworkSmoothingState NewNetworkSmoothing;
+	float ViewYawAngle{ 0.0f };
+	float ViewYawSpeed{ 0.0f };
+
+	//
+	// Smooth target yaw angle of the frames reduced by the locomotion LOD
+	//
+	float SmoothTargetYawAngle{ 0.0f };
+	float TargetYawAngle{ 0.0f };
+	float YawInterpolationSpeed{ 0.0f };
+	float NewSmoothTargetYawAngle{ 0.0f };
+
+public:
+	bool IsValidForInput(const FVector& InInputDirection) const;
+	bool IsValidForVelocity(const FVector& InVelocity) const;
+	bool IsValidForAcceleration(const FVector& InVelocity, const FVector& InPreviousVelocity, float DeltaTime) const;
+	bool IsValidForViewNetworkSmoothing(const FViewNetworkSmoothingState& InNetworkSmoothing, const FRotator& InViewRotation, float DeltaTime) const;
+	bool IsValidForViewYawSpeed(float PreviousYawAngle, const FRotator& Rotation, float DeltaTime) const;
+	bool IsValidForReducedSmoothTargetYawAngle(float InSmoothTargetYawAngle, float InTargetYawAngle, float InYawInterpolationSpeed, float DeltaTime) const;
+
+protected:
+	bool IsCurrentFrame() const { return FrameNumber == GFrameCounter; }
+
+};
+
+
+/**
+ * Subsystem that computes the locomotion values of all registered LocomotionComponents in one batch
+ *
+ * Tips:
+ *	Before actors tick, the hot fields of all components (velocity, input, view smoothing timers and rotations, yaw angles)
+ *	are gathered into structure-of-arrays buffers, LocomotionStateKernels is run for them in chunks with ParallelFor,
+ *	and the results are written back to each component on the game thread before PerformMovement().
+ *
+ * Note:
+ *	The yaw speed of the locomotion depends on the rotation after the movement, so it is not batched.
+ *	The movement base offsets applied to the view are not batched either, and the component computes the view smoothing itself while it is on a rotating base.
+ */
+UCLASS()
+class GLEXT_API ULocomotionStateSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+public:
+	ULocomotionStateSubsystem() {}
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+protected:
+	FDelegateHandle PreActorTickHandle;
+
+	//
+	// Registered components
+	//
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<ULocomotionComponent>> Components;
+
+	//
+	// Input buffers
+	//
+	TArray<float> FrameDeltaTimes;
+	TArray<float> FullUpdateDeltaTimes;
+
+	TArray<FVector::FReal> InputX;
+	TArray<FVector::FReal> InputY;
+	TArray<FVector::FReal> InputZ;
+
+	TArray<FVector::FReal> VelocityX;
+	TArray<FVector::FReal> VelocityY;
+	TArray<FVector::FReal> VelocityZ;
+
+	TArray<FVector::FReal> PreviousVelocityX;
+	TArray<FVector::FReal> PreviousVelocityY;
+	TArray<FVector::FReal> PreviousVelocityZ;
+
+	TArray<uint8> SmoothingEnabled;
+	TArray<float> SmoothingServerTimes;
+	TArray<float> SmoothingClientTimes;
+	TArray<float> SmoothingDurations;
+	TArray<FRotator> SmoothingInitialRotations;
+	TArray<FRotator> SmoothingRotations;
+	TArray<FRotator> ViewRotations;
+	TArray<float> ViewYawAngles;
+
+	TArray<float> SmoothTargetYawAngles;
+	TArray<float> TargetYawAngles;
+	TArray<float> YawInterpolationSpeeds;
+
+	//
+	// Output buffers
+	//
+	TArray<float> InputYawAngles;
+	TArray<uint8> HasInputs;
+
+	TArray<float> Speeds;
+	TArray<float> VelocityYawAngles;
+	TArray<uint8> HasSpeeds;
+	TArray<FVector> Accelerations;
+
+	TArray<float> NewSmoothingClientTimes;
+	TArray<FRotator> NewSmoothingInitialRotations;
+	TArray<FRotator> NewSmoothingRotations;
+	TArray<float> ViewYawSpeeds;
+
+	TArray<float> NewSmoothTargetYawAngles;
+
+public:
+	/**
+	 * Add the component to the batch
+	 */
+	void RegisterComponent(ULocomotionComponent* Component);
+
+	/**
+	 * Remove the component from the batch
+	 */
+	void UnregisterComponent(ULocomotionComponent* Component);
+
+protected:
+	void HandleWorldPreActorTick(UWorld* InWorld, ELevelTick InTickType, float InDeltaSeconds);
+
+	void ResizeBuffers(int32 Num);
+
+	void GatherInputs(int32 Index, float InDeltaSeconds);
+
+	void ProcessRange(int32 StartIndex, int32 EndIndex);
+
+	void WriteResults(int32 Index);
+
+};
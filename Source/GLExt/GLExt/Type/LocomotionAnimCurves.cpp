@@ -0,0 +1,48 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionAnimCurves.h"
+
+#include "LocomotionGeneralNameStatics.h"
+
+#include "Animation/AnimInstance.h"
+
+
+void FLocomotionAnimCurveValues::Read(const UAnimInstance* AnimInstance)
+{
+	if (!AnimInstance)
+	{
+		return;
+	}
+
+	// One lookup per curve in the list of the last evaluation, instead of going through GetCurveValue() for each read
+
+	const auto& Curves{ AnimInstance->GetAnimationCurveList(EAnimCurveType::AttributeCurve) };
+
+	for (auto Index{ 0 }; Index < static_cast<uint8>(ELocomotionAnimCurve::MAX); ++Index)
+	{
+		const auto* Value{ Curves.IsEmpty() ? nullptr : Curves.Find(GetCurveName(static_cast<ELocomotionAnimCurve>(Index))) };
+
+		Values[Index] = Value ? *Value : 0.0f;
+	}
+
+	bValid = true;
+}
+
+const FName& FLocomotionAnimCurveValues::GetCurveName(ELocomotionAnimCurve Curve)
+{
+	switch (Curve)
+	{
+	case ELocomotionAnimCurve::ViewBlock:
+		return ULocomotionGeneralNameStatics::ViewBlockCurveName();
+
+	case ELocomotionAnimCurve::AllowAiming:
+		return ULocomotionGeneralNameStatics::AllowAimingCurveName();
+
+	case ELocomotionAnimCurve::RotationYawSpeed:
+		return ULocomotionGeneralNameStatics::RotationYawSpeedCurveName();
+
+	default:
+		static const FName None{ NAME_None };
+		return None;
+	}
+}
@@ -0,0 +1,76 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UAnimInstance;
+
+
+/**
+ * Animation curves read by the locomotion after each evaluation
+ * 
+ * Tips:
+ *	The names are defined in ULocomotionGeneralNameStatics.
+ *	Only the curves consumed by UCharacterAnimInstance and ULocomotionComponent are listed, so that no lookup is wasted.
+ */
+enum class ELocomotionAnimCurve : uint8
+{
+	ViewBlock,
+	AllowAiming,
+	RotationYawSpeed,
+
+	MAX
+};
+
+
+/**
+ * Values of the animation curves read by the locomotion in one pass
+ * 
+ * Tips:
+ *	Read once after the animation is evaluated so that the values can be used on any thread
+ *	and by ULocomotionComponent without looking up the curves by name again.
+ */
+struct GLEXT_API FLocomotionAnimCurveValues
+{
+public:
+	FLocomotionAnimCurveValues() {}
+
+protected:
+	//
+	// Value of each curve (zero if the curve was not evaluated)
+	//
+	float Values[static_cast<uint8>(ELocomotionAnimCurve::MAX)]{ 0.0f };
+
+	//
+	// Whether the values have been read at least once
+	//
+	bool bValid{ false };
+
+public:
+	/**
+	 * Read the values of the curves from the curves last evaluated by the anim instance
+	 */
+	void Read(const UAnimInstance* AnimInstance);
+
+	/**
+	 * Returns the name of the curve
+	 */
+	static const FName& GetCurveName(ELocomotionAnimCurve Curve);
+
+	/**
+	 * Returns the value of the curve
+	 */
+	float Get(ELocomotionAnimCurve Curve) const { return Values[static_cast<uint8>(Curve)]; }
+
+	/**
+	 * Returns the value of the curve clamped to [0, 1]
+	 */
+	float GetClamped01(ELocomotionAnimCurve Curve) const { return FMath::Clamp(Get(Curve), 0.0f, 1.0f); }
+
+	/**
+	 * Returns whether the values have been read at least once
+	 */
+	bool IsValid() const { return bValid; }
+
+};
@@ -0,0 +1,74 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "State/MovementBaseState.h"
+#include "State/AnimationViewState.h"
+#include "State/AnimationLocomotionState.h"
+#include "Type/LocomotionAnimCurves.h"
+
+#include "GameplayTagContainer.h"
+
+#include "LocomotionAnimFollowerTypes.generated.h"
+
+
+/**
+ * How an anim instance of a mesh other than the main mesh follows the anim instance of the main mesh (leader)
+ *
+ * Tips:
+ *	The anim instance of the main mesh is always the leader and computes the states from the locomotion snapshot.
+ */
+UENUM(BlueprintType)
+enum class ECharacterAnimFollowMode : uint8
+{
+	// Compute all states independently from the locomotion snapshot
+	None,
+
+	// Reuse the states computed by the leader
+	States,
+
+	// Reuse the states computed by the leader and the locomotion curves evaluated by the leader
+	StatesAndCurves,
+
+	// Copy the pose of the main mesh, so that the anim graph of this anim instance is not run
+	// (The skeleton of the mesh must be compatible with the main mesh)
+	Pose
+};
+
+
+/**
+ * States of the anim instance of the main mesh published for its followers
+ *
+ * Tips:
+ *	Published on the game thread after the leader is evaluated and copied once by FLocomotionAnimInstanceProxy::PreUpdate() of each follower.
+ */
+struct GLEXT_API FLocomotionAnimLeaderStates
+{
+public:
+	//
+	// Number incremented each time the states are published
+	//
+	uint32 SequenceNumber{ 0 };
+
+	//
+	// Character states
+	//
+	FGameplayTag LocomotionMode;
+	FGameplayTag RotationMode;
+	FGameplayTag Stance;
+	FGameplayTag Gait;
+	FGameplayTag LocomotionAction;
+
+	//
+	// States computed by the leader
+	//
+	FMovementBaseState MovementBase;
+	FAnimationViewState ViewState;
+	FAnimationLocomotionState LocomotionState;
+
+	//
+	// Locomotion curves evaluated by the leader
+	//
+	FLocomotionAnimCurveValues CurveValues;
+
+};
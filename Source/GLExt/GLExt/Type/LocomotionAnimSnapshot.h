@@ -0,0 +1,64 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "State/ViewState.h"
+#include "State/LocomotionState.h"
+#include "State/MovementBaseState.h"
+
+#include "GameplayTagContainer.h"
+
+
+/**
+ * Snapshot of the locomotion published by ULocomotionComponent for the animation
+ * 
+ * Tips:
+ *	Published once at the end of the movement update and copied once by FLocomotionAnimInstanceProxy::PreUpdate(),
+ *	so that the anim instance does not read the component field by field on the game thread.
+ *	Values derived from it are computed on the worker thread.
+ */
+struct GLEXT_API FLocomotionAnimSnapshot
+{
+public:
+	//
+	// Number incremented each time the snapshot is published
+	//
+	uint32 SequenceNumber{ 0 };
+
+	//
+	// Character states
+	//
+	FGameplayTag LocomotionMode;
+	FGameplayTag RotationMode;
+	FGameplayTag Stance;
+	FGameplayTag Gait;
+	FGameplayTag LocomotionAction;
+
+	//
+	// Movement base computed by ULocomotionComponent::UpdateMovementBase()
+	//
+	FMovementBaseState MovementBase;
+
+	//
+	// View
+	//
+	FRotator ViewRotation{ ForceInit };
+	float ViewYawSpeed{ 0.0f };
+
+	//
+	// Locomotion
+	//
+	FLocomotionState Locomotion;
+
+	float MaxAcceleration{ 0.0f };
+	float MaxBrakingDeceleration{ 0.0f };
+	float WalkableFloorZ{ 0.0f };
+
+	//
+	// Scale of the mesh and scaled size of the capsule
+	//
+	float MeshScale{ 1.0f };
+	float CapsuleRadius{ 0.0f };
+	float CapsuleHalfHeight{ 0.0f };
+
+};
@@ -0,0 +1,188 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionConditionProgram.h"
+
+#include "Condition/LocomotionCondition.h"
+#include "LocomotionComponent.h"
+
+
+/////////////////////////////////////////////////////////////////////////
+// FLocomotionConditionContext
+
+#pragma region FLocomotionConditionContext
+
+FLocomotionConditionContext::FLocomotionConditionContext(const ULocomotionComponent* InLC)
+	: LC(InLC)
+	, LocomotionState(InLC->GetLocomotionState())
+	, ViewState(InLC->GetViewState())
+{
+}
+
+const FGameplayTagContainer& FLocomotionConditionContext::GetStateTags() const
+{
+	if (bStateTagsDirty)
+	{
+		StateTags.Reset();
+		StateTags.AddTag(LC->GetLocomotionMode());
+		StateTags.AddTag(LC->GetRotationMode());
+		StateTags.AddTag(LC->GetStance());
+		StateTags.AddTag(LC->GetGait());
+		StateTags.AddTag(LC->GetLocomotionAction());
+
+		bStateTagsDirty = false;
+	}
+
+	return StateTags;
+}
+
+#pragma endregion
+
+
+/////////////////////////////////////////////////////////////////////////
+// FLocomotionConditionProgram
+
+#pragma region FLocomotionConditionProgram
+
+void FLocomotionConditionProgram::Reset()
+{
+	Instructions.Reset();
+	TagQueries.Reset();
+	Conditions.Reset();
+
+	CompileDepth = 0;
+}
+
+int32 FLocomotionConditionProgram::Compile(const ULocomotionCondition* Condition)
+{
+	const auto Entry{ Instructions.Num() };
+
+	CompileChild(Condition);
+
+	return Entry;
+}
+
+bool FLocomotionConditionProgram::Evaluate(int32 Entry, const FLocomotionConditionContext& Context) const
+{
+	check(Instructions.IsValidIndex(Entry));
+
+	return EvaluateInstruction(Entry, Context);
+}
+
+
+void FLocomotionConditionProgram::CompileChild(const ULocomotionCondition* Condition)
+{
+	if (!Condition)
+	{
+		AddInstruction(ELocomotionConditionOp::True);
+		return;
+	}
+
+	++CompileDepth;
+
+	Condition->Compile(*this);
+
+	--CompileDepth;
+}
+
+int32 FLocomotionConditionProgram::AddInstruction(ELocomotionConditionOp Op, float Param0, float Param1, int32 Payload)
+{
+	auto& NewInstruction{ Instructions.AddDefaulted_GetRef() };
+	NewInstruction.Op = Op;
+	NewInstruction.Param0 = Param0;
+	NewInstruction.Param1 = Param1;
+	NewInstruction.Payload = Payload;
+
+	return Instructions.Num() - 1;
+}
+
+int32 FLocomotionConditionProgram::AddComposite(ELocomotionConditionOp Op, int32 NumChildren)
+{
+	check(NumChildren <= MAX_uint8);
+
+	const auto Index{ AddInstruction(Op) };
+	Instructions[Index].NumChildren = static_cast<uint8>(NumChildren);
+
+	return Index;
+}
+
+void FLocomotionConditionProgram::FinishInstruction(int32 Index)
+{
+	const auto SubtreeSize{ Instructions.Num() - Index };
+	check(SubtreeSize <= MAX_uint16);
+
+	Instructions[Index].SubtreeSize = static_cast<uint16>(SubtreeSize);
+}
+
+int32 FLocomotionConditionProgram::AddCallCondition(const ULocomotionCondition* Condition)
+{
+	return AddInstruction(ELocomotionConditionOp::CallCondition, 0.0f, 0.0f, Conditions.Add(Condition));
+}
+
+
+bool FLocomotionConditionProgram::EvaluateInstruction(int32 Index, const FLocomotionConditionContext& Context) const
+{
+	const auto& Instruction{ Instructions[Index] };
+
+	switch (Instruction.Op)
+	{
+	case ELocomotionConditionOp::True:
+		return true;
+
+	case ELocomotionConditionOp::And:
+	{
+		auto ChildIndex{ Index + 1 };
+
+		for (int32 Count{ 0 }; Count < Instruction.NumChildren; ++Count)
+		{
+			if (!EvaluateInstruction(ChildIndex, Context))
+			{
+				return false;
+			}
+
+			ChildIndex += Instructions[ChildIndex].SubtreeSize;
+		}
+
+		return true;
+	}
+
+	case ELocomotionConditionOp::Or:
+	{
+		auto ChildIndex{ Index + 1 };
+
+		for (int32 Count{ 0 }; Count < Instruction.NumChildren; ++Count)
+		{
+			if (EvaluateInstruction(ChildIndex, Context))
+			{
+				return true;
+			}
+
+			ChildIndex += Instructions[ChildIndex].SubtreeSize;
+		}
+
+		return false;
+	}
+
+	case ELocomotionConditionOp::Not:
+		return !EvaluateInstruction(Index + 1, Context);
+
+	case ELocomotionConditionOp::SpeedRange:
+		return (Context.LocomotionState.Speed >= Instruction.Param0) && (Context.LocomotionState.Speed <= Instruction.Param1);
+
+	case ELocomotionConditionOp::HasInput:
+		return Context.LocomotionState.bHasInput == (Instruction.Payload != 0);
+
+	case ELocomotionConditionOp::MovingDirection:
+		return FMath::Abs(FRotator3f::NormalizeAxis(UE_REAL_TO_FLOAT(
+			Context.LocomotionState.InputYawAngle - Context.ViewState.Rotation.Yaw))) < Instruction.Param0;
+
+	case ELocomotionConditionOp::TagQuery:
+		return TagQueries[Instruction.Payload].Matches(Context.GetStateTags());
+
+	case ELocomotionConditionOp::CallCondition:
+		return Conditions[Instruction.Payload]->CanEnter(Context.LC);
+	}
+
+	return false;
+}
+
+#pragma endregion
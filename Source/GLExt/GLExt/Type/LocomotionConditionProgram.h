@@ -0,0 +1,200 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "State/LocomotionState.h"
+#include "State/ViewState.h"
+
+#include "GameplayTagContainer.h"
+
+class ULocomotionComponent;
+class ULocomotionCondition;
+
+
+/**
+ * Operation of the compiled condition instruction
+ */
+enum class ELocomotionConditionOp : uint8
+{
+	// Always true
+	True,
+
+	// True if all of the following NumChildren subtrees are true
+	And,
+
+	// True if any of the following NumChildren subtrees is true
+	Or,
+
+	// True if the following subtree is false
+	Not,
+
+	// True if Speed is in [Param0, Param1]
+	SpeedRange,
+
+	// True if bHasInput is equal to (Payload != 0)
+	HasInput,
+
+	// True if the angle between InputYawAngle and view yaw is less than Param0
+	MovingDirection,
+
+	// True if the state tags match TagQueries[Payload]
+	TagQuery,
+
+	// Result of the virtual CanEnter() of Conditions[Payload]
+	CallCondition,
+};
+
+
+/**
+ * Instruction of the compiled condition program
+ *
+ * Tips:
+ *	Instructions are stored in prefix order,
+ *	and SubtreeSize is used to skip the children of an instruction.
+ */
+struct GLEXT_API FLocomotionConditionInstruction
+{
+public:
+	ELocomotionConditionOp Op{ ELocomotionConditionOp::True };
+
+	uint8 NumChildren{ 0 };
+
+	uint16 SubtreeSize{ 1 };
+
+	int32 Payload{ INDEX_NONE };
+
+	float Param0{ 0.0f };
+
+	float Param1{ 0.0f };
+
+};
+
+
+/**
+ * Read-only inputs of the condition program
+ *
+ * Note:
+ *	The state tags are collected on the first use.
+ *	MarkStateTagsDirty() must be called when a state tag of the component is changed while the context is in use.
+ */
+struct GLEXT_API FLocomotionConditionContext
+{
+public:
+	explicit FLocomotionConditionContext(const ULocomotionComponent* InLC);
+
+public:
+	const ULocomotionComponent* LC;
+
+	const FLocomotionState& LocomotionState;
+
+	const FViewState& ViewState;
+
+private:
+	mutable FGameplayTagContainer StateTags;
+
+	mutable bool bStateTagsDirty{ true };
+
+public:
+	/**
+	 * Returns LocomotionMode, RotationMode, Stance, Gait and LocomotionAction of the component as a container
+	 */
+	const FGameplayTagContainer& GetStateTags() const;
+
+	/**
+	 * Collect the state tags again on the next use
+	 */
+	void MarkStateTagsDirty() { bStateTagsDirty = true; }
+
+};
+
+
+/**
+ * Flat instruction buffer compiled from trees of ULocomotionCondition
+ *
+ * Tips:
+ *	Built-in conditions compile themselves into instructions evaluated by a non-virtual interpreter.
+ *	Other conditions are compiled into CallCondition, which falls back to their virtual CanEnter().
+ */
+class GLEXT_API FLocomotionConditionProgram
+{
+public:
+	FLocomotionConditionProgram() {}
+
+	//
+	// Maximum depth of the condition tree to be compiled into instructions.
+	// Deeper subtrees are evaluated by their virtual CanEnter().
+	//
+	static constexpr int32 MaxCompileDepth{ 32 };
+
+protected:
+	TArray<FLocomotionConditionInstruction> Instructions;
+
+	TArray<FGameplayTagQuery> TagQueries;
+
+	TArray<const ULocomotionCondition*> Conditions;
+
+	int32 CompileDepth{ 0 };
+
+public:
+	/**
+	 * Clear the program
+	 */
+	void Reset();
+
+	/**
+	 * Compile the condition tree and returns the index of its first instruction
+	 */
+	int32 Compile(const ULocomotionCondition* Condition);
+
+	/**
+	 * Evaluate the condition starting at the instruction
+	 */
+	bool Evaluate(int32 Entry, const FLocomotionConditionContext& Context) const;
+
+	/**
+	 * Returns the number of the compiled instructions
+	 */
+	int32 GetNumInstructions() const { return Instructions.Num(); }
+
+	////////////////////////////////////////////////
+	// Emitters used by ULocomotionCondition::Compile()
+public:
+	/**
+	 * Compile a child condition. None is compiled as True.
+	 */
+	void CompileChild(const ULocomotionCondition* Condition);
+
+	/**
+	 * Add an instruction and returns its index
+	 */
+	int32 AddInstruction(ELocomotionConditionOp Op, float Param0 = 0.0f, float Param1 = 0.0f, int32 Payload = INDEX_NONE);
+
+	/**
+	 * Add an And/Or instruction and returns its index
+	 */
+	int32 AddComposite(ELocomotionConditionOp Op, int32 NumChildren);
+
+	/**
+	 * Set SubtreeSize of the instruction after its children are added
+	 */
+	void FinishInstruction(int32 Index);
+
+	/**
+	 * Add an instruction that calls the virtual CanEnter() of the condition
+	 */
+	int32 AddCallCondition(const ULocomotionCondition* Condition);
+
+	/**
+	 * Add the tag query referenced by TagQuery instruction and returns its index
+	 */
+	int32 AddTagQuery(const FGameplayTagQuery& Query) { return TagQueries.Add(Query); }
+
+	/**
+	 * Returns whether the children of a composite condition can be compiled into instructions
+	 */
+	bool CanCompileChildren(int32 NumChildren) const { return (CompileDepth < MaxCompileDepth) && (NumChildren <= MAX_uint8); }
+
+protected:
+	bool EvaluateInstruction(int32 Index, const FLocomotionConditionContext& Context) const;
+
+};
@@ -0,0 +1,436 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionConfigTable.h"
+
+#include "LocomotionComponent.h"
+#include "LocomotionData.h"
+#include "GLExtLogs.h"
+
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+
+
+static bool GLocomotionUseConditionProgram{ true };
+static FAutoConsoleVariableRef CVarLocomotionUseConditionProgram(
+	TEXT("glext.Condition.UseProgram"),
+	GLocomotionUseConditionProgram,
+	TEXT("Whether to evaluate locomotion conditions with the compiled condition program instead of the virtual CanEnter()."),
+	ECVF_Default);
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs CmdLocomotionBenchmarkConditions(
+	TEXT("glext.Condition.Benchmark"),
+	TEXT("Evaluate the locomotion conditions of every LocomotionComponent in the world with the condition program and the virtual CanEnter(). Usage: glext.Condition.Benchmark [Iterations]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const auto Iterations{ Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 10000 };
+
+		for (TObjectIterator<ULocomotionComponent> It; It; ++It)
+		{
+			const auto* LC{ *It };
+			const auto* LocomotionData{ LC ? LC->GetLocomotionData() : nullptr };
+
+			if (!LocomotionData || (LC->GetWorld() != World))
+			{
+				continue;
+			}
+
+			const FLocomotionConditionContext Context{ LC };
+
+			double ProgramSeconds{ 0.0 };
+			double VirtualSeconds{ 0.0 };
+			const auto NumMismatches{ LocomotionData->GetConfigTable().BenchmarkConditions(Context, Iterations, ProgramSeconds, VirtualSeconds) };
+
+			UE_LOG(LogGLE, Display, TEXT("[%s] Condition benchmark (%d iterations): Program %.3f ms, Virtual %.3f ms, Mismatches %d"),
+				*GetNameSafe(LC->GetOwner()), Iterations, ProgramSeconds * 1000.0, VirtualSeconds * 1000.0, NumMismatches);
+		}
+	}));
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////
+// FLocomotionConfigTable
+
+#pragma region FLocomotionConfigTable
+
+static uint32 GLocomotionConfigTableVersion{ 0 };
+
+void FLocomotionConfigTable::Build(const TMap<FGameplayTag, FCharacterLocomotionModeConfigs>& LocomotionModes)
+{
+	Reset();
+
+	// Give state ids to all state tags in the hierarchy
+
+	for (const auto& ModeKVP : LocomotionModes)
+	{
+		AddStateTag(ELocomotionConfigLevel::LocomotionMode, ModeKVP.Key);
+
+		for (const auto& RotationModeKVP : ModeKVP.Value.RotationModes)
+		{
+			AddStateTag(ELocomotionConfigLevel::RotationMode, RotationModeKVP.Key);
+
+			for (const auto& StanceKVP : RotationModeKVP.Value.Stances)
+			{
+				AddStateTag(ELocomotionConfigLevel::Stance, StanceKVP.Key);
+
+				for (const auto& GaitKVP : StanceKVP.Value.Gaits)
+				{
+					AddStateTag(ELocomotionConfigLevel::Gait, GaitKVP.Key);
+				}
+			}
+		}
+	}
+
+	// Flatten the hierarchy into nodes of each level
+
+	const auto NumRotationModes{ GetNumStates(ELocomotionConfigLevel::RotationMode) };
+	const auto NumStances{ GetNumStates(ELocomotionConfigLevel::Stance) };
+	const auto NumGaits{ GetNumStates(ELocomotionConfigLevel::Gait) };
+
+	for (const auto& ModeKVP : LocomotionModes)
+	{
+		const auto& ModeConfigs{ ModeKVP.Value };
+
+		const auto ModeNode{ AddNode(ELocomotionConfigLevel::LocomotionMode, ModeKVP.Key, ModeConfigs.Condition) };
+		const auto ModeLookupOffset{ ChildLookup.AddUninitialized(NumRotationModes) };
+		FMemory::Memset(&ChildLookup[ModeLookupOffset], 0xFF, NumRotationModes * sizeof(int32));
+
+		Nodes[static_cast<uint8>(ELocomotionConfigLevel::LocomotionMode)][ModeNode].ChildLookupOffset = ModeLookupOffset;
+		LocomotionSpaces.Add(ModeConfigs.LocomotionSpace);
+
+		for (const auto& RotationModeKVP : ModeConfigs.RotationModes)
+		{
+			const auto& RotationModeConfigs{ RotationModeKVP.Value };
+
+			const auto RotationModeNode{ AddNode(ELocomotionConfigLevel::RotationMode, RotationModeKVP.Key, RotationModeConfigs.Condition) };
+			const auto RotationModeLookupOffset{ ChildLookup.AddUninitialized(NumStances) };
+			FMemory::Memset(&ChildLookup[RotationModeLookupOffset], 0xFF, NumStances * sizeof(int32));
+
+			Nodes[static_cast<uint8>(ELocomotionConfigLevel::RotationMode)][RotationModeNode].ChildLookupOffset = RotationModeLookupOffset;
+			ChildLookup[ModeLookupOffset + FindStateId(ELocomotionConfigLevel::RotationMode, RotationModeKVP.Key)] = RotationModeNode;
+
+			for (const auto& StanceKVP : RotationModeConfigs.Stances)
+			{
+				const auto& StanceConfigs{ StanceKVP.Value };
+
+				const auto StanceNode{ AddNode(ELocomotionConfigLevel::Stance, StanceKVP.Key, StanceConfigs.Condition) };
+				const auto StanceLookupOffset{ ChildLookup.AddUninitialized(NumGaits) };
+				FMemory::Memset(&ChildLookup[StanceLookupOffset], 0xFF, NumGaits * sizeof(int32));
+
+				Nodes[static_cast<uint8>(ELocomotionConfigLevel::Stance)][StanceNode].ChildLookupOffset = StanceLookupOffset;
+				ChildLookup[RotationModeLookupOffset + FindStateId(ELocomotionConfigLevel::Stance, StanceKVP.Key)] = StanceNode;
+
+				for (const auto& GaitKVP : StanceConfigs.Gaits)
+				{
+					const auto GaitNode{ AddNode(ELocomotionConfigLevel::Gait, GaitKVP.Key, GaitKVP.Value.Condition) };
+
+					GaitConfigs.Add(GaitKVP.Value);
+					ChildLookup[StanceLookupOffset + FindStateId(ELocomotionConfigLevel::Gait, GaitKVP.Key)] = GaitNode;
+				}
+
+				Nodes[static_cast<uint8>(ELocomotionConfigLevel::Stance)][StanceNode].DefaultChild =
+					FindChild(ELocomotionConfigLevel::Stance, StanceNode, FindStateId(ELocomotionConfigLevel::Gait, StanceConfigs.DefaultGait));
+			}
+
+			Nodes[static_cast<uint8>(ELocomotionConfigLevel::RotationMode)][RotationModeNode].DefaultChild =
+				FindChild(ELocomotionConfigLevel::RotationMode, RotationModeNode, FindStateId(ELocomotionConfigLevel::Stance, RotationModeConfigs.DefaultStance));
+		}
+
+		Nodes[static_cast<uint8>(ELocomotionConfigLevel::LocomotionMode)][ModeNode].DefaultChild =
+			FindChild(ELocomotionConfigLevel::LocomotionMode, ModeNode, FindStateId(ELocomotionConfigLevel::RotationMode, ModeConfigs.DefaultRotationMode));
+	}
+
+	// Precompute the fallback chains of the children of all parent nodes
+
+	for (uint8 Level{ 0 }; Level < static_cast<uint8>(ELocomotionConfigLevel::Gait); ++Level)
+	{
+		for (int32 NodeIndex{ 0 }; NodeIndex < Nodes[Level].Num(); ++NodeIndex)
+		{
+			BuildFallbackChains(static_cast<ELocomotionConfigLevel>(Level), NodeIndex);
+		}
+	}
+
+	Version = ++GLocomotionConfigTableVersion;
+}
+
+void FLocomotionConfigTable::Reset()
+{
+	Version = 0;
+
+	for (uint8 Level{ 0 }; Level < static_cast<uint8>(ELocomotionConfigLevel::MAX); ++Level)
+	{
+		StateTags[Level].Reset();
+		StateIds[Level].Reset();
+		Nodes[Level].Reset();
+	}
+
+	ChildLookup.Reset();
+	LocomotionSpaces.Reset();
+	GaitConfigs.Reset();
+
+	ConditionInputs = ELocomotionConditionInput::None;
+
+	ConditionProgram.Reset();
+	FallbackChains.Reset();
+	BuildErrors.Reset();
+	BuildWarnings.Reset();
+}
+
+
+int32 FLocomotionConfigTable::FindStateId(ELocomotionConfigLevel Level, const FGameplayTag& Tag) const
+{
+	const auto* FoundStateId{ StateIds[static_cast<uint8>(Level)].Find(Tag) };
+
+	return FoundStateId ? *FoundStateId : INDEX_NONE;
+}
+
+int32 FLocomotionConfigTable::ResolveStateId(ELocomotionConfigLevel Level, const FGameplayTag& Tag, FLocomotionStateIdCache& Cache) const
+{
+	if (Cache.Tag != Tag || Cache.TableVersion != Version)
+	{
+		Cache.Tag = Tag;
+		Cache.StateId = FindStateId(Level, Tag);
+		Cache.TableVersion = Version;
+	}
+
+	return Cache.StateId;
+}
+
+const FGameplayTag& FLocomotionConfigTable::GetStateTag(ELocomotionConfigLevel Level, int32 StateId) const
+{
+	const auto& Tags{ StateTags[static_cast<uint8>(Level)] };
+
+	return Tags.IsValidIndex(StateId) ? Tags[StateId] : FGameplayTag::EmptyTag;
+}
+
+
+int32 FLocomotionConfigTable::FindLocomotionMode(int32 StateId) const
+{
+	return Nodes[static_cast<uint8>(ELocomotionConfigLevel::LocomotionMode)].IsValidIndex(StateId) ? StateId : INDEX_NONE;
+}
+
+int32 FLocomotionConfigTable::FindChild(ELocomotionConfigLevel ParentLevel, int32 ParentNode, int32 ChildStateId) const
+{
+	if (ChildStateId == INDEX_NONE)
+	{
+		return INDEX_NONE;
+	}
+
+	return ChildLookup[GetNode(ParentLevel, ParentNode).ChildLookupOffset + ChildStateId];
+}
+
+int32 FLocomotionConfigTable::GetAllowedChild(ELocomotionConfigLevel ParentLevel, int32 ParentNode, int32 DesiredStateId, const FLocomotionConditionContext& Context) const
+{
+	const auto ChildLevel{ GetChildLevel(ParentLevel) };
+
+	// Search child node from lookup
+
+	const auto ChildNode{ FindChild(ParentLevel, ParentNode, DesiredStateId) };
+	if (ChildNode != INDEX_NONE)
+	{
+		// Returns the first node in the fallback chain whose Condition is not set or can be entered
+
+		const auto& Node{ GetNode(ChildLevel, ChildNode) };
+
+		for (int32 Index{ 0 }; Index < Node.FallbackCount; ++Index)
+		{
+			const auto CandidateNode{ FallbackChains[Node.FallbackOffset + Index] };
+
+			if (CanEnterNode(ChildLevel, CandidateNode, Context))
+			{
+				return CandidateNode;
+			}
+		}
+	}
+
+	// Returns default node if transitive node is not found
+
+	const auto DefaultChild{ GetNode(ParentLevel, ParentNode).DefaultChild };
+	check(DefaultChild != INDEX_NONE);
+
+	return DefaultChild;
+}
+
+bool FLocomotionConfigTable::CanEnterNode(ELocomotionConfigLevel Level, int32 NodeIndex, const FLocomotionConditionContext& Context) const
+{
+	const auto& Node{ GetNode(Level, NodeIndex) };
+
+	if (!Node.Condition)
+	{
+		return true;
+	}
+
+	if (GLocomotionUseConditionProgram)
+	{
+		return ConditionProgram.Evaluate(Node.ConditionEntry, Context);
+	}
+
+	return Node.Condition->CanEnter(Context.LC);
+}
+
+int32 FLocomotionConfigTable::BenchmarkConditions(const FLocomotionConditionContext& Context, int32 Iterations, double& OutProgramSeconds, double& OutVirtualSeconds) const
+{
+	TArray<const FLocomotionConfigNode*> ConditionNodes;
+
+	for (uint8 Level{ 0 }; Level < static_cast<uint8>(ELocomotionConfigLevel::MAX); ++Level)
+	{
+		for (const auto& Node : Nodes[Level])
+		{
+			if (Node.Condition)
+			{
+				ConditionNodes.Add(&Node);
+			}
+		}
+	}
+
+	int32 NumMismatches{ 0 };
+
+	for (const auto* Node : ConditionNodes)
+	{
+		if (ConditionProgram.Evaluate(Node->ConditionEntry, Context) != Node->Condition->CanEnter(Context.LC))
+		{
+			++NumMismatches;
+		}
+	}
+
+	// Write the results to volatile so that the evaluation is not optimized away
+
+	volatile bool bResult{ false };
+
+	auto StartSeconds{ FPlatformTime::Seconds() };
+
+	for (int32 Iteration{ 0 }; Iteration < Iterations; ++Iteration)
+	{
+		for (const auto* Node : ConditionNodes)
+		{
+			bResult = ConditionProgram.Evaluate(Node->ConditionEntry, Context);
+		}
+	}
+
+	OutProgramSeconds = FPlatformTime::Seconds() - StartSeconds;
+	StartSeconds = FPlatformTime::Seconds();
+
+	for (int32 Iteration{ 0 }; Iteration < Iterations; ++Iteration)
+	{
+		for (const auto* Node : ConditionNodes)
+		{
+			bResult = Node->Condition->CanEnter(Context.LC);
+		}
+	}
+
+	OutVirtualSeconds = FPlatformTime::Seconds() - StartSeconds;
+
+	return NumMismatches;
+}
+
+
+int32 FLocomotionConfigTable::AddStateTag(ELocomotionConfigLevel Level, const FGameplayTag& Tag)
+{
+	auto& Ids{ StateIds[static_cast<uint8>(Level)] };
+
+	if (const auto* FoundStateId{ Ids.Find(Tag) })
+	{
+		return *FoundStateId;
+	}
+
+	const auto NewStateId{ StateTags[static_cast<uint8>(Level)].Add(Tag) };
+	Ids.Add(Tag, NewStateId);
+
+	return NewStateId;
+}
+
+int32 FLocomotionConfigTable::AddNode(ELocomotionConfigLevel Level, const FGameplayTag& Tag, const ULocomotionCondition* Condition)
+{
+	auto& NewNode{ Nodes[static_cast<uint8>(Level)].AddDefaulted_GetRef() };
+	NewNode.Tag = Tag;
+	NewNode.Condition = Condition;
+	NewNode.StateId = FindStateId(Level, Tag);
+	NewNode.ConditionEntry = Condition ? ConditionProgram.Compile(Condition) : INDEX_NONE;
+
+	// Conditions of LocomotionMode are only evaluated when MovementMode is changed
+
+	if (Condition && (Level != ELocomotionConfigLevel::LocomotionMode))
+	{
+		ConditionInputs |= Condition->GetDependentInputs();
+	}
+
+	return Nodes[static_cast<uint8>(Level)].Num() - 1;
+}
+
+void FLocomotionConfigTable::BuildFallbackChains(ELocomotionConfigLevel ParentLevel, int32 ParentNode)
+{
+	const auto ChildLevel{ GetChildLevel(ParentLevel) };
+	const auto NumChildStates{ GetNumStates(ChildLevel) };
+	const auto& Parent{ GetNode(ParentLevel, ParentNode) };
+
+	// The default child is entered without checking its Condition, so it must exist
+
+	if (Parent.DefaultChild == INDEX_NONE)
+	{
+		BuildErrors.Add(FString::Printf(TEXT("Default child of [%s] is not defined in its children."), *Parent.Tag.ToString()));
+	}
+
+	TArray<int32, TInlineAllocator<16>> Chain;
+
+	for (int32 ChildStateId{ 0 }; ChildStateId < NumChildStates; ++ChildStateId)
+	{
+		const auto ChildNode{ FindChild(ParentLevel, ParentNode, ChildStateId) };
+		if (ChildNode == INDEX_NONE)
+		{
+			continue;
+		}
+
+		// Follow SuggestStateTag until a node without it, a node outside of the parent or an already visited node
+
+		Chain.Reset();
+
+		auto CurrentNode{ ChildNode };
+
+		while (CurrentNode != INDEX_NONE)
+		{
+			if (Chain.Contains(CurrentNode))
+			{
+				BuildErrors.AddUnique(FString::Printf(TEXT("SuggestStateTag of [%s] in [%s] forms a cycle at [%s]."),
+					*GetNode(ChildLevel, ChildNode).Tag.ToString(), *Parent.Tag.ToString(), *GetNode(ChildLevel, CurrentNode).Tag.ToString()));
+				break;
+			}
+
+			Chain.Add(CurrentNode);
+
+			const auto* Condition{ GetNode(ChildLevel, CurrentNode).Condition };
+
+			// Nodes without Condition always can be entered, so the chain ends here
+
+			if (!Condition || !Condition->SuggestStateTag.IsValid())
+			{
+				break;
+			}
+
+			const auto SuggestNode{ FindChild(ParentLevel, ParentNode, FindStateId(ChildLevel, Condition->SuggestStateTag)) };
+
+			if (SuggestNode == INDEX_NONE)
+			{
+				BuildWarnings.AddUnique(FString::Printf(TEXT("SuggestStateTag [%s] of [%s] is not defined in [%s], default child is used instead."),
+					*Condition->SuggestStateTag.ToString(), *GetNode(ChildLevel, CurrentNode).Tag.ToString(), *Parent.Tag.ToString()));
+			}
+
+			CurrentNode = SuggestNode;
+		}
+
+		auto& Node{ Nodes[static_cast<uint8>(ChildLevel)][ChildNode] };
+		Node.FallbackOffset = FallbackChains.Num();
+		Node.FallbackCount = Chain.Num();
+
+		FallbackChains.Append(Chain);
+	}
+}
+
+ELocomotionConfigLevel FLocomotionConfigTable::GetChildLevel(ELocomotionConfigLevel Level)
+{
+	check(Level < ELocomotionConfigLevel::Gait);
+
+	return static_cast<ELocomotionConfigLevel>(static_cast<uint8>(Level) + 1);
+}
+
+#pragma endregion
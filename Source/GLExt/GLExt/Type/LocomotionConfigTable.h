@@ -0,0 +1,324 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "LocomotionConfigTypes.h"
+#include "Condition/LocomotionCondition.h"
+#include "Type/LocomotionConditionProgram.h"
+
+#include "GameplayTagContainer.h"
+
+/**
+ * Hierarchy level of the compiled locomotion config table
+ */
+enum class ELocomotionConfigLevel : uint8
+{
+	LocomotionMode,
+	RotationMode,
+	Stance,
+	Gait,
+
+	MAX
+};
+
+
+/**
+ * Node of the compiled locomotion config hierarchy
+ */
+struct GLEXT_API FLocomotionConfigNode
+{
+public:
+	//
+	// State tag represented by this node
+	//
+	FGameplayTag Tag;
+
+	//
+	// Conditions to determine if a transition is possible
+	//
+	const ULocomotionCondition* Condition{ nullptr };
+
+	//
+	// Index of the first instruction of Condition in the condition program
+	//
+	int32 ConditionEntry{ INDEX_NONE };
+
+	//
+	// Id of the state tag in the level of this node
+	//
+	int32 StateId{ INDEX_NONE };
+
+	//
+	// Offset in the child lookup of this node.
+	//
+	// Tips:
+	//	The lookup has one slot for each state id of the next level and stores the index of the child node.
+	//
+	int32 ChildLookupOffset{ INDEX_NONE };
+
+	//
+	// Index of the child node to be transitioned when an invalid state is set.
+	//
+	int32 DefaultChild{ INDEX_NONE };
+
+	//
+	// Offset and length of the fallback chain of this node.
+	//
+	// Tips:
+	//	The chain starts with this node and continues with the sibling nodes suggested by SuggestStateTag of each condition.
+	//	It is precomputed at build time and never contains the same node twice.
+	//
+	int32 FallbackOffset{ INDEX_NONE };
+	int32 FallbackCount{ 0 };
+
+};
+
+
+/**
+ * Cache of the state id resolved from a state tag
+ *
+ * Tips:
+ *	Converting a tag to a state id requires a hash lookup,
+ *	so the last result is kept and reused as long as the tag and the table are unchanged.
+ */
+struct GLEXT_API FLocomotionStateIdCache
+{
+public:
+	FGameplayTag Tag;
+
+	int32 StateId{ INDEX_NONE };
+
+	uint32 TableVersion{ 0 };
+
+};
+
+
+/**
+ * Snapshot of the inputs used when the configs were resolved from the table
+ */
+struct GLEXT_API FLocomotionConfigResolveInputs
+{
+public:
+	FGameplayTag LocomotionMode;
+
+	FGameplayTag DesiredRotationMode;
+
+	FGameplayTag DesiredStance;
+
+	FGameplayTag DesiredGait;
+
+	FGameplayTag LocomotionAction;
+
+	float InputYawAngle{ 0.0f };
+
+	float ViewYawAngle{ 0.0f };
+
+	float Speed{ 0.0f };
+
+	bool bHasInput{ false };
+
+	bool bCrouching{ false };
+
+	//
+	// States resolved from the inputs
+	//
+	FGameplayTag RotationMode;
+
+	FGameplayTag Stance;
+
+	FGameplayTag Gait;
+
+};
+
+
+/**
+ * Flattened, index-addressed table compiled from the nested config maps of LocomotionData
+ *
+ * Tips:
+ *	Each state tag is given a small integer id for each level,
+ *	and the nodes of each level are stored in contiguous arrays,
+ *	so that resolving the current configs becomes array indexing instead of chained map lookups.
+ *
+ * Note:
+ *	The nested maps of LocomotionData remain the authoring format.
+ *	This table must be rebuilt whenever they are changed.
+ */
+class GLEXT_API FLocomotionConfigTable
+{
+public:
+	FLocomotionConfigTable() {}
+
+protected:
+	//
+	// Version of the built table used to invalidate FLocomotionStateIdCache
+	//
+	uint32 Version{ 0 };
+
+	//
+	// List of state tags for each level (index is the state id)
+	//
+	TArray<FGameplayTag> StateTags[static_cast<uint8>(ELocomotionConfigLevel::MAX)];
+
+	//
+	// Mapping of state tags and state ids for each level
+	//
+	TMap<FGameplayTag, int32> StateIds[static_cast<uint8>(ELocomotionConfigLevel::MAX)];
+
+	//
+	// List of nodes for each level
+	//
+	// Tips:
+	//	The node index of LocomotionMode level is the same as its state id.
+	//
+	TArray<FLocomotionConfigNode> Nodes[static_cast<uint8>(ELocomotionConfigLevel::MAX)];
+
+	//
+	// Lookup from the state id of the next level to the child node index for each node
+	//
+	TArray<int32> ChildLookup;
+
+	//
+	// LocomotionSpace for each LocomotionMode node
+	//
+	TArray<ELocomotionSpace> LocomotionSpaces;
+
+	//
+	// Configs for each Gait node
+	//
+	TArray<FCharacterGaitConfigs> GaitConfigs;
+
+	//
+	// Inputs read by all conditions evaluated while resolving RotationMode, Stance and Gait
+	//
+	ELocomotionConditionInput ConditionInputs{ ELocomotionConditionInput::None };
+
+	//
+	// Instructions compiled from the conditions of all nodes
+	//
+	FLocomotionConditionProgram ConditionProgram;
+
+	//
+	// Node indices of the fallback chains of all nodes
+	//
+	TArray<int32> FallbackChains;
+
+	//
+	// Errors and warnings found in the configs while building
+	//
+	TArray<FString> BuildErrors;
+	TArray<FString> BuildWarnings;
+
+public:
+	/**
+	 * Build the table from the nested config maps
+	 */
+	void Build(const TMap<FGameplayTag, FCharacterLocomotionModeConfigs>& LocomotionModes);
+
+	/**
+	 * Clear the table
+	 */
+	void Reset();
+
+	/**
+	 * Returns whether the table has been built or not.
+	 */
+	bool IsBuilt() const { return Version != 0; }
+
+	/**
+	 * Find the state id of the tag in the level
+	 */
+	int32 FindStateId(ELocomotionConfigLevel Level, const FGameplayTag& Tag) const;
+
+	/**
+	 * Find the state id of the tag in the level using the cache
+	 */
+	int32 ResolveStateId(ELocomotionConfigLevel Level, const FGameplayTag& Tag, FLocomotionStateIdCache& Cache) const;
+
+	/**
+	 * Returns the number of the state ids in the level
+	 */
+	int32 GetNumStates(ELocomotionConfigLevel Level) const { return StateTags[static_cast<uint8>(Level)].Num(); }
+
+	/**
+	 * Returns the number of bits needed to encode a state id of the level and INDEX_NONE
+	 */
+	int32 GetStateIdBits(ELocomotionConfigLevel Level) const { return FMath::CeilLogTwo(static_cast<uint32>(GetNumStates(Level) + 1)); }
+
+	/**
+	 * Returns the state tag of the state id in the level
+	 */
+	const FGameplayTag& GetStateTag(ELocomotionConfigLevel Level, int32 StateId) const;
+
+	/**
+	 * Returns the node of the node index in the level
+	 */
+	const FLocomotionConfigNode& GetNode(ELocomotionConfigLevel Level, int32 NodeIndex) const { return Nodes[static_cast<uint8>(Level)][NodeIndex]; }
+
+	/**
+	 * Find the LocomotionMode node of the state id
+	 */
+	int32 FindLocomotionMode(int32 StateId) const;
+
+	/**
+	 * Find the child node of the state id in the next level of the parent node
+	 */
+	int32 FindChild(ELocomotionConfigLevel ParentLevel, int32 ParentNode, int32 ChildStateId) const;
+
+	/**
+	 * Get the child node that can be transitioned in the next level of the parent node
+	 * 
+	 * Tips:
+	 *	The fallback chain of the desired child is tested in order, and the default child is returned if none can be entered.
+	 *	Therefore, the number of conditions evaluated is at most the number of children of the parent node.
+	 */
+	int32 GetAllowedChild(ELocomotionConfigLevel ParentLevel, int32 ParentNode, int32 DesiredStateId, const FLocomotionConditionContext& Context) const;
+
+	/**
+	 * Returns whether the condition of the node can be entered
+	 * 
+	 * Tips:
+	 *	The compiled condition program is used unless disabled by "glext.Condition.UseProgram".
+	 */
+	bool CanEnterNode(ELocomotionConfigLevel Level, int32 NodeIndex, const FLocomotionConditionContext& Context) const;
+
+	/**
+	 * Evaluate the conditions of all nodes with both the condition program and the virtual CanEnter()
+	 * and returns the elapsed seconds of each.
+	 * 
+	 * Returns the number of the conditions whose results were different.
+	 */
+	int32 BenchmarkConditions(const FLocomotionConditionContext& Context, int32 Iterations, double& OutProgramSeconds, double& OutVirtualSeconds) const;
+
+	/**
+	 * Returns the LocomotionSpace of the LocomotionMode node
+	 */
+	ELocomotionSpace GetLocomotionSpace(int32 ModeNode) const { return LocomotionSpaces[ModeNode]; }
+
+	/**
+	 * Returns the configs of the Gait node
+	 */
+	const FCharacterGaitConfigs& GetGaitConfigs(int32 GaitNode) const { return GaitConfigs[GaitNode]; }
+
+	/**
+	 * Returns the inputs read by all conditions evaluated while resolving RotationMode, Stance and Gait
+	 */
+	ELocomotionConditionInput GetConditionInputs() const { return ConditionInputs; }
+
+	/**
+	 * Returns the errors found in the configs while building
+	 */
+	const TArray<FString>& GetBuildErrors() const { return BuildErrors; }
+
+	/**
+	 * Returns the warnings found in the configs while building
+	 */
+	const TArray<FString>& GetBuildWarnings() const { return BuildWarnings; }
+
+protected:
+	int32 AddStateTag(ELocomotionConfigLevel Level, const FGameplayTag& Tag);
+	int32 AddNode(ELocomotionConfigLevel Level, const FGameplayTag& Tag, const ULocomotionCondition* Condition);
+	void BuildFallbackChains(ELocomotionConfigLevel ParentLevel, int32 ParentNode);
+
+	static ELocomotionConfigLevel GetChildLevel(ELocomotionConfigLevel Level);
+
+};
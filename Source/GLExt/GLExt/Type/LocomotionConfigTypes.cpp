@@ -15,18 +15,27 @@ namespace LocomotionConfigHelper
 	static const ReturnType& GetAllowedConfig(const FGameplayTag& DefaultState, const TMap<FGameplayTag, ReturnType>& ConfigMap,
 		const ULocomotionComponent* LC, const FGameplayTag& DesiredState, FGameplayTag& OutState)
 	{
-		// Search Configs from ConfigMap
+		// Follow SuggestStateTag at most once for each Configs so that a cycle in the data cannot loop forever
 
-		const auto* Configs{ ConfigMap.Find(DesiredState) };
-		if (Configs)
+		auto State{ DesiredState };
+
+		for (int32 Step{ 0 }; Step < ConfigMap.Num(); ++Step)
 		{
+			// Search Configs from ConfigMap
+
+			const auto* Configs{ ConfigMap.Find(State) };
+			if (!Configs)
+			{
+				break;
+			}
+
 			// If Condition is not set, return as is
 
 			const auto& Condition{ Configs->Condition };
 
 			if (!Condition)
 			{
-				OutState = DesiredState;
+				OutState = State;
 				return *Configs;
 			}
 
@@ -34,23 +43,23 @@ namespace LocomotionConfigHelper
 
 			if (Condition->CanEnter(LC))
 			{
-				OutState = DesiredState;
+				OutState = State;
 				return *Configs;
 			}
 
-			// Returns Configs based on SuggestStateTag of Condition if transition is not possible.
+			// Try Configs based on SuggestStateTag of Condition if transition is not possible.
 
-			const auto& SuggestTag{ Condition->SuggestStateTag };
+			State = Condition->SuggestStateTag;
 
-			if (SuggestTag.IsValid())
+			if (!State.IsValid())
 			{
-				return LocomotionConfigHelper::GetAllowedConfig<ReturnType>(DefaultState, ConfigMap, LC, SuggestTag, OutState);
+				break;
 			}
 		}
 
 		// Returns Configs based on DefaultState if transitive Configs are not found
 
-		Configs = ConfigMap.Find(DefaultState);
+		const auto* Configs{ ConfigMap.Find(DefaultState) };
 		check(Configs);
 
 		OutState = DefaultState;
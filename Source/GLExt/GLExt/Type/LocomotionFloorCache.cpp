@@ -0,0 +1,96 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionFloorCache.h"
+
+#include "GameFramework/Character.h"
+
+
+void FLocomotionFloorCache::Store(
+	const FFindFloorResult& InFloorResult,
+	const FVector& InCapsuleLocation,
+	float InLineDistance,
+	float InSweepDistance,
+	float InSweepRadius,
+	float InCapsuleRadius,
+	float InCapsuleHalfHeight,
+	double InTime)
+{
+	auto* HitComponent{ InFloorResult.HitResult.GetComponent() };
+
+	// Only walkable floors on static bases outside of penetration can be reused
+
+	bValid = InFloorResult.IsWalkableFloor() && !InFloorResult.HitResult.bStartPenetrating &&
+		HitComponent && !MovementBaseUtility::IsDynamicBase(HitComponent);
+
+	if (!bValid)
+	{
+		return;
+	}
+
+	FloorResult = InFloorResult;
+	CapsuleLocation = InCapsuleLocation;
+	LineDistance = InLineDistance;
+	SweepDistance = InSweepDistance;
+	SweepRadius = InSweepRadius;
+	CapsuleRadius = InCapsuleRadius;
+	CapsuleHalfHeight = InCapsuleHalfHeight;
+	FloorComponent = HitComponent;
+	Time = InTime;
+}
+
+bool FLocomotionFloorCache::TryReuse(
+	FFindFloorResult& OutFloorResult,
+	const FVector& InCapsuleLocation,
+	float InLineDistance,
+	float InSweepDistance,
+	float InSweepRadius,
+	float InCapsuleRadius,
+	float InCapsuleHalfHeight,
+	double InTime,
+	float Tolerance,
+	double MaxAge) const
+{
+	if (!bValid)
+	{
+		return false;
+	}
+
+	// The same query must be requested with the same capsule
+
+	if ((LineDistance != InLineDistance) || (SweepDistance != InSweepDistance) || (SweepRadius != InSweepRadius) ||
+		(CapsuleRadius != InCapsuleRadius) || (CapsuleHalfHeight != InCapsuleHalfHeight))
+	{
+		return false;
+	}
+
+	if ((InTime - Time) > MaxAge)
+	{
+		return false;
+	}
+
+	if (FVector::DistSquared(CapsuleLocation, InCapsuleLocation) > FMath::Square(Tolerance))
+	{
+		return false;
+	}
+
+	// The floor may have been destroyed or made movable since
+
+	const auto* Component{ FloorComponent.Get() };
+
+	if (!Component || MovementBaseUtility::IsDynamicBase(Component))
+	{
+		return false;
+	}
+
+	const auto DeltaHeight{ UE_REAL_TO_FLOAT(InCapsuleLocation.Z - CapsuleLocation.Z) };
+
+	OutFloorResult = FloorResult;
+	OutFloorResult.FloorDist += DeltaHeight;
+
+	if (OutFloorResult.bLineTrace)
+	{
+		OutFloorResult.LineDist += DeltaHeight;
+	}
+
+	return true;
+}
@@ -0,0 +1,96 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "GameFramework/CharacterMovementComponent.h"
+
+
+/**
+ * Cache of the last floor found by ComputeFloorDist()
+ *
+ * Tips:
+ *	While the capsule stays within the tolerance on the same static floor,
+ *	the previous result is reused instead of running the sweeps and the line trace again.
+ *
+ * Note:
+ *	Results on dynamic bases, results in penetration and results without a walkable floor are never reused.
+ */
+struct GLEXT_API FLocomotionFloorCache
+{
+public:
+	FLocomotionFloorCache() {}
+
+protected:
+	//
+	// Result of the last floor check
+	//
+	FFindFloorResult FloorResult;
+
+	//
+	// Inputs of the last floor check
+	//
+	FVector CapsuleLocation{ FVector::ZeroVector };
+	float LineDistance{ 0.0f };
+	float SweepDistance{ 0.0f };
+	float SweepRadius{ 0.0f };
+	float CapsuleRadius{ 0.0f };
+	float CapsuleHalfHeight{ 0.0f };
+
+	//
+	// Component of the floor in the last floor check
+	//
+	TWeakObjectPtr<UPrimitiveComponent> FloorComponent;
+
+	//
+	// World time of the last floor check
+	//
+	double Time{ 0.0 };
+
+	//
+	// Whether the cache can be reused or not
+	//
+	bool bValid{ false };
+
+public:
+	/**
+	 * Store the result of the floor check if it can be reused later
+	 */
+	void Store(
+		const FFindFloorResult& InFloorResult,
+		const FVector& InCapsuleLocation,
+		float InLineDistance,
+		float InSweepDistance,
+		float InSweepRadius,
+		float InCapsuleRadius,
+		float InCapsuleHalfHeight,
+		double InTime);
+
+	/**
+	 * Copy the cached result to OutFloorResult if it can be reused for the floor check
+	 * 
+	 * Tips:
+	 *	The floor distance is corrected by the height the capsule has moved since the cached check.
+	 */
+	bool TryReuse(
+		FFindFloorResult& OutFloorResult,
+		const FVector& InCapsuleLocation,
+		float InLineDistance,
+		float InSweepDistance,
+		float InSweepRadius,
+		float InCapsuleRadius,
+		float InCapsuleHalfHeight,
+		double InTime,
+		float Tolerance,
+		double MaxAge) const;
+
+	/**
+	 * Discard the cached result
+	 */
+	void Invalidate() { bValid = false; }
+
+	/**
+	 * Returns whether the cache has a result or not
+	 */
+	bool IsValid() const { return bValid; }
+
+};
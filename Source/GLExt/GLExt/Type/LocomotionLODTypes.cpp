@@ -0,0 +1,5 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionLODTypes.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionLODTypes)
@@ -0,0 +1,119 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "GameplayTagContainer.h"
+
+#include "LocomotionLODTypes.generated.h"
+
+
+/**
+ * Level of detail of the locomotion update for simulated proxies and AI
+ * 
+ * Tips:
+ *	Tiers are tested in order and the first tier whose requirements are met is used.
+ *	If none of them are met, the last tier is used.
+ *	Therefore, tiers should be ordered from the highest fidelity to the lowest.
+ */
+USTRUCT(BlueprintType)
+struct GLEXT_API FLocomotionLODTier
+{
+	GENERATED_BODY()
+public:
+	FLocomotionLODTier() {}
+
+public:
+	//
+	// Maximum distance from the viewer at which this tier can be used (0 means unlimited)
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Meta = (ClampMin = 0, ForceUnits = "cm"))
+	float MaxDistance{ 0.0f };
+
+	//
+	// Minimum screen size of the mesh bounds at which this tier can be used (0 means any size)
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Meta = (ClampMin = 0, ClampMax = 1))
+	float MinScreenSize{ 0.0f };
+
+	//
+	// Whether the mesh must have been rendered recently to use this tier
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bRequireVisible{ false };
+
+	//
+	// Interval between full locomotion updates (0 means every frame)
+	// 
+	// Tips:
+	//	Between full updates, only the location, rotation and speed are refreshed,
+	//	and the smooth target yaw angle is interpolated.
+	//	The actor rotation of authority characters is still updated every frame, since it is replicated.
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Meta = (ClampMin = 0, ForceUnits = "s"))
+	float UpdateInterval{ 0.0f };
+
+	//
+	// Speed of the interpolation of the smooth target yaw angle between full updates
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Meta = (ClampMin = 0))
+	float YawInterpolationSpeed{ 10.0f };
+
+};
+
+
+/**
+ * Significance of the character fed to the animation budget allocator
+ * 
+ * Tips:
+ *	Only used when the main mesh is a USkeletalMeshComponentBudgeted (e.g. ALocomotionCharacter_Budgeted) and the allocator is enabled ("a.Budget.Enabled").
+ *	The total time of the animation of all budgeted meshes is limited by "a.Budget.BudgetMs",
+ *	and meshes with lower significance are ticked less often when it is exceeded.
+ */
+USTRUCT(BlueprintType)
+struct GLEXT_API FLocomotionAnimBudgetSettings
+{
+	GENERATED_BODY()
+public:
+	FLocomotionAnimBudgetSettings() {}
+
+public:
+	//
+	// Distance from the nearest viewer within which the significance is not reduced
+	// 
+	// Tips:
+	//	Beyond this distance, the significance decreases with the square of the distance.
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Meta = (ClampMin = 1, ForceUnits = "cm"))
+	float ReferenceDistance{ 1000.0f };
+
+	//
+	// Scale of the significance while the character is not moving
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Meta = (ClampMin = 0))
+	float IdleSignificanceScale{ 0.5f };
+
+	//
+	// Scale of the significance for each Gait while the character is moving (1 if not listed)
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Meta = (ForceInlineRow, Categories = "Status.Gait", ClampMin = 0))
+	TMap<FGameplayTag, float> GaitSignificanceScales;
+
+	//
+	// Scale of the significance while a LocomotionAction is in progress
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Meta = (ClampMin = 0))
+	float ActionSignificanceScale{ 2.0f };
+
+	//
+	// Whether the mesh is never skipped by the allocator while a LocomotionAction is in progress
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bNeverSkipInAction{ false };
+
+	//
+	// Whether the mesh of the locally controlled character is never skipped by the allocator
+	//
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bNeverSkipLocallyControlled{ true };
+
+};
@@ -3,7 +3,6 @@
 #include "LocomotionNetworkTypes.h"
 
 #include "LocomotionComponent.h"
-#include "GameplayTag/GLETags_Status.h"
 
 #include "GameFramework/Character.h"
 
@@ -15,9 +14,6 @@
 
 FLocomotionNetworkMoveData::FLocomotionNetworkMoveData()
 {
-	RotationMode	= TAG_Status_RotationMode_ViewDirection;
-	Stance			= TAG_Status_Stance_Standing;
-	Gait			= TAG_Status_Gait_Walking;
 }
 
 void FLocomotionNetworkMoveData::ClientFillNetworkMoveData(const FSavedMove_Character& Move, ENetworkMoveType MoveType)
@@ -26,18 +22,81 @@ void FLocomotionNetworkMoveData::ClientFillNetworkMoveData(const FSavedMove_Char
 
 	const auto& SavedMove{ static_cast<const FLocomotionSavedMove&>(Move) };
 
-	RotationMode	= SavedMove.RotationMode;
-	Stance			= SavedMove.Stance;
-	Gait			= SavedMove.Gait;
+	PackedStates = SavedMove.PackedStates;
+	PackedDesiredStates = SavedMove.PackedDesiredStates;
+	bHasPackedStates = true;
 }
 
 bool FLocomotionNetworkMoveData::Serialize(UCharacterMovementComponent& Movement, FArchive& Archive, UPackageMap* Map, const ENetworkMoveType MoveType) 
 {
 	Super::Serialize(Movement, Archive, Map, MoveType);
 
-	NetSerializeOptionalValue(Archive.IsSaving(), Archive, RotationMode	, TAG_Status_RotationMode_ViewDirection.GetTag(), Map);
-	NetSerializeOptionalValue(Archive.IsSaving(), Archive, Stance		, TAG_Status_Stance_Standing.GetTag()			, Map);
-	NetSerializeOptionalValue(Archive.IsSaving(), Archive, Gait			, TAG_Status_Gait_Walking.GetTag()				, Map);
+	const auto* LocomotionComponent{ Cast<ULocomotionComponent>(&Movement) };
+	const auto LocalNumBits{ LocomotionComponent ? static_cast<uint32>(LocomotionComponent->GetPackedLocomotionStatesBits()) : 0u };
+
+	// The new move is serialized first, so the other moves can refer to it
+
+	if (MoveType != ENetworkMoveType::NewMove)
+	{
+		const auto* NewMoveData{ static_cast<const FLocomotionNetworkMoveData*>(Movement.GetNetworkMoveDataContainer().GetNewMoveData()) };
+
+		auto bSameAsNewMove
+		{
+			NewMoveData && (NewMoveData != this) &&
+			(NewMoveData->PackedStates == PackedStates) && (NewMoveData->PackedDesiredStates == PackedDesiredStates)
+		};
+
+		Archive.SerializeBits(&bSameAsNewMove, 1);
+
+		if (bSameAsNewMove)
+		{
+			if (Archive.IsLoading())
+			{
+				PackedStates = NewMoveData->PackedStates;
+				PackedDesiredStates = NewMoveData->PackedDesiredStates;
+				bHasPackedStates = NewMoveData->bHasPackedStates;
+			}
+
+			return !Archive.IsError();
+		}
+	}
+
+	// The bit width is sent with the states so that the stream can be read even if LocomotionData of both sides differ
+
+	auto NumBits{ LocalNumBits };
+	Archive.SerializeBits(&NumBits, PackedStatesWidthBits);
+
+	if (NumBits > 32)
+	{
+		Archive.SetError();
+		return false;
+	}
+
+	if (Archive.IsLoading())
+	{
+		PackedStates = 0;
+		PackedDesiredStates = 0;
+		bHasPackedStates = (NumBits > 0) && (NumBits == LocalNumBits);
+	}
+
+	if (NumBits > 0)
+	{
+		Archive.SerializeBits(&PackedStates, NumBits);
+
+		// The desired states are usually the same as the current states, so only one bit is sent in that case
+
+		auto bDesiredSameAsCurrent{ PackedDesiredStates == PackedStates };
+		Archive.SerializeBits(&bDesiredSameAsCurrent, 1);
+
+		if (bDesiredSameAsCurrent)
+		{
+			PackedDesiredStates = PackedStates;
+		}
+		else
+		{
+			Archive.SerializeBits(&PackedDesiredStates, NumBits);
+		}
+	}
 
 	return !Archive.IsError();
 }
@@ -67,29 +126,24 @@ FLocomotionNetworkMoveDataContainer::FLocomotionNetworkMoveDataContainer()
 
 FLocomotionSavedMove::FLocomotionSavedMove()
 {
-	RotationMode	= TAG_Status_RotationMode_ViewDirection;
-	Stance			= TAG_Status_Stance_Standing;
-	Gait			= TAG_Status_Gait_Walking;
 }
 
 void FLocomotionSavedMove::Clear()
 {
 	Super::Clear();
 
-	RotationMode	= TAG_Status_RotationMode_ViewDirection;
-	Stance			= TAG_Status_Stance_Standing;
-	Gait			= TAG_Status_Gait_Walking;
+	PackedStates = 0;
+	PackedDesiredStates = 0;
 }
 
 void FLocomotionSavedMove::SetMoveFor(ACharacter* Character, float NewDeltaTime, const FVector& NewAcceleration, FNetworkPredictionData_Client_Character& PredictionData)
 {
 	Super::SetMoveFor(Character, NewDeltaTime, NewAcceleration, PredictionData);
 
-	if (const auto* Movement{ Cast<ULocomotionComponent>(Character->GetCharacterMovement()) })
+	if (auto* Movement{ Cast<ULocomotionComponent>(Character->GetCharacterMovement()) })
 	{
-		RotationMode	= Movement->RotationMode;
-		Stance			= Movement->Stance;
-		Gait			= Movement->Gait;
+		PackedStates = Movement->PackLocomotionStates();
+		PackedDesiredStates = Movement->PackDesiredLocomotionStates();
 	}
 }
 
@@ -97,7 +151,7 @@ bool FLocomotionSavedMove::CanCombineWith(const FSavedMovePtr& NewMovePtr, AChar
 {
 	const auto* NewMove{ static_cast<FLocomotionSavedMove*>(NewMovePtr.Get()) };
 
-	return (RotationMode == NewMove->RotationMode) && (Stance == NewMove->Stance) && (Gait == NewMove->Gait) && Super::CanCombineWith(NewMovePtr, Character, MaxDelta);
+	return (PackedStates == NewMove->PackedStates) && (PackedDesiredStates == NewMove->PackedDesiredStates) && Super::CanCombineWith(NewMovePtr, Character, MaxDelta);
 }
 
 void FLocomotionSavedMove::CombineWith(const FSavedMove_Character* PreviousMove, ACharacter* Character, APlayerController* Player, const FVector& PreviousStartLocation)
@@ -122,9 +176,7 @@ void FLocomotionSavedMove::PrepMoveFor(ACharacter* Character)
 
 	if (auto* Movement{ Cast<ULocomotionComponent>(Character->GetCharacterMovement()) })
 	{
-		Movement->RotationMode	= RotationMode;
-		Movement->Stance		= Stance;
-		Movement->Gait			= Gait;
+		Movement->UnpackLocomotionStates(PackedStates);
 
 		Movement->RefreshGaitConfigs();
 	}
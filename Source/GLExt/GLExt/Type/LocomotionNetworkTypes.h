@@ -4,11 +4,14 @@
 
 #include "GameFramework/CharacterMovementComponent.h"
 
-#include "GameplayTagContainer.h"
-
 
 /**
  * FLocomotionNetworkMoveData
+ * 
+ * Note:
+ *	Serialize() writes into the bit payload of ServerMovePacked (FCharacterNetworkSerializationPackedBits).
+ *	Iris sends that payload as an opaque bit array with the engine's serializer, so the move data has no NetSerializer of its own
+ *	and its size is the same with and without Iris.
  */
 class FLocomotionNetworkMoveData : public FCharacterNetworkMoveData
 {
@@ -19,9 +22,35 @@ public:
 	FLocomotionNetworkMoveData();
 
 public:
-	FGameplayTag RotationMode;
-	FGameplayTag Stance;
-	FGameplayTag Gait;
+	//
+	// RotationMode, Stance and Gait packed by ULocomotionComponent::PackLocomotionStates()
+	// 
+	// Tips:
+	//	Pending and old moves only send one bit when their states are the same as the new move in the same packet.
+	//
+	uint32 PackedStates{ 0 };
+
+	//
+	// DesiredRotationMode, DesiredStance and DesiredGait packed by ULocomotionComponent::PackDesiredLocomotionStates()
+	// 
+	// Tips:
+	//	Applied by the server in ULocomotionComponent::MoveAutonomous() instead of reliable RPCs.
+	//
+	uint32 PackedDesiredStates{ 0 };
+
+	//
+	// Whether PackedStates and PackedDesiredStates were packed in the same layout as the LocomotionData of this side
+	// 
+	// Tips:
+	//	LocomotionData is not replicated, so the client and the server may use different data for a while.
+	//	The received states are not applied in that case.
+	//
+	bool bHasPackedStates{ false };
+
+	//
+	// Number of bits used to send the bit width of the packed states
+	//
+	static constexpr int32 PackedStatesWidthBits{ 6 };
 
 public:
 	virtual void ClientFillNetworkMoveData(const FSavedMove_Character& Move, ENetworkMoveType MoveType) override;
@@ -56,9 +85,15 @@ public:
 	FLocomotionSavedMove();
 
 public:
-	FGameplayTag RotationMode;
-	FGameplayTag Stance;
-	FGameplayTag Gait;
+	//
+	// RotationMode, Stance and Gait packed by ULocomotionComponent::PackLocomotionStates()
+	//
+	uint32 PackedStates{ 0 };
+
+	//
+	// DesiredRotationMode, DesiredStance and DesiredGait packed by ULocomotionComponent::PackDesiredLocomotionStates()
+	//
+	uint32 PackedDesiredStates{ 0 };
 
 public:
 	virtual void Clear() override;
@@ -0,0 +1,299 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionReplicatedIntent.h"
+
+#include "Misc/AutomationTest.h"
+#include "UObject/CoreNet.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionReplicatedIntent)
+
+
+/**
+ * Last state of FLocomotionReplicatedIntent sent to a connection by NetDeltaSerialize()
+ */
+class FLocomotionReplicatedIntentDeltaState : public INetDeltaBaseState
+{
+public:
+	FLocomotionReplicatedIntentDeltaState() {}
+
+public:
+	FLocomotionQuantizedIntent Quantized;
+
+public:
+	virtual bool IsStateEqual(INetDeltaBaseState* OtherState) override
+	{
+		return Quantized == static_cast<FLocomotionReplicatedIntentDeltaState*>(OtherState)->Quantized;
+	}
+
+};
+
+
+FLocomotionQuantizedIntent FLocomotionReplicatedIntent::Quantize() const
+{
+	FLocomotionQuantizedIntent Result;
+
+	Result.ViewPitch = FRotator::CompressAxisToShort(ViewRotation.Pitch);
+	Result.ViewYaw = FRotator::CompressAxisToShort(ViewRotation.Yaw);
+
+	Result.bHasInput = !InputDirection.IsNearlyZero();
+
+	if (Result.bHasInput)
+	{
+		Result.InputYaw = FRotator::CompressAxisToByte(FMath::RadiansToDegrees(FMath::Atan2(InputDirection.Y, InputDirection.X)));
+		Result.InputZ = static_cast<int8>(FMath::Clamp(FMath::RoundToInt(InputDirection.Z * 127.0), -127, 127));
+	}
+
+	Result.VelocityYaw = FRotator::CompressAxisToByte(VelocityYawAngle);
+
+	return Result;
+}
+
+void FLocomotionReplicatedIntent::Dequantize(const FLocomotionQuantizedIntent& Quantized)
+{
+	ViewRotation.Pitch = FRotator::NormalizeAxis(FRotator::DecompressAxisFromShort(Quantized.ViewPitch));
+	ViewRotation.Yaw = FRotator::NormalizeAxis(FRotator::DecompressAxisFromShort(Quantized.ViewYaw));
+	ViewRotation.Roll = 0.0;
+
+	if (Quantized.bHasInput)
+	{
+		const auto Z{ Quantized.InputZ / 127.0 };
+		const auto Horizontal{ FMath::Sqrt(FMath::Max(0.0, 1.0 - Z * Z)) };
+
+		double Sin, Cos;
+		FMath::SinCos(&Sin, &Cos, FMath::DegreesToRadians(FRotator::DecompressAxisFromByte(Quantized.InputYaw)));
+
+		InputDirection = FVector(Cos * Horizontal, Sin * Horizontal, Z);
+	}
+	else
+	{
+		InputDirection = FVector::ZeroVector;
+	}
+
+	VelocityYawAngle = UE_REAL_TO_FLOAT(FRotator::NormalizeAxis(FRotator::DecompressAxisFromByte(Quantized.VelocityYaw)));
+}
+
+void FLocomotionReplicatedIntent::SerializeChangedFields(FArchive& Ar, const FLocomotionQuantizedIntent& Base)
+{
+	auto Quantized{ Quantize() };
+
+	auto bViewChanged{ !Quantized.IsViewEqual(Base) };
+	auto bInputChanged{ !Quantized.IsInputEqual(Base) };
+	auto bVelocityYawChanged{ !Quantized.IsVelocityYawEqual(Base) };
+
+	Ar.SerializeBits(&bViewChanged, 1);
+	Ar.SerializeBits(&bInputChanged, 1);
+	Ar.SerializeBits(&bVelocityYawChanged, 1);
+
+	// View
+
+	if (bViewChanged)
+	{
+		Ar << Quantized.ViewPitch;
+		Ar << Quantized.ViewYaw;
+	}
+
+	// Input
+
+	if (bInputChanged)
+	{
+		auto bHasInput{ Quantized.bHasInput != 0 };
+		Ar.SerializeBits(&bHasInput, 1);
+
+		Quantized.bHasInput = bHasInput ? 1 : 0;
+
+		if (bHasInput)
+		{
+			Ar << Quantized.InputYaw;
+			Ar << Quantized.InputZ;
+		}
+	}
+
+	// Velocity yaw
+
+	if (bVelocityYawChanged)
+	{
+		Ar << Quantized.VelocityYaw;
+	}
+
+	// Only apply the fields that were received so that the others keep their full precision
+
+	if (Ar.IsLoading() && !Ar.IsError())
+	{
+		FLocomotionReplicatedIntent Received;
+		Received.Dequantize(Quantized);
+
+		if (bViewChanged)
+		{
+			ViewRotation = Received.ViewRotation;
+		}
+
+		if (bInputChanged)
+		{
+			InputDirection = Received.InputDirection;
+		}
+
+		if (bVelocityYawChanged)
+		{
+			VelocityYawAngle = Received.VelocityYawAngle;
+		}
+	}
+}
+
+bool FLocomotionReplicatedIntent::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	if (Ar.IsLoading())
+	{
+		*this = FLocomotionReplicatedIntent();
+	}
+
+	SerializeChangedFields(Ar, FLocomotionQuantizedIntent());
+
+	bOutSuccess = !Ar.IsError();
+
+	return true;
+}
+
+bool FLocomotionReplicatedIntent::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	if (DeltaParms.Writer)
+	{
+		const auto* OldState{ static_cast<const FLocomotionReplicatedIntentDeltaState*>(DeltaParms.OldState) };
+		const auto Quantized{ Quantize() };
+
+		if (OldState && (OldState->Quantized == Quantized))
+		{
+			return false;
+		}
+
+		auto NewState{ MakeShared<FLocomotionReplicatedIntentDeltaState>() };
+		NewState->Quantized = Quantized;
+
+		SerializeChangedFields(*DeltaParms.Writer, OldState ? OldState->Quantized : FLocomotionQuantizedIntent());
+
+		*DeltaParms.NewState = NewState;
+
+		return true;
+	}
+
+	if (DeltaParms.Reader)
+	{
+		// The base is only used when saving
+
+		SerializeChangedFields(*DeltaParms.Reader, FLocomotionQuantizedIntent());
+
+		return !DeltaParms.Reader->IsError();
+	}
+
+	return true;
+}
+
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLocomotionReplicatedIntentSerializeTest, "GLExt.Net.ReplicatedIntentSerialize", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLocomotionReplicatedIntentSerializeTest::RunTest(const FString& Parameters)
+{
+	typedef FLocomotionQuantizedIntent QuantizedType;
+
+	static constexpr int64 ChangeBits{ 3 };
+	static constexpr int64 InputBits{ QuantizedType::InputBits };
+	static constexpr int64 NoInputBits{ 1 };
+
+	FLocomotionReplicatedIntent Idle;
+
+	FLocomotionReplicatedIntent Looking;
+	Looking.ViewRotation = FRotator(10.0, 45.0, 0.0);
+
+	FLocomotionReplicatedIntent Moving{ Looking };
+	Moving.InputDirection = FVector(0.0, 1.0, 0.0);
+	Moving.VelocityYawAngle = 90.0f;
+
+	FLocomotionReplicatedIntent Stopped{ Moving };
+	Stopped.InputDirection = FVector::ZeroVector;
+
+	const auto TestNetSerialize
+	{
+		[this, &Stopped](const TCHAR* What, const FLocomotionReplicatedIntent& Intent, int64 ExpectedBits)
+		{
+			auto Copy{ Intent };
+			auto bSuccess{ true };
+
+			FNetBitWriter Writer{ nullptr, 256 };
+			Copy.NetSerialize(Writer, nullptr, bSuccess);
+
+			FNetBitReader Reader{ nullptr, Writer.GetData(), Writer.GetNumBits() };
+
+			FLocomotionReplicatedIntent Result{ Stopped };
+			Result.NetSerialize(Reader, nullptr, bSuccess);
+
+			TestEqual(FString::Printf(TEXT("NetSerialize() bits of %s"), What), Writer.GetNumBits(), ExpectedBits);
+			TestTrue(FString::Printf(TEXT("NetSerialize() round trip of %s"), What), bSuccess && (Result == Intent));
+		}
+	};
+
+	// Against the default intent
+
+	TestNetSerialize(TEXT("idle"), Idle, ChangeBits);
+	TestNetSerialize(TEXT("looking"), Looking, ChangeBits + QuantizedType::ViewBits);
+	TestNetSerialize(TEXT("moving"), Moving, ChangeBits + QuantizedType::ViewBits + InputBits + QuantizedType::VelocityYawBits);
+	TestNetSerialize(TEXT("stopped"), Stopped, ChangeBits + QuantizedType::ViewBits + QuantizedType::VelocityYawBits);
+
+	// Against the last state sent to the connection
+
+	TSharedPtr<INetDeltaBaseState> SentState;
+	FLocomotionReplicatedIntent ReceivedIntent;
+
+	const auto TestNetDeltaSerialize
+	{
+		[this, &SentState, &ReceivedIntent](const TCHAR* What, const FLocomotionReplicatedIntent& Intent, int64 ExpectedBits)
+		{
+			auto Copy{ Intent };
+
+			FNetBitWriter Writer{ nullptr, 256 };
+			TSharedPtr<INetDeltaBaseState> NewState;
+
+			FNetDeltaSerializeInfo WriteParms;
+			WriteParms.Writer = &Writer;
+			WriteParms.OldState = SentState.Get();
+			WriteParms.NewState = &NewState;
+
+			const auto bSent{ Copy.NetDeltaSerialize(WriteParms) };
+
+			TestEqual(FString::Printf(TEXT("NetDeltaSerialize() bits of %s"), What), Writer.GetNumBits(), ExpectedBits);
+
+			if (!bSent)
+			{
+				TestEqual(FString::Printf(TEXT("NetDeltaSerialize() skips unchanged %s"), What), ExpectedBits, 0ll);
+				return;
+			}
+
+			SentState = NewState;
+
+			FNetBitReader Reader{ nullptr, Writer.GetData(), Writer.GetNumBits() };
+
+			FNetDeltaSerializeInfo ReadParms;
+			ReadParms.Reader = &Reader;
+
+			TestTrue(FString::Printf(TEXT("NetDeltaSerialize() round trip of %s"), What), ReceivedIntent.NetDeltaSerialize(ReadParms) && (ReceivedIntent == Intent));
+		}
+	};
+
+	TestNetDeltaSerialize(TEXT("idle"), Idle, ChangeBits);
+	TestNetDeltaSerialize(TEXT("idle"), Idle, 0);
+	TestNetDeltaSerialize(TEXT("looking"), Looking, ChangeBits + QuantizedType::ViewBits);
+	TestNetDeltaSerialize(TEXT("moving"), Moving, ChangeBits + InputBits + QuantizedType::VelocityYawBits);
+	TestNetDeltaSerialize(TEXT("stopped"), Stopped, ChangeBits + NoInputBits);
+
+	// Changes smaller than the quantization are not sent
+
+	auto Jittered{ Stopped };
+	Jittered.ViewRotation.Yaw += 0.0001;
+
+	TestTrue(TEXT("Intents equal after quantization compare equal"), Jittered == Stopped);
+	TestNetDeltaSerialize(TEXT("jittered"), Jittered, 0);
+
+	return true;
+}
+
+#endif
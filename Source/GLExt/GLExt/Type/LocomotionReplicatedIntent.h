@@ -0,0 +1,161 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Engine/NetSerialization.h"
+
+#include "LocomotionReplicatedIntent.generated.h"
+
+
+/**
+ * Quantized form of FLocomotionReplicatedIntent
+ *
+ * Tips:
+ *	Shared by every replication path so that simulated proxies receive the same values regardless of the replication system.
+ */
+struct GLEXT_API FLocomotionQuantizedIntent
+{
+public:
+	//
+	// Pitch and yaw of the view rotation compressed to 16 bits each
+	//
+	uint16 ViewPitch{ 0 };
+	uint16 ViewYaw{ 0 };
+
+	//
+	// Yaw of the input direction compressed to 8 bits and its Z component in [-127, 127]
+	//
+	uint8 InputYaw{ 0 };
+	int8 InputZ{ 0 };
+
+	//
+	// Whether there is an input direction or not
+	//
+	uint8 bHasInput{ 0 };
+
+	//
+	// Yaw of the desired velocity compressed to 8 bits
+	//
+	uint8 VelocityYaw{ 0 };
+
+public:
+	//
+	// Number of bits written for each field
+	//
+	static constexpr uint32 ViewBits{ 32 };
+	static constexpr uint32 InputBits{ 17 };
+	static constexpr uint32 VelocityYawBits{ 8 };
+
+	bool IsViewEqual(const FLocomotionQuantizedIntent& Other) const { return (ViewPitch == Other.ViewPitch) && (ViewYaw == Other.ViewYaw); }
+	bool IsInputEqual(const FLocomotionQuantizedIntent& Other) const { return (bHasInput == Other.bHasInput) && (!bHasInput || ((InputYaw == Other.InputYaw) && (InputZ == Other.InputZ))); }
+	bool IsVelocityYawEqual(const FLocomotionQuantizedIntent& Other) const { return VelocityYaw == Other.VelocityYaw; }
+
+	bool operator==(const FLocomotionQuantizedIntent& Other) const { return IsViewEqual(Other) && IsInputEqual(Other) && IsVelocityYawEqual(Other); }
+	bool operator!=(const FLocomotionQuantizedIntent& Other) const { return !(*this == Other); }
+
+	/**
+	 * Pack the input fields into InputBits bits
+	 */
+	uint32 PackInput() const { return bHasInput ? (1u | (static_cast<uint32>(InputYaw) << 1) | (static_cast<uint32>(static_cast<uint8>(InputZ)) << 9)) : 0u; }
+
+	/**
+	 * Unpack the input fields packed by PackInput()
+	 */
+	void UnpackInput(uint32 Packed)
+	{
+		bHasInput = static_cast<uint8>(Packed & 1u);
+		InputYaw = bHasInput ? static_cast<uint8>(Packed >> 1) : 0;
+		InputZ = bHasInput ? static_cast<int8>(static_cast<uint8>(Packed >> 9)) : 0;
+	}
+
+};
+
+
+/**
+ * Intent of the character replicated to simulated proxies
+ * 
+ * Tips:
+ *	View rotation, input direction and desired velocity yaw angle are replicated as one property
+ *	so that they share a single property header and can be quantized together.
+ * 
+ *	Iris uses FLocomotionReplicatedIntentNetSerializer, and the generic replication system uses NetDeltaSerialize().
+ */
+USTRUCT(BlueprintType)
+struct GLEXT_API FLocomotionReplicatedIntent
+{
+	GENERATED_BODY()
+public:
+	FLocomotionReplicatedIntent() {}
+
+public:
+	//
+	// Raw viewpoint rotation (roll is not replicated)
+	//
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	FRotator ViewRotation{ ForceInit };
+
+	//
+	// Normalized direction of the input
+	//
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	FVector_NetQuantizeNormal InputDirection{ FVector::ZeroVector };
+
+	//
+	// Direction angle of the desired velocity
+	//
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Meta = (ClampMin = -180, ClampMax = 180, ForceUnits = "deg"))
+	float VelocityYawAngle{ 0.0f };
+
+public:
+	/**
+	 * Convert to the quantized form
+	 */
+	FLocomotionQuantizedIntent Quantize() const;
+
+	/**
+	 * Convert from the quantized form
+	 */
+	void Dequantize(const FLocomotionQuantizedIntent& Quantized);
+
+	/**
+	 * Serialize the quantized fields that differ from the base, each preceded by one change bit
+	 * 
+	 * Tips:
+	 *	Uses the same layout as the delta serialization of FLocomotionReplicatedIntentNetSerializer.
+	 *	When loading, the fields that were not written keep their current value.
+	 */
+	void SerializeChangedFields(FArchive& Ar, const FLocomotionQuantizedIntent& Base);
+
+	/**
+	 * Serialize the quantized form against the default intent
+	 */
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+	/**
+	 * Serialize the quantized form against the last state sent to the connection for the generic replication system
+	 * 
+	 * Tips:
+	 *	Nothing is sent while the quantized form is the same as the last sent state.
+	 */
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+
+	/**
+	 * Compares the quantized forms, so that changes smaller than the quantization do not mark the property as changed
+	 */
+	bool operator==(const FLocomotionReplicatedIntent& Other) const { return Quantize() == Other.Quantize(); }
+
+	bool operator!=(const FLocomotionReplicatedIntent& Other) const { return !(*this == Other); }
+
+};
+
+template<>
+struct TStructOpsTypeTraits<FLocomotionReplicatedIntent> : public TStructOpsTypeTraitsBase2<FLocomotionReplicatedIntent>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithNetSharedSerialization = true,
+		WithNetDeltaSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
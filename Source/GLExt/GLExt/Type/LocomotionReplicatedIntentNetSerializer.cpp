@@ -0,0 +1,383 @@
+﻿// Copyright (C) 2024 owoDra
+
+#include "LocomotionReplicatedIntentNetSerializer.h"
+
+#include "Type/LocomotionReplicatedIntent.h"
+
+#if UE_WITH_IRIS
+#include "Iris/Serialization/NetBitStreamReader.h"
+#include "Iris/Serialization/NetBitStreamWriter.h"
+#include "Iris/Serialization/NetSerializationContext.h"
+#include "Iris/Serialization/NetSerializerDelegates.h"
+#include "Iris/ReplicationState/PropertyNetSerializerInfoRegistry.h"
+#endif
+
+#if UE_WITH_IRIS && WITH_DEV_AUTOMATION_TESTS
+#include "Misc/AutomationTest.h"
+#include "UObject/CoreNet.h"
+#endif
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LocomotionReplicatedIntentNetSerializer)
+
+
+#if UE_WITH_IRIS
+
+namespace UE::Net
+{
+	/**
+	 * Iris NetSerializer of FLocomotionReplicatedIntent
+	 * 
+	 * Tips:
+	 *	Uses the quantization of FLocomotionQuantizedIntent,
+	 *	and the delta serialization only writes the fields that changed from the previous state with one bit per field.
+	 */
+	struct FLocomotionReplicatedIntentNetSerializer
+	{
+	public:
+		static const uint32 Version{ 0 };
+
+		static constexpr bool bUseDefaultDelta{ false };
+
+		typedef FLocomotionReplicatedIntent SourceType;
+		typedef FLocomotionQuantizedIntent QuantizedType;
+		typedef FLocomotionReplicatedIntentNetSerializerConfig ConfigType;
+
+		static const ConfigType DefaultConfig;
+
+	public:
+		static void Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args);
+		static void Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args);
+
+		static void SerializeDelta(FNetSerializationContext& Context, const FNetSerializeDeltaArgs& Args);
+		static void DeserializeDelta(FNetSerializationContext& Context, const FNetDeserializeDeltaArgs& Args);
+
+		static void Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args);
+		static void Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args);
+
+		static bool IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args);
+		static bool Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args);
+
+	private:
+		static void WriteFields(FNetBitStreamWriter& Writer, const QuantizedType& Value, bool bView, bool bInput, bool bVelocityYaw);
+		static void ReadFields(FNetBitStreamReader& Reader, QuantizedType& Value, bool bView, bool bInput, bool bVelocityYaw);
+
+	private:
+		class FNetSerializerRegistryDelegates final : private UE::Net::FNetSerializerRegistryDelegates
+		{
+		public:
+			virtual ~FNetSerializerRegistryDelegates();
+
+		private:
+			virtual void OnPreFreezeNetSerializerRegistry() override;
+		};
+
+		static FLocomotionReplicatedIntentNetSerializer::FNetSerializerRegistryDelegates NetSerializerRegistryDelegates;
+
+	};
+
+	UE_NET_IMPLEMENT_SERIALIZER(FLocomotionReplicatedIntentNetSerializer);
+
+	const FLocomotionReplicatedIntentNetSerializer::ConfigType FLocomotionReplicatedIntentNetSerializer::DefaultConfig;
+	FLocomotionReplicatedIntentNetSerializer::FNetSerializerRegistryDelegates FLocomotionReplicatedIntentNetSerializer::NetSerializerRegistryDelegates;
+
+
+	void FLocomotionReplicatedIntentNetSerializer::WriteFields(FNetBitStreamWriter& Writer, const QuantizedType& Value, bool bView, bool bInput, bool bVelocityYaw)
+	{
+		if (bView)
+		{
+			Writer.WriteBits(Value.ViewPitch, 16);
+			Writer.WriteBits(Value.ViewYaw, 16);
+		}
+
+		if (bInput)
+		{
+			Writer.WriteBits(Value.PackInput(), Value.bHasInput ? QuantizedType::InputBits : 1);
+		}
+
+		if (bVelocityYaw)
+		{
+			Writer.WriteBits(Value.VelocityYaw, QuantizedType::VelocityYawBits);
+		}
+	}
+
+	void FLocomotionReplicatedIntentNetSerializer::ReadFields(FNetBitStreamReader& Reader, QuantizedType& Value, bool bView, bool bInput, bool bVelocityYaw)
+	{
+		if (bView)
+		{
+			Value.ViewPitch = static_cast<uint16>(Reader.ReadBits(16));
+			Value.ViewYaw = static_cast<uint16>(Reader.ReadBits(16));
+		}
+
+		if (bInput)
+		{
+			const auto bHasInput{ Reader.ReadBits(1) };
+
+			Value.UnpackInput(bHasInput ? (bHasInput | (Reader.ReadBits(QuantizedType::InputBits - 1) << 1)) : 0u);
+		}
+
+		if (bVelocityYaw)
+		{
+			Value.VelocityYaw = static_cast<uint8>(Reader.ReadBits(QuantizedType::VelocityYawBits));
+		}
+	}
+
+	void FLocomotionReplicatedIntentNetSerializer::Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args)
+	{
+		const auto& Value{ *reinterpret_cast<const QuantizedType*>(Args.Source) };
+
+		WriteFields(*Context.GetBitStreamWriter(), Value, true, true, true);
+	}
+
+	void FLocomotionReplicatedIntentNetSerializer::Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args)
+	{
+		auto& Value{ *reinterpret_cast<QuantizedType*>(Args.Target) };
+
+		ReadFields(*Context.GetBitStreamReader(), Value, true, true, true);
+	}
+
+	void FLocomotionReplicatedIntentNetSerializer::SerializeDelta(FNetSerializationContext& Context, const FNetSerializeDeltaArgs& Args)
+	{
+		const auto& Value{ *reinterpret_cast<const QuantizedType*>(Args.Source) };
+		const auto& PrevValue{ *reinterpret_cast<const QuantizedType*>(Args.Prev) };
+
+		auto* Writer{ Context.GetBitStreamWriter() };
+
+		const auto bView{ !Value.IsViewEqual(PrevValue) };
+		const auto bInput{ !Value.IsInputEqual(PrevValue) };
+		const auto bVelocityYaw{ !Value.IsVelocityYawEqual(PrevValue) };
+
+		Writer->WriteBits((bView ? 1u : 0u) | (bInput ? 2u : 0u) | (bVelocityYaw ? 4u : 0u), 3);
+
+		WriteFields(*Writer, Value, bView, bInput, bVelocityYaw);
+	}
+
+	void FLocomotionReplicatedIntentNetSerializer::DeserializeDelta(FNetSerializationContext& Context, const FNetDeserializeDeltaArgs& Args)
+	{
+		auto& Value{ *reinterpret_cast<QuantizedType*>(Args.Target) };
+		const auto& PrevValue{ *reinterpret_cast<const QuantizedType*>(Args.Prev) };
+
+		auto* Reader{ Context.GetBitStreamReader() };
+
+		const auto ChangedBits{ Reader->ReadBits(3) };
+
+		Value = PrevValue;
+
+		ReadFields(*Reader, Value, (ChangedBits & 1u) != 0, (ChangedBits & 2u) != 0, (ChangedBits & 4u) != 0);
+	}
+
+	void FLocomotionReplicatedIntentNetSerializer::Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args)
+	{
+		const auto& Source{ *reinterpret_cast<const SourceType*>(Args.Source) };
+		auto& Target{ *reinterpret_cast<QuantizedType*>(Args.Target) };
+
+		Target = Source.Quantize();
+	}
+
+	void FLocomotionReplicatedIntentNetSerializer::Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args)
+	{
+		const auto& Source{ *reinterpret_cast<const QuantizedType*>(Args.Source) };
+		auto& Target{ *reinterpret_cast<SourceType*>(Args.Target) };
+
+		Target.Dequantize(Source);
+	}
+
+	bool FLocomotionReplicatedIntentNetSerializer::IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args)
+	{
+		if (Args.bStateIsQuantized)
+		{
+			return *reinterpret_cast<const QuantizedType*>(Args.Source0) == *reinterpret_cast<const QuantizedType*>(Args.Source1);
+		}
+
+		// Compare in the quantized form so that changes below the precision are not replicated
+
+		return reinterpret_cast<const SourceType*>(Args.Source0)->Quantize() == reinterpret_cast<const SourceType*>(Args.Source1)->Quantize();
+	}
+
+	bool FLocomotionReplicatedIntentNetSerializer::Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args)
+	{
+		const auto& Source{ *reinterpret_cast<const SourceType*>(Args.Source) };
+
+		return !Source.ViewRotation.ContainsNaN() && !Source.InputDirection.ContainsNaN() && FMath::IsFinite(Source.VelocityYawAngle);
+	}
+
+
+	static const FName PropertyNetSerializerRegistry_NAME_LocomotionReplicatedIntent("LocomotionReplicatedIntent");
+	UE_NET_IMPLEMENT_NAMED_STRUCT_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_LocomotionReplicatedIntent, FLocomotionReplicatedIntentNetSerializer);
+
+	FLocomotionReplicatedIntentNetSerializer::FNetSerializerRegistryDelegates::~FNetSerializerRegistryDelegates()
+	{
+		UE_NET_UNREGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_LocomotionReplicatedIntent);
+	}
+
+	void FLocomotionReplicatedIntentNetSerializer::FNetSerializerRegistryDelegates::OnPreFreezeNetSerializerRegistry()
+	{
+		UE_NET_REGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_LocomotionReplicatedIntent);
+	}
+}
+
+#endif
+
+
+#if UE_WITH_IRIS && WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLocomotionReplicatedIntentNetSerializerTest, "GLExt.Net.ReplicatedIntentNetSerializer", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLocomotionReplicatedIntentNetSerializerTest::RunTest(const FString& Parameters)
+{
+	using namespace UE::Net;
+
+	typedef FLocomotionReplicatedIntentNetSerializer SerializerType;
+	typedef SerializerType::QuantizedType QuantizedType;
+
+	static constexpr auto NumUpdates{ 600 };
+
+	int64 FullBits{ 0 };
+	int64 DeltaBits{ 0 };
+	int64 LegacyBits{ 0 };
+
+	FLocomotionReplicatedIntent PrevIntent;
+	QuantizedType PrevQuantized{ PrevIntent.Quantize() };
+
+	for (auto Update{ 1 }; Update <= NumUpdates; ++Update)
+	{
+		// A character turning its view continuously, stopping and starting to move every second at 60 updates per second
+
+		const auto bMoving{ (Update / 60) % 2 == 0 };
+		const auto MoveYaw{ FRotator::NormalizeAxis(Update * 0.5) };
+
+		FLocomotionReplicatedIntent Intent;
+		Intent.ViewRotation = FRotator(FMath::Sin(Update * 0.05) * 20.0, FRotator::NormalizeAxis(Update * 1.5), 0.0);
+		Intent.InputDirection = bMoving ? FRotator(0.0, MoveYaw, 0.0).Vector() : FVector::ZeroVector;
+		Intent.VelocityYawAngle = bMoving ? UE_REAL_TO_FLOAT(MoveYaw) : PrevIntent.VelocityYawAngle;
+
+		const auto Quantized{ Intent.Quantize() };
+
+		// Quantize() and Dequantize() are stable
+
+		FLocomotionReplicatedIntent Dequantized;
+		Dequantized.Dequantize(Quantized);
+
+		if (!TestTrue(TEXT("Dequantized intent quantizes to the same value"), Dequantized.Quantize() == Quantized))
+		{
+			return false;
+		}
+
+		// Full state
+
+		{
+			uint8 Buffer[64]{ 0 };
+
+			FNetBitStreamWriter Writer;
+			Writer.InitBytes(Buffer, sizeof(Buffer));
+
+			FNetSerializationContext WriteContext(&Writer);
+
+			FNetSerializeArgs Args;
+			Args.NetSerializerConfig = &SerializerType::DefaultConfig;
+			Args.Source = NetSerializerValuePointer(&Quantized);
+
+			SerializerType::Serialize(WriteContext, Args);
+			Writer.CommitWrites();
+
+			const auto NumBits{ Writer.GetPosBits() };
+
+			FNetBitStreamReader Reader;
+			Reader.InitBits(Buffer, NumBits);
+
+			FNetSerializationContext ReadContext(&Reader);
+
+			QuantizedType Result;
+
+			FNetDeserializeArgs ReadArgs;
+			ReadArgs.NetSerializerConfig = &SerializerType::DefaultConfig;
+			ReadArgs.Target = NetSerializerValuePointer(&Result);
+
+			SerializerType::Deserialize(ReadContext, ReadArgs);
+
+			if (!TestTrue(TEXT("Serialize() round trip"), (Result == Quantized) && !Reader.IsOverflown() && (Reader.GetPosBits() == NumBits)))
+			{
+				return false;
+			}
+
+			FullBits += NumBits;
+		}
+
+		// Delta against the previous state
+
+		{
+			uint8 Buffer[64]{ 0 };
+
+			FNetBitStreamWriter Writer;
+			Writer.InitBytes(Buffer, sizeof(Buffer));
+
+			FNetSerializationContext WriteContext(&Writer);
+
+			FNetSerializeDeltaArgs Args;
+			Args.NetSerializerConfig = &SerializerType::DefaultConfig;
+			Args.Source = NetSerializerValuePointer(&Quantized);
+			Args.Prev = NetSerializerValuePointer(&PrevQuantized);
+
+			SerializerType::SerializeDelta(WriteContext, Args);
+			Writer.CommitWrites();
+
+			const auto NumBits{ Writer.GetPosBits() };
+
+			FNetBitStreamReader Reader;
+			Reader.InitBits(Buffer, NumBits);
+
+			FNetSerializationContext ReadContext(&Reader);
+
+			QuantizedType Result;
+
+			FNetDeserializeDeltaArgs ReadArgs;
+			ReadArgs.NetSerializerConfig = &SerializerType::DefaultConfig;
+			ReadArgs.Target = NetSerializerValuePointer(&Result);
+			ReadArgs.Prev = NetSerializerValuePointer(&PrevQuantized);
+
+			SerializerType::DeserializeDelta(ReadContext, ReadArgs);
+
+			if (!TestTrue(TEXT("SerializeDelta() round trip"), (Result == Quantized) && !Reader.IsOverflown() && (Reader.GetPosBits() == NumBits)))
+			{
+				return false;
+			}
+
+			DeltaBits += NumBits;
+		}
+
+		// The three properties replaced by the intent, each sent only when it changed (property headers are not included)
+
+		{
+			auto bSuccess{ true };
+			FNetBitWriter Writer{ nullptr, 256 };
+
+			if (Intent.ViewRotation != PrevIntent.ViewRotation)
+			{
+				Intent.ViewRotation.NetSerialize(Writer, nullptr, bSuccess);
+			}
+
+			if (Intent.InputDirection != PrevIntent.InputDirection)
+			{
+				Intent.InputDirection.NetSerialize(Writer, nullptr, bSuccess);
+			}
+
+			if (Intent.VelocityYawAngle != PrevIntent.VelocityYawAngle)
+			{
+				Writer << Intent.VelocityYawAngle;
+			}
+
+			LegacyBits += Writer.GetNumBits();
+		}
+
+		PrevIntent = Intent;
+		PrevQuantized = Quantized;
+	}
+
+	AddInfo(FString::Printf(TEXT("Bits per update: Iris full %.1f, Iris delta %.1f, legacy properties %.1f (without property headers)"),
+		static_cast<double>(FullBits) / NumUpdates, static_cast<double>(DeltaBits) / NumUpdates, static_cast<double>(LegacyBits) / NumUpdates));
+
+	TestTrue(TEXT("Iris delta serialization is smaller than the legacy properties"), DeltaBits < LegacyBits);
+
+	return true;
+}
+
+#endif
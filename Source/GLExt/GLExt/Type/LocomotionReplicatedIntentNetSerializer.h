@@ -0,0 +1,23 @@
+﻿// Copyright (C) 2024 owoDra
+
+#pragma once
+
+#include "Iris/Serialization/NetSerializer.h"
+
+#include "LocomotionReplicatedIntentNetSerializer.generated.h"
+
+
+/**
+ * Config of the Iris NetSerializer of FLocomotionReplicatedIntent
+ */
+USTRUCT()
+struct FLocomotionReplicatedIntentNetSerializerConfig : public FNetSerializerConfig
+{
+	GENERATED_BODY()
+};
+
+
+namespace UE::Net
+{
+	UE_NET_DECLARE_SERIALIZER(FLocomotionReplicatedIntentNetSerializer, GLEXT_API);
+}